@@ -0,0 +1,71 @@
+//Thermal model of the E-CV heating installation, see boiler_plant.h
+
+#include "boiler_plant.h"
+#include <math.h>
+
+#define WATER_HEAT_CAPACITY 4186.0    // J/(kg*K), 1 l of water is 1 kg
+
+const PlantParameters plant_defaults = {
+  60.0,       // water_volume
+  10.0,       // flow_rate, Wilo Yonos para 15/7 at about 0.6 m3/h
+  9000.0,     // radiator_power
+  1.3,        // radiator_exponent
+  300.0,      // house_loss, 9kW at 20C inside and -10C outside
+  15.0e6,     // house_capacity, time constant of about 14 hours
+  5.0         // standby_loss
+};
+
+static float sensor_resolution(double temperature) {
+  return (float)(floor(temperature * 16 + 0.5) / 16);
+}
+
+BoilerPlant::BoilerPlant() {
+  parameters = plant_defaults;
+  reset(20.0, 20.0);
+}
+
+void BoilerPlant::setParameters(const PlantParameters& new_parameters) {
+  parameters = new_parameters;
+}
+
+void BoilerPlant::reset(double flow_temperature, double room_temperature) {
+  flow    = flow_temperature;
+  ret     = flow_temperature;
+  room    = room_temperature;
+  emitted = 0;
+}
+
+void BoilerPlant::step(double dt, int heater_power, double outside_temperature) {
+  double flow_capacity  = parameters.flow_rate / 60.0 * WATER_HEAT_CAPACITY;     // W/K carried by the pump flow
+  double water_capacity = parameters.water_volume * WATER_HEAT_CAPACITY;         // J/K
+
+  //Radiator output from the mean water temperature, one iteration on the return temperature is enough
+  double output = 0;
+  double return_temperature = flow;
+  for (int i = 0; i < 2; i++) {
+    double difference = (flow + return_temperature) / 2 - room;
+    output = difference > 0 ? parameters.radiator_power * pow(difference / 50.0, parameters.radiator_exponent) : 0;
+    if (flow_capacity > 0) {
+      return_temperature = flow - output / flow_capacity;
+      if (return_temperature < room) { return_temperature = room; }
+    }
+  }
+  if (flow_capacity > 0 && output > (flow - room) * flow_capacity) { output = (flow - room) * flow_capacity; }
+  if (output < 0) { output = 0; }
+
+  double standby = parameters.standby_loss * (flow - room);
+  double house   = parameters.house_loss * (room - outside_temperature);
+
+  flow    += (heater_power - output - standby) / water_capacity * dt;
+  room    += (output + standby - house) / parameters.house_capacity * dt;
+  ret      = return_temperature;
+  emitted  = output;
+}
+
+float BoilerPlant::sensorFlowTemperature() const {
+  return sensor_resolution(flow);
+}
+
+float BoilerPlant::sensorReturnTemperature() const {
+  return sensor_resolution(ret);
+}
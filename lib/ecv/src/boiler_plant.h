@@ -0,0 +1,54 @@
+//Thermal model of the E-CV heating installation
+//
+//Lumped model with a water node (heater, piping and radiators) and a house node:
+// - the heater adds the power of the active stage to the water
+// - the radiators emit Q = radiator_power * ((flow + return) / 2 - room) / 50)^radiator_exponent (EN 442)
+// - the return temperature follows from the emitted power and the pump flow rate
+// - the house loses house_loss W per K difference to the outside temperature
+//step() integrates with explicit Euler, a 24 hour day at 1 second steps takes a few ms on a workstation.
+
+#ifndef BOILER_PLANT_H
+#define BOILER_PLANT_H
+
+struct PlantParameters {
+  double water_volume;          // Water in heater, piping and radiators (l)
+  double flow_rate;             // CH pump flow rate (l/min)
+  double radiator_power;        // Radiator output at a mean water to room difference of 50K (W)
+  double radiator_exponent;     // Radiator exponent, 1.3 for panel radiators
+  double house_loss;            // House heat loss coefficient (W/K)
+  double house_capacity;        // House thermal mass (J/K)
+  double standby_loss;          // Heater and piping loss to the room (W/K)
+};
+
+//Defaults for our installation, the 9kW heater is sized for -10C outside
+extern const PlantParameters plant_defaults;
+
+class BoilerPlant {
+  public:
+    BoilerPlant();
+
+    void setParameters(const PlantParameters& parameters);
+    //Set all temperatures, water at the flow temperature and the room at room_temperature
+    void reset(double flow_temperature, double room_temperature);
+
+    //Advance the model dt seconds with the heater at heater_power W
+    void step(double dt, int heater_power, double outside_temperature);
+
+    double flowTemperature() const { return flow; }
+    double returnTemperature() const { return ret; }
+    double roomTemperature() const { return room; }
+    double radiatorOutput() const { return emitted; }
+
+    //Temperatures as a DS18B20 reports them, 12 bit resolution of 1/16 C
+    float sensorFlowTemperature() const;
+    float sensorReturnTemperature() const;
+
+  private:
+    PlantParameters parameters;
+    double flow;                  // Water temperature at the heater outlet (C)
+    double ret;                   // Return water temperature (C)
+    double room;                  // Room temperature (C)
+    double emitted;               // Radiator output of the last step (W)
+};
+
+#endif
@@ -0,0 +1,43 @@
+//Control quality metrics for closed-loop simulation, see control_metrics.h
+
+#include "hal.h"
+#include "control_metrics.h"
+
+ControlMetrics::ControlMetrics() {
+  start(0, 0, 0, 1);
+}
+
+void ControlMetrics::start(unsigned long now, double new_setpoint, double value, double new_band) {
+  setpoint      = new_setpoint;
+  band          = new_band;
+  direction     = value <= new_setpoint ? 1 : -1;
+  max_overshoot = 0;
+  iae           = 0;
+  last_stage    = -1;
+  inside        = false;
+  start_time    = now;
+  last_time     = now;
+  last_outside  = now;
+  switches      = 0;
+}
+
+void ControlMetrics::add(unsigned long now, double value, int stage) {
+  double error = value - setpoint;
+
+  double excursion = error * direction;
+  if (excursion > max_overshoot) { max_overshoot = excursion; }
+
+  iae += (error < 0 ? -error : error) * millis_since(now, last_time) / 1000.0;
+  last_time = now;
+
+  inside = error <= band && error >= -band;
+  if (!inside) { last_outside = now; }
+
+  if (last_stage >= 0 && stage != last_stage) { switches++; }
+  last_stage = stage;
+}
+
+long ControlMetrics::settlingTime() const {
+  if (!inside) { return -1; }
+  return (long)millis_since(last_outside, start_time);
+}
@@ -0,0 +1,41 @@
+//Control quality metrics for closed-loop simulation of the OT-Simulator
+//
+//Tracks a controlled temperature against a setpoint from the moment of a setpoint step:
+// - overshoot, the largest excursion past the setpoint in the direction of the step
+// - settling time, from the step until the value stays within the band around the setpoint
+// - switch count, the number of heater stage changes
+// - integral absolute error in C*s
+
+#ifndef CONTROL_METRICS_H
+#define CONTROL_METRICS_H
+
+class ControlMetrics {
+  public:
+    ControlMetrics();
+
+    //Start measuring a setpoint step at now (ms), value is the current temperature and band the settling band in C
+    void start(unsigned long now, double setpoint, double value, double band);
+    //Add a sample of the controlled value and the active heater stage
+    void add(unsigned long now, double value, int stage);
+
+    double overshoot() const { return max_overshoot; }
+    //Settling time in ms, -1 while the value is outside the band
+    long settlingTime() const;
+    unsigned long switchCount() const { return switches; }
+    double integralAbsoluteError() const { return iae; }
+
+  private:
+    double setpoint;
+    double band;
+    double max_overshoot;
+    double iae;
+    int direction;                // 1 for a step up, -1 for a step down
+    int last_stage;
+    bool inside;
+    unsigned long start_time;
+    unsigned long last_time;
+    unsigned long last_outside;   // Last sample outside the band
+    unsigned long switches;
+};
+
+#endif
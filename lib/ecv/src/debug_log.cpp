@@ -0,0 +1,28 @@
+//Debug channels of the E-CV core, see debug_log.h
+
+#include <string.h>
+#include "debug_log.h"
+
+void DebugLog::write(const char* text) {
+  size_t length = strlen(text);
+  if (length == 0) { return; }
+
+  //A text that does not fit goes out after the collected part
+  if (used + length >= sizeof(buffer)) {
+    flush();
+    if (length >= sizeof(buffer)) {
+      output.write(text);
+      return;
+    }
+  }
+  memcpy(buffer + used, text, length);
+  used += length;
+  buffer[used] = '\0';
+  if (text[length - 1] == '\n') { flush(); }
+}
+
+void DebugLog::flush() {
+  if (used == 0) { return; }
+  output.write(buffer);
+  used = 0;
+}
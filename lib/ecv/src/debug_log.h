@@ -0,0 +1,62 @@
+//Debug channels of the E-CV core
+//
+//Every debug message of the core belongs to a channel. ECV_LOG_CHANNELS selects the channels that are compiled in,
+//set with a build flag like -D ECV_LOG_CHANNELS=0 for a firmware without debug output: the messages of a channel
+//that is not compiled in are removed by the compiler with their text. The channels that are compiled in are
+//switched at runtime with a bitmask, ECV_LOG_MASK at start and MQTT topic [ecv/command/debug] later.
+//A message guarded with ECV_LOG_ON() is only formatted when its channel is on. The prints collect the line in the
+//fixed buffer of the log, a line goes to the DebugOutput in one write on println() or when the buffer is full.
+
+#ifndef DEBUG_LOG_H
+#define DEBUG_LOG_H
+
+#include "hal.h"
+
+#define ECV_LOG_MONITOR   0x01          // OpenTherm traffic and the connection
+#define ECV_LOG_MQTT      0x02          // Outgoing MQTT messages
+#define ECV_LOG_MQTT_IN   0x04          // Incoming MQTT messages
+#define ECV_LOG_RANGE     0x08          // Range checks of the values
+#define ECV_LOG_UPDATE    0x10          // Value updates
+#define ECV_LOG_CONVERT   0x20          // Value to hex conversion
+#define ECV_LOG_ONEWIRE   0x40          // 1-Wire sensors
+#define ECV_LOG_DEBUG     0x80          // Decoding of the frames
+#define ECV_LOG_ALL       0xFF
+
+//Channels compiled in
+#ifndef ECV_LOG_CHANNELS
+#define ECV_LOG_CHANNELS  ECV_LOG_ALL
+#endif
+
+//Channels on at start
+#ifndef ECV_LOG_MASK
+#define ECV_LOG_MASK      0
+#endif
+
+#define LOG_BUFFER_SIZE   128
+
+//True when the channel is compiled in and on, a constant false when it is not compiled in
+#define ECV_LOG_ON(log, channel) ((ECV_LOG_CHANNELS & (channel)) != 0 && (log).enabled(channel))
+
+class DebugLog : public DebugOutput {
+  public:
+    DebugLog(DebugOutput& output) : output(output) {}
+
+    bool enabled(unsigned int channel) const { return (mask & channel) != 0; }
+    //Switch channels on or off, channels that are not compiled in stay off
+    void setMask(unsigned int value) { mask = value & ECV_LOG_CHANNELS; }
+    unsigned int getMask() const { return mask; }
+    void enable(unsigned int channel) { setMask(mask | channel); }
+
+    //Append to the line, a line end writes the line
+    void write(const char* text) override;
+    //Write the collected part of a line
+    void flush();
+
+  private:
+    DebugOutput& output;
+    unsigned int mask = ECV_LOG_MASK & ECV_LOG_CHANNELS;
+    char buffer[LOG_BUFFER_SIZE];
+    unsigned int used = 0;
+};
+
+#endif
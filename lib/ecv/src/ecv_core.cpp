@@ -0,0 +1,1925 @@
+//E-CV core of the OT-Simulator, see ecv_core.h
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ecv_core.h"
+#include "opentherm_ids.h"
+
+const char* const EcvCore::bootstrap_topics[] = {
+  "ecv/status/fault",
+  "ecv/status/ch_mode",
+  "ecv/status/flame",
+  "ecv/command/max_rel_modulation",
+  "ecv/command/max_ch_water_setpoint",
+  "ecv/command/dhw_setpoint",
+  "ecv/sensors/water_pressure_ch",
+  "ecv/sensors/outside_temperature",
+  "ecv/sensors/heater_flow_temperature",
+  "ecv/sensors/return_water_temperature",
+  "ecv/sensors/water_flow_dhw",
+  "ecv/sensors/dhw_temperature"
+};
+const int EcvCore::bootstrap_topic_count = sizeof(EcvCore::bootstrap_topics) / sizeof(EcvCore::bootstrap_topics[0]);
+
+const char* const EcvCore::oneshot_topics[] = {
+  "ecv/command/autotune",
+  "ecv/command/counters_reset"
+};
+const int EcvCore::oneshot_topic_count = sizeof(EcvCore::oneshot_topics) / sizeof(EcvCore::oneshot_topics[0]);
+
+const char* const EcvCore::counter_files[2] = { "/counters0.bin", "/counters1.bin" };
+const char* const EcvCore::stage_files[2]   = { "/stages0.bin", "/stages1.bin" };
+
+//Binary digits and number of set bits of a hex digit, for the flag8 decoding
+static const char* const nibble_bits[16] = {
+  "0000", "0001", "0010", "0011", "0100", "0101", "0110", "0111",
+  "1000", "1001", "1010", "1011", "1100", "1101", "1110", "1111"
+};
+static const int nibble_count[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+EcvCore::EcvCore(Clock& clock, OpenThermLink& ot, MqttLink& mqtt, TemperatureSensors& sensors, Storage& storage, DebugOutput& debug,
+  SystemMonitor& system)
+  : debug(debug), clock(clock), ot(ot), mqtt(mqtt), sensors(sensors), storage(storage), system(system) {
+  last_temp      = clock.millis();
+  last_ch_update = clock.millis();
+  last_probe            = clock.millis();
+  last_health           = clock.millis();
+  last_counters_save    = clock.millis();
+  last_counters_publish = clock.millis();
+  msg[0] = '\0';
+  counters_json[0] = '\0';
+}
+
+void EcvCore::begin() {
+  //Init the PID modulation controller
+  pid.setSampleTime(pid_sample_time);
+  pid.setTunings(pid_kp, pid_ki, pid_kd);
+  pid.setOutputLimits(pid_out_min, pid_out_max);
+
+  //Init the feed-forward
+  feed_forward.setGain(ff_gain);
+  feed_forward.setFlowRate(ff_flow_rate);
+  feed_forward.setFilterTime(ff_filter_time);
+
+  //Init the heating curve
+  curve.setSlope(heating_curve_slope);
+  curve.setShift(heating_curve_shift);
+  curve.setRoomInfluence(heating_curve_room);
+  curve.setLimits(heating_curve_min_flow, max_ch_water_setpoint);
+
+  //Init the heater stage selection
+  stages.setHysteresis(stage_hysteresis);
+  stages.setMinDwell(stage_min_dwell);
+  stages.setMinOn(stage_min_on);
+  stages.setMinOff(stage_min_off);
+  dither.setPeriod(stage_period);
+  dither.setMinSlot(stage_min_slot);
+
+  //Restore the operating counters from flash
+  if (storage.begin()) {
+    counters_mounted = 1;
+    countersLoad();
+  }
+
+  //Init follower status
+  if (strcmp(fault_indication, "0" ) == 0 ) {follower_status[7] = 0;} else {follower_status[7] = 1;};
+  if (strcmp(CH_mode, "0" ) == 0 )          {follower_status[6] = 0;} else {follower_status[6] = 1;};
+  if (strcmp(flame_status, "0") == 0 )      {follower_status[4] = 0;} else {follower_status[4] = 1;};
+}
+
+void EcvCore::publishMessage(const char* topic, const char* text, bool retained) {
+  size_t length = strlen(text);
+  if (length > MSG_BUFFER_SIZE - 1) { length = MSG_BUFFER_SIZE - 1; }
+  memcpy(msg, text, length);
+  msg[length] = '\0';
+  mqtt.publish(topic, msg, retained);
+}
+
+
+
+//-------------------------------------------OpenTherm message FUNCTIONS--------------------------------------------------------
+//DECODE message flag flag8 status bits and return value
+void EcvCore::decodeFlagFlag8(const char* msg_value, char* result) {
+  char LB = msg_value[1];
+  char HB = msg_value[0];
+  result[0] = '\0';
+
+  //Save current parity
+  parity_correction = f2l_parity;
+
+  //Decode the HB and the LB, only the digits 0-9 and A-F are recognised
+  int nibble = -1;
+  if (HB >= '0' && HB <= '9') { nibble = HB - '0'; }
+  if (HB >= 'A' && HB <= 'F') { nibble = HB - 'A' + 10; }
+  if (nibble >= 0) {
+    for (int i = 0; i < 4; i++) { leader_status[i] = (nibble >> (3 - i)) & 1; }
+    strcat(result, nibble_bits[nibble]);
+    f2l_parity = f2l_parity + nibble_count[nibble];
+  }
+  char msg_lb[5] = "";
+  nibble = -1;
+  if (LB >= '0' && LB <= '9') { nibble = LB - '0'; }
+  if (LB >= 'A' && LB <= 'F') { nibble = LB - 'A' + 10; }
+  if (nibble >= 0) {
+    for (int i = 0; i < 4; i++) { leader_status[4 + i] = (nibble >> (3 - i)) & 1; }
+    strcpy(msg_lb, nibble_bits[nibble]);
+    f2l_parity = f2l_parity + nibble_count[nibble];
+  }
+
+  //Build new mgw_value from LB and HB
+  strcat(result, msg_lb);
+
+  //Set parity_correction to current parity, value will be needed later to be subtracted when building the new leader message value
+  parity_correction = f2l_parity - parity_correction;
+
+  //DEBUG_DEBUG: print the received OpenTHerm leader status message
+  if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+    debug.print("Original msg_value: ");
+    debug.print(msg_value);
+    debug.print(" LB: ");
+    debug.print(LB);
+    debug.print(" HB: ");
+    debug.print(HB);
+    debug.print(" msg_value: ");
+    debug.print(result);
+    debug.print(" Leader status: ");
+    for (int i = 0; i < 8; i++) { debug.print(leader_status[i]); }
+    debug.println();
+  }
+}
+
+//DECODE message flag f8.8 measurements and return value
+void EcvCore::decodeFlagF8(const char* msg_value, char* result) {
+  //Initializing base value to 1, i.e 16^0, set the variable length fixed to 4 and the dec_val to 0
+  int base = 1;  int len = 4; double dec_val = 0;
+
+  //Extracting characters as digits from last character
+  for (int i=len-1; i>=0; i--) {
+    // if character lies in '0'-'9', converting it to integral 0-9 by subtracting 48 from ASCII value.
+    if (msg_value[i]>='0' && msg_value[i]<='9') {
+      dec_val += (msg_value[i] - 48)*base;
+
+      // incrementing base by power
+      base = base * 16;
+    }
+
+    // if character lies in 'a'-'f' , converting it to integral 10 - 15 by subtracting 87 from ASCII value
+    else if (msg_value[i]>='a' && msg_value[i]<='f') {
+        dec_val += (msg_value[i] - 87)*base;
+
+        // incrementing base by power
+        base = base*16;
+    }
+  }
+
+  //DEBUG_DEBUG: Measurement in hex, decimal and converted to real value
+  if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+    debug.print("Measurement in hexadecimal: ");
+    debug.print(msg_value);
+    debug.print(" decimal: ");
+    debug.print(dec_val);
+    debug.print(" and divided by 256: ");
+    debug.print(dec_val/256);
+    debug.println();
+  }
+
+  //Calculate the measurement and convert to a string
+  dec_val = dec_val / 256;
+  format_float(result, dec_val, 2);
+
+  //DEBUG_DEBUG: Print the decoded measurement value
+  if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+    debug.print("Converted measurement being returned in String msg_value is: ");
+    debug.print(result);
+    debug.println();
+  }
+}
+
+//ENCODE message flag f8.8 measurements and return value
+void EcvCore::encodeFlagF8(const char* msg_value, char* result) {
+  //Convert string to float and multiply as per protocol, 32 bit like the long of the ESP8266. Out of range and nan
+  //saturate like the float conversion of the ESP8266, the range check replaces these values anyway
+  float scaled          = (float)atof(msg_value) * 256;
+  int32_t dec_val       = !(scaled < 2147483648.0f) ? INT32_MAX : (scaled <= -2147483648.0f ? INT32_MIN : (int32_t)scaled);
+  int32_t dec_parity    = dec_val;
+  int32_t dec_received  = dec_val;
+
+  //Calculate parity
+  bool parity = 0;
+  while (dec_parity) {
+    parity = !parity;
+    dec_parity = dec_parity & (dec_parity - 1);
+  }
+
+  //Update parity count
+  if (parity == true) {
+    f2l_parity = f2l_parity + 1;
+  }
+
+  //Convert decimal to Hex formated to ####, a negative value is sent as 0
+  if (dec_val > 0) {
+    snprintf (result, 12, "%04lX", (unsigned long)dec_val);
+  } else {
+    strcpy(result, "0000");
+  }
+
+  //DEBUG_CONVERT: Measurement in decimal, convert to Hex
+  if (ECV_LOG_ON(debug, ECV_LOG_CONVERT)) {
+    debug.print("Measurement multiplied by 256 in decimal is: ");
+    debug.print((long)dec_received);
+    debug.print(" and in Hex: ");
+    debug.print(result);
+    debug.print(" With parity of the measurement value: ");
+    debug.print(parity);
+    debug.print(" brings the total parity to: ");
+    debug.print(f2l_parity);
+    debug.println();
+  }
+}
+
+//FUNCTION: Encode an u16 value into a 4 digit Hex String and update the parity
+void EcvCore::encodeFlagU16(unsigned int value, char* result) {
+  //Calculate parity
+  unsigned int dec_parity = value;
+  bool parity = 0;
+  while (dec_parity) {
+    parity = !parity;
+    dec_parity = dec_parity & (dec_parity - 1);
+  }
+
+  //Update parity count
+  if (parity == true) {
+    f2l_parity = f2l_parity + 1;
+  }
+
+  //Convert to Hex formated to ####
+  snprintf (result, 5, "%04X", value & 0xFFFF);
+}
+
+
+
+//---------------------------------------------------MQTT FUNCTIONS-------------------------------------------------------------
+//FUNCTION: Publish the birth message and subscribe after a successful connect, called from reconnect()
+void EcvCore::mqttConnected() {
+  //Start the bootstrap measurement, the broker sends the retained values on subscribe
+  bootstrap_start    = clock.millis();
+  bootstrap_received = 0;
+  bootstrap_active   = 1;
+
+  //Once connected publish retained birth message on initial connection
+  snprintf (msg, MSG_BUFFER_SIZE, "E-CV is ONLINE");
+  mqtt.publish("ecv/system", msg, true);
+  //Publish the reason of the last reset retained, the cause of a reboot after a long uptime
+  publishMessage("ecv/system/reset_reason", system.resetReason(), true);
+  mqtt.subscribe("ecv/rawdata/command");
+  mqtt.subscribe("ecv/probe/ping");
+  mqtt.subscribe("ecv/command/probe_interval", 1);
+  mqtt.subscribe("ecv/command/health_interval", 1);
+  mqtt.subscribe("ecv/command/debug", 1);
+  mqtt.subscribe("ecv/command/rawdata_format", 1);
+  mqtt.subscribe("ecv/command/pid_kp", 1);
+  mqtt.subscribe("ecv/command/pid_ki", 1);
+  mqtt.subscribe("ecv/command/pid_kd", 1);
+  mqtt.subscribe("ecv/command/pid_sample_time", 1);
+  mqtt.subscribe("ecv/command/pid_out_min", 1);
+  mqtt.subscribe("ecv/command/pid_out_max", 1);
+  mqtt.subscribe("ecv/command/counters_save_interval", 1);
+  mqtt.subscribe("ecv/command/autotune_low", 1);
+  mqtt.subscribe("ecv/command/autotune_high", 1);
+  mqtt.subscribe("ecv/command/autotune_hysteresis", 1);
+  mqtt.subscribe("ecv/command/autotune_cycles", 1);
+  mqtt.subscribe("ecv/command/autotune_rule", 1);
+  mqtt.subscribe("ecv/command/ff_gain", 1);
+  mqtt.subscribe("ecv/command/ff_flow_rate", 1);
+  mqtt.subscribe("ecv/command/ff_filter_time", 1);
+  mqtt.subscribe("ecv/command/heating_curve", 1);
+  mqtt.subscribe("ecv/command/heating_curve_slope", 1);
+  mqtt.subscribe("ecv/command/heating_curve_shift", 1);
+  mqtt.subscribe("ecv/command/heating_curve_room", 1);
+  mqtt.subscribe("ecv/command/stage_hysteresis", 1);
+  mqtt.subscribe("ecv/command/stage_min_dwell", 1);
+  mqtt.subscribe("ecv/command/stage_min_on", 1);
+  mqtt.subscribe("ecv/command/stage_min_off", 1);
+  mqtt.subscribe("ecv/command/stage_period", 1);
+  mqtt.subscribe("ecv/command/stage_min_slot", 1);
+
+  //One-shot commands with QoS 0, the broker does not queue them for the persistent session while the E-CV is offline
+  for (int i = 0; i < oneshot_topic_count; i++) {
+    mqtt.subscribe(oneshot_topics[i]);
+  }
+
+  //Pings of the previous session are not coming back
+  probe_seq_received = probe_seq;
+
+  //Subscribe with QoS 1 so the broker queues updates for the persistent session while the E-CV is offline
+  for (int i = 0; i < bootstrap_topic_count; i++) {
+    mqtt.subscribe(bootstrap_topics[i], 1);
+  }
+
+  //TEST: Print the result
+  if (ECV_LOG_ON(debug, ECV_LOG_MQTT)) {
+    debug.print("Publish message: ");
+    debug.print(msg);
+    debug.println();
+  }
+}
+
+//FUNCTION: Mark a bootstrap topic as received, called from callback()
+void EcvCore::bootstrapMark(const char* topic) {
+  if (bootstrap_active == 0) { return; }
+  for (int i = 0; i < bootstrap_topic_count; i++) {
+    if (strcmp(topic, bootstrap_topics[i]) == 0) {
+      bootstrap_received |= 1UL << i;
+      return;
+    }
+  }
+}
+
+//FUNCTION: Index of a one-shot command topic or -1 for a state topic, called from callback()
+int EcvCore::oneShotIndex(const char* topic) {
+  for (int i = 0; i < oneshot_topic_count; i++) {
+    if (strcmp(topic, oneshot_topics[i]) == 0) { return i; }
+  }
+  return -1;
+}
+
+//FUNCTION: Report the time to a consistent state after (re)connect, called from loop()
+void EcvCore::bootstrapReport() {
+  if (bootstrap_active == 0) { return; }
+
+  //Count the received bootstrap topics
+  int received = 0;
+  for (int i = 0; i < bootstrap_topic_count; i++) {
+    if (bootstrap_received & (1UL << i)) { received++; }
+  }
+
+  //Wait until all topics are received or the window has passed
+  unsigned long elapsed = millis_since(clock.millis(), bootstrap_start);
+  if (received < bootstrap_topic_count && elapsed < bootstrap_window) { return; }
+  bootstrap_active = 0;
+
+  //Publish the result to MQTT [ecv/system/bootstrap_ms] and [ecv/system/bootstrap_topics]
+  snprintf (msg, MSG_BUFFER_SIZE, "%lu", elapsed);
+  mqtt.publish("ecv/system/bootstrap_ms", msg);
+  snprintf (msg, MSG_BUFFER_SIZE, "%d/%d", received, bootstrap_topic_count);
+  mqtt.publish("ecv/system/bootstrap_topics", msg);
+
+  //DEBUG_MONITOR: Show the bootstrap result on the serial monitor
+  if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+    debug.print("Bootstrap received ");
+    debug.print(msg);
+    debug.print(" retained topics after: ");
+    debug.print(elapsed);
+    debug.print("ms.");
+    debug.println();
+  }
+}
+
+//FUNCTION: Send a sequence numbered ping to the broker and publish the RTT percentiles, called from loop()
+void EcvCore::probeProcess() {
+  if (probe_interval == 0) { return; }
+  unsigned long now = clock.millis();
+  if (millis_since(now, last_probe) < probe_interval) { return; }
+  last_probe = now;
+
+  //A ping that did not return before the next one is counted as lost
+  if (probe_seq != probe_seq_received) { probe_lost++; }
+
+  //Publish the report after every probe_report_every pings
+  if (probe_since_report >= probe_report_every && probe_rtt.count() > 0) {
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", probe_rtt.percentile(50));
+    mqtt.publish("ecv/probe/rtt/p50", msg);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", probe_rtt.percentile(90));
+    mqtt.publish("ecv/probe/rtt/p90", msg);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", probe_rtt.percentile(99));
+    mqtt.publish("ecv/probe/rtt/p99", msg);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", probe_rtt.maximum());
+    mqtt.publish("ecv/probe/rtt/max", msg);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", probe_lost);
+    mqtt.publish("ecv/probe/lost", msg);
+    probe_since_report = 0;
+    probe_lost = 0;
+  }
+
+  //Payload is "<sequence>:<timestamp>", the timestamp of the echo gives the round trip time
+  probe_seq++;
+  probe_since_report++;
+  snprintf (msg, MSG_BUFFER_SIZE, "%lu:%lu", probe_seq, now);
+  mqtt.publish("ecv/probe/ping", msg);
+}
+
+//FUNCTION: Handle the ping echo from the broker, called from callback()
+void EcvCore::probeReceived(const char* value) {
+  char* separator;
+  unsigned long seq = strtoul(value, &separator, 10);
+  if (*separator != ':') { return; }
+  unsigned long sent = strtoul(separator + 1, NULL, 10);
+
+  //Ignore duplicates and pings of a previous session
+  if (seq <= probe_seq_received || seq > probe_seq) { return; }
+  probe_seq_received = seq;
+
+  unsigned long rtt = millis_since(clock.millis(), sent);
+  probe_rtt.add(rtt);
+
+  //DEBUG_MQTT: Print the round trip time
+  if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+    debug.print("   Ping: ");
+    debug.print(seq);
+    debug.print(" round trip: ");
+    debug.print(rtt);
+    debug.print("ms.");
+    debug.println();
+  }
+}
+
+//FUNCTION: Sample the heap and stack, publish the alerts when they change and the worst values, called from loop()
+void EcvCore::healthProcess() {
+  if (health_interval == 0) { return; }
+  unsigned long now = clock.millis();
+  if (millis_since(now, last_health) < health_interval) { return; }
+  last_health = now;
+
+  SystemStats stats;
+  system.read(stats);
+  int alerts = health.add(stats, health_limits);
+
+  //Publish the alerts retained to MQTT [ecv/system/alert] when they change, the first sample clears the alert of
+  //the session before a reset
+  if (alerts != health_alerts_published) {
+    health.alertText(msg, MSG_BUFFER_SIZE);
+    if (mqtt.publish("ecv/system/alert", msg, true)) { health_alerts_published = alerts; }
+    //DEBUG_MQTT: Print the alert
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT)) {
+      debug.print("   Health: ");
+      debug.print(msg);
+      debug.println();
+    }
+  }
+
+  //Publish the worst values to MQTT [ecv/system/health] after every health_report_every samples
+  if (health.samples() >= health_report_every && health.report(msg, MSG_BUFFER_SIZE)) {
+    mqtt.publish("ecv/system/health", msg);
+  }
+}
+
+//FUNCTION: Start timing the control path on a ch_requested transition, called from processRequest()
+void EcvCore::controlPathStart(int value) {
+  control_id++;
+  control_start      = clock.millis();
+  control_value      = value;
+  control_waiting    = 3;
+  control_ch_mode_ms = 0;
+  control_flame_ms   = 0;
+
+  //Publish the correlation ID of the transition to MQTT [ecv/probe/control_id]
+  snprintf (msg, MSG_BUFFER_SIZE, "%lu", control_id);
+  mqtt.publish("ecv/probe/control_id", msg);
+}
+
+//FUNCTION: Report the control path timing once both status values arrived or on timeout
+void EcvCore::controlPathReport(const char* result) {
+  snprintf (msg, MSG_BUFFER_SIZE, "ID: %lu CH requested: %d CH mode: %lums Flame: %lums Result: %s", control_id, control_value, control_ch_mode_ms, control_flame_ms, result);
+  mqtt.publish("ecv/probe/control_path", msg);
+  control_waiting = 0;
+}
+
+//FUNCTION: Match a ch_mode (bit 0) or flame (bit 1) status with the pending ch_requested transition, called from callback()
+void EcvCore::controlPathStatus(int waiting_bit, int value) {
+  if ((control_waiting & waiting_bit) == 0 || value != control_value) { return; }
+  unsigned long elapsed = millis_since(clock.millis(), control_start);
+  if (waiting_bit == 1) { control_ch_mode_ms = elapsed; } else { control_flame_ms = elapsed; }
+  control_waiting &= ~waiting_bit;
+
+  //The flame status closes the loop, the OpenHAB rule sends it after the coils are switched
+  if (waiting_bit == 2) {
+    control_rtt.add(elapsed);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", control_rtt.percentile(50));
+    mqtt.publish("ecv/probe/control/p50", msg);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", control_rtt.percentile(90));
+    mqtt.publish("ecv/probe/control/p90", msg);
+  }
+  if (control_waiting == 0) { controlPathReport("OK"); }
+}
+
+//FUNCTION: Report a control path transition that was not answered in time, called from loop()
+void EcvCore::controlPathTimeout() {
+  if (control_waiting != 0 && millis_since(clock.millis(), control_start) > control_timeout) {
+    controlPathReport("TIMEOUT");
+  }
+}
+
+//FUNCTION: Publish the auto-tune state and the proposed gains, called from modulationControl() and callback()
+void EcvCore::publishAutotune() {
+  const char* state_names[] = { "IDLE", "RUNNING", "DONE", "FAILED" };
+  autotune_cycle = autotune.cycle();
+
+  //Publish the state to MQTT [ecv/autotune/state]
+  if (autotune.running()) {
+    snprintf (msg, MSG_BUFFER_SIZE, "%s cycle: %d/%d", state_names[autotune.state()], autotune_cycle < 0 ? 0 : autotune_cycle, autotune_cycles + 1);
+  } else {
+    snprintf (msg, MSG_BUFFER_SIZE, "%s", state_names[autotune.state()]);
+  }
+  mqtt.publish("ecv/autotune/state", msg, mqtt_retain_state == 1);
+
+  //DEBUG_UPDATE: Print the auto-tune state
+  if (ECV_LOG_ON(debug, ECV_LOG_UPDATE)) {
+    debug.print("Auto-tune: ");
+    debug.print(msg);
+    debug.println();
+  }
+
+  //Publish the result to MQTT [ecv/autotune/ku] and [ecv/autotune/pu], the gains to confirm on [ecv/autotune/kp|ki|kd]
+  if (autotune.state() == AUTOTUNE_DONE) {
+    char value[32];
+    mqtt.publish("ecv/autotune/ku", format_float(value, autotune.ultimateGain(), 2), mqtt_retain_state == 1);
+    mqtt.publish("ecv/autotune/pu", format_float(value, autotune.ultimatePeriod(), 0), mqtt_retain_state == 1);
+    mqtt.publish("ecv/autotune/kp", format_float(value, autotune.kp(), 2), mqtt_retain_state == 1);
+    mqtt.publish("ecv/autotune/ki", format_float(value, autotune.ki(), 4), mqtt_retain_state == 1);
+    mqtt.publish("ecv/autotune/kd", format_float(value, autotune.kd(), 2), mqtt_retain_state == 1);
+  }
+}
+
+//FUNCTION: Restore the newest valid counter record from the storage, called from begin()
+void EcvCore::countersLoad() {
+  CounterRecord record;
+  CounterRecord newest;
+  int found = 0;
+
+  for (int i = 0; i < 2; i++) {
+    if (storage.read(counter_files[i], &record, sizeof(record)) && OperatingCounters::validRecord(record)) {
+      if (found == 0 || record.sequence > newest.sequence) {
+        newest = record;
+        found = 1;
+      }
+    }
+  }
+  if (found == 1) { counters.fromRecord(newest); }
+
+  //The newest switch counts of the heater stages, the SSR wear
+  StageRecord stage_record;
+  StageRecord stage_newest;
+  int stage_found = 0;
+  for (int i = 0; i < 2; i++) {
+    if (storage.read(stage_files[i], &stage_record, sizeof(stage_record)) && StageSelector::validRecord(stage_record)) {
+      if (stage_found == 0 || stage_record.sequence > stage_newest.sequence) {
+        stage_newest = stage_record;
+        stage_found = 1;
+      }
+    }
+  }
+  if (stage_found == 1) { stages.fromRecord(stage_newest); }
+  saved_stage_switches = stages.stageSwitches();
+
+  //DEBUG_UPDATE: Print the restored counters
+  if (ECV_LOG_ON(debug, ECV_LOG_UPDATE)) {
+    debug.print("Operating counters restored: ");
+    debug.print(found == 1 ? "yes" : "no");
+    debug.print(" energy: ");
+    debug.print((unsigned long)counters.energyWh());
+    debug.print("Wh burner starts: ");
+    debug.print((unsigned long)counters.starts(COUNTER_BURNER));
+    debug.print(" stage switches: ");
+    debug.print(stages.stageSwitches());
+    debug.println();
+  }
+}
+
+//FUNCTION: Write the counters and the stage switch counts to the records of the next sequence number, the previous
+//records stay intact
+void EcvCore::countersSave() {
+  if (counters_mounted != 1) { return; }
+  CounterRecord record;
+  counters.toRecord(record);
+  if (!storage.write(counter_files[record.sequence & 1], &record, sizeof(record))) { return; }
+  StageRecord stage_record;
+  stages.toRecord(stage_record, record.sequence);
+  if (!storage.write(stage_files[record.sequence & 1], &stage_record, sizeof(stage_record))) { return; }
+  saved_stage_switches = stages.stageSwitches();
+  last_counters_save = clock.millis();
+}
+
+//FUNCTION: Format the counters as JSON for the HTTP page /counters
+const char* EcvCore::countersFormat() {
+  uint32_t wh = counters.energyWh();
+  uint32_t s[COUNTERS];
+  for (int i = 0; i < COUNTERS; i++) { s[i] = counters.seconds(i); }
+  snprintf (counters_json, sizeof(counters_json),
+    "{\"energy_kwh\":%lu.%03lu,\"burner_starts\":%lu,\"burner_hours\":%lu.%02lu,\"ch_pump_starts\":%lu,\"ch_pump_hours\":%lu.%02lu,"
+    "\"dhw_pump_starts\":%lu,\"dhw_pump_hours\":%lu.%02lu,\"dhw_burner_starts\":%lu,\"dhw_burner_hours\":%lu.%02lu}",
+    (unsigned long)(wh / 1000), (unsigned long)(wh % 1000),
+    (unsigned long)counters.starts(COUNTER_BURNER), (unsigned long)(s[COUNTER_BURNER] / 3600), (unsigned long)(s[COUNTER_BURNER] % 3600 * 100 / 3600),
+    (unsigned long)counters.starts(COUNTER_CH_PUMP), (unsigned long)(s[COUNTER_CH_PUMP] / 3600), (unsigned long)(s[COUNTER_CH_PUMP] % 3600 * 100 / 3600),
+    (unsigned long)counters.starts(COUNTER_DHW_PUMP), (unsigned long)(s[COUNTER_DHW_PUMP] / 3600), (unsigned long)(s[COUNTER_DHW_PUMP] % 3600 * 100 / 3600),
+    (unsigned long)counters.starts(COUNTER_DHW_BURNER), (unsigned long)(s[COUNTER_DHW_BURNER] / 3600), (unsigned long)(s[COUNTER_DHW_BURNER] % 3600 * 100 / 3600));
+  return counters_json;
+}
+
+//FUNCTION: Publish the counters to MQTT [ecv/counters/*]
+void EcvCore::publishCounters() {
+  const char* names[COUNTERS] = { "burner", "ch_pump", "dhw_pump", "dhw_burner" };
+  char topic[40];
+  uint32_t wh = counters.energyWh();
+
+  //Publish the energy in kWh to MQTT [ecv/counters/energy]
+  snprintf (msg, MSG_BUFFER_SIZE, "%lu.%03lu", (unsigned long)(wh / 1000), (unsigned long)(wh % 1000));
+  mqtt.publish("ecv/counters/energy", msg, mqtt_retain_state == 1);
+
+  //Publish the starts and hours to MQTT [ecv/counters/<counter>_starts] and [ecv/counters/<counter>_hours]
+  for (int i = 0; i < COUNTERS; i++) {
+    uint32_t seconds = counters.seconds(i);
+    snprintf (topic, sizeof(topic), "ecv/counters/%s_starts", names[i]);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu", (unsigned long)counters.starts(i));
+    mqtt.publish(topic, msg, mqtt_retain_state == 1);
+    snprintf (topic, sizeof(topic), "ecv/counters/%s_hours", names[i]);
+    snprintf (msg, MSG_BUFFER_SIZE, "%lu.%02lu", (unsigned long)(seconds / 3600), (unsigned long)(seconds % 3600 * 100 / 3600));
+    mqtt.publish(topic, msg, mqtt_retain_state == 1);
+  }
+  last_counters_publish = clock.millis();
+}
+
+//FUNCTION: Integrate the counters from the follower status and the active stage, called from loop()
+void EcvCore::countersProcess() {
+  counters.update(clock.millis(), follower_status[4] == 1, follower_status[6] == 1, follower_status[5] == 1, heater_stage_power[stages.stage()]);
+
+  if (millis_since(clock.millis(), last_counters_publish) >= counters_publish_interval && mqtt.connected()) {
+    publishCounters();
+  }
+  bool changed = counters.dirty() || stages.stageSwitches() != saved_stage_switches;
+  if (changed && millis_since(clock.millis(), last_counters_save) >= counters_save_interval) {
+    countersSave();
+  }
+}
+
+//FUNCTION: Call-back on MQTT message, called from the platform to update variables with MQTT topic "sensors"  messages
+void EcvCore::callback(const char* topic, const uint8_t* payload, unsigned int length) {
+  //Copy the payload into a terminated string, the PubSubClient payload is not null terminated and a burst of
+  //retained messages after connect would otherwise parse left-overs of the previous message in the buffer. It holds
+  //the longest value, the ping echo "sequence:timestamp" of two 64-bit unsigned longs on the host
+  char value[2 * 20 + 2];
+  unsigned int value_length = length < sizeof(value) - 1 ? length : sizeof(value) - 1;
+  memcpy(value, payload, value_length);
+  value[value_length] = '\0';
+
+  //DEBUG_MQTT: Print the topic of the received MQTT message
+  if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+    debug.print("MQTT Message topic: ");
+    debug.print(topic);
+  }
+
+  //Register the topic for the bootstrap measurement
+  bootstrapMark(topic);
+
+  //A one-shot command acts once: the empty message that clears it on the broker is ignored
+  int oneshot = oneShotIndex(topic);
+  if (oneshot >= 0 && length == 0) {
+    //DEBUG_MQTT: Print the cleared command
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Command cleared");
+      debug.println();
+    }
+    return;
+  }
+
+  //MQTT TOPIC is [ecv/sensors/fault], set the corresponding variables
+  if (strcmp(topic, "ecv/status/fault") == 0) {
+    if (value[0] == 48 ) {follower_status[7] = 0; }
+    if (value[0] == 49 ) {follower_status[7] = 1; }
+    //DEBUG_MQTT: Print payload of MQTT message with topic [ecv/sensors/fault]
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Fault status: ");
+      debug.print((int)(uint8_t)value[0]);
+      debug.print("   Follower status: ");
+      for (int i = 0; i < 8; i++) {debug.print(follower_status[i]);}
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/ch_mode], set the corresponding variables
+  if (strcmp(topic, "ecv/status/ch_mode") == 0) {
+    if (value[0] == 48 ) {follower_status[6] = 0; controlPathStatus(1, 0); }
+    if (value[0] == 49 ) {follower_status[6] = 1; controlPathStatus(1, 1); }
+    //DEBUG_MQTT: Print payload of MQTT message with topic [ecv/sensors/ch_mode]
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   CH-Mode status: ");
+      debug.print((int)(uint8_t)value[0]);
+      debug.print("   Follower status: ");
+      for (int i = 0; i < 8; i++) {debug.print(follower_status[i]);}
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/flame], set the corresponding variables
+  if (strcmp(topic, "ecv/status/flame") == 0) {
+    //Set modulation level based on flame OFF
+    if (value[0] == 48 ) {
+      follower_status[4] = 0;
+      controlPathStatus(2, 0);
+    }
+    //Set modulation level based on flame ON
+    if (value[0] == 49 ) {
+      follower_status[4] = 1;
+      controlPathStatus(2, 1);
+    }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Flame status: ");
+      debug.print((int)(uint8_t)value[0]);
+      debug.print("   Follower status: ");
+      for (int i = 0; i < 8; i++) {debug.print(follower_status[i]);}
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/max_rel_modulation], set the corresponding variables
+  if (strcmp(topic, "ecv/command/max_rel_modulation") == 0) {
+    max_rel_modulation = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set max relative modulation: ");
+      debug.print(max_rel_modulation);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/max_ch_water_setpoint], set the corresponding variables
+  if (strcmp(topic, "ecv/command/max_ch_water_setpoint") == 0) {
+    max_ch_water_setpoint = atof(value);
+    curve.setLimits(heating_curve_min_flow, max_ch_water_setpoint);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set max CH water setpoint: ");
+      debug.print(max_ch_water_setpoint);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/dhw_setpoint], set the corresponding variables
+  if (strcmp(topic, "ecv/command/dhw_setpoint") == 0) {
+    dhw_setpoint = atoi(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set DHW setpoint: ");
+      debug.print(dhw_setpoint);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/water_pressure_ch], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/water_pressure_ch") == 0) {
+    water_pressure_ch = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Water pressure CH: ");
+      debug.print(water_pressure_ch);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/outside_temperature], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/outside_temperature") == 0) {
+    outside_temperature = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Outside temperature: ");
+      debug.print(outside_temperature);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/heater_flow_temperature], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/heater_flow_temperature") == 0) {
+    heater_flow_temperature = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Boiler flow temperature: ");
+      debug.print(heater_flow_temperature);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/return_water_temperature], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/return_water_temperature") == 0) {
+    return_water_temperature = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Return water temperature: ");
+      debug.print(return_water_temperature);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/water_flow_dhw], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/water_flow_dhw") == 0) {
+    water_flow_dhw = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Water flow DHW: ");
+      debug.print(water_flow_dhw);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/sensors/dhw_temperature], set the corresponding variables
+  if (strcmp(topic, "ecv/sensors/dhw_temperature") == 0) {
+    dhw_temperature = atof(value);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   DHW Temperature: ");
+      debug.print(dhw_temperature);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/pid_kp], [ecv/command/pid_ki] or [ecv/command/pid_kd], set the controller gains
+  if (strcmp(topic, "ecv/command/pid_kp") == 0 || strcmp(topic, "ecv/command/pid_ki") == 0 || strcmp(topic, "ecv/command/pid_kd") == 0) {
+    if (strcmp(topic, "ecv/command/pid_kp") == 0) { pid_kp = atof(value); }
+    if (strcmp(topic, "ecv/command/pid_ki") == 0) { pid_ki = atof(value); }
+    if (strcmp(topic, "ecv/command/pid_kd") == 0) { pid_kd = atof(value); }
+    pid.setTunings(pid_kp, pid_ki, pid_kd);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set PID Kp: ");
+      debug.print(pid_kp);
+      debug.print(" Ki: ");
+      debug.print(pid_ki, 4);
+      debug.print(" Kd: ");
+      debug.print(pid_kd);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/pid_sample_time], set the controller sample time in ms
+  if (strcmp(topic, "ecv/command/pid_sample_time") == 0) {
+    pid_sample_time = strtoul(value, NULL, 10);
+    pid.setSampleTime(pid_sample_time);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set PID sample time: ");
+      debug.print(pid_sample_time);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/pid_out_min] or [ecv/command/pid_out_max], set the controller output limits
+  if (strcmp(topic, "ecv/command/pid_out_min") == 0 || strcmp(topic, "ecv/command/pid_out_max") == 0) {
+    if (strcmp(topic, "ecv/command/pid_out_min") == 0) { pid_out_min = atof(value); }
+    if (strcmp(topic, "ecv/command/pid_out_max") == 0) { pid_out_max = atof(value); }
+    pid.setOutputLimits(pid_out_min, pid_out_max);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set PID output limits: ");
+      debug.print(pid_out_min);
+      debug.print(" to: ");
+      debug.print(pid_out_max);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/autotune], 1 = start the relay auto-tune on the next CH request, 0 = abort, 2 = apply the proposed gains
+  if (strcmp(topic, "ecv/command/autotune") == 0) {
+    int command = atoi(value);
+    if (command == 1) { autotune_request = 1; }
+    if (command == 0) {
+      autotune_request = 0;
+      if (autotune.running()) {
+        autotune.abort();
+        publishAutotune();
+      }
+    }
+    if (command == 2 && autotune.state() == AUTOTUNE_DONE) {
+      pid_kp = autotune.kp();
+      pid_ki = autotune.ki();
+      pid_kd = autotune.kd();
+      pid.setTunings(pid_kp, pid_ki, pid_kd);
+    }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Auto-tune command: ");
+      debug.print(command);
+      debug.print(" PID gains kp: ");
+      debug.print(pid_kp);
+      debug.print(" ki: ");
+      debug.print(pid_ki, 4);
+      debug.print(" kd: ");
+      debug.print(pid_kd);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/autotune_*], set the relay experiment
+  if (strncmp(topic, "ecv/command/autotune_", 21) == 0) {
+    if (strcmp(topic, "ecv/command/autotune_low") == 0)        { autotune_low        = atof(value); }
+    if (strcmp(topic, "ecv/command/autotune_high") == 0)       { autotune_high       = atof(value); }
+    if (strcmp(topic, "ecv/command/autotune_hysteresis") == 0) { autotune_hysteresis = atof(value); }
+    if (strcmp(topic, "ecv/command/autotune_cycles") == 0)     { autotune_cycles     = atol(value); }
+    if (strcmp(topic, "ecv/command/autotune_rule") == 0)       { autotune_rule       = atol(value); }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set auto-tune relay: ");
+      debug.print(autotune_low);
+      debug.print("-");
+      debug.print(autotune_high);
+      debug.print(" hysteresis: ");
+      debug.print(autotune_hysteresis);
+      debug.print(" cycles: ");
+      debug.print(autotune_cycles);
+      debug.print(" rule: ");
+      debug.print(autotune_rule);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/counters_reset], 1 = reset all operating counters
+  if (strcmp(topic, "ecv/command/counters_reset") == 0) {
+    if (atoi(value) == 1) {
+      counters.resetAll();
+      countersSave();
+      publishCounters();
+    }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Reset operating counters: ");
+      debug.print(value);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/counters_save_interval], set the time in ms between writes to flash
+  if (strcmp(topic, "ecv/command/counters_save_interval") == 0) {
+    counters_save_interval = strtoul(value, NULL, 10);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set counters save interval: ");
+      debug.print(counters_save_interval);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/ff_gain], [ecv/command/ff_flow_rate] or [ecv/command/ff_filter_time], set the feed-forward
+  if (strncmp(topic, "ecv/command/ff_", 15) == 0) {
+    if (strcmp(topic, "ecv/command/ff_gain") == 0)        { ff_gain        = atof(value); feed_forward.setGain(ff_gain); }
+    if (strcmp(topic, "ecv/command/ff_flow_rate") == 0)   { ff_flow_rate   = atof(value); feed_forward.setFlowRate(ff_flow_rate); }
+    if (strcmp(topic, "ecv/command/ff_filter_time") == 0) { ff_filter_time = strtoul(value, NULL, 10); feed_forward.setFilterTime(ff_filter_time); }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set feed-forward gain: ");
+      debug.print(ff_gain);
+      debug.print(" flow rate: ");
+      debug.print(ff_flow_rate);
+      debug.print(" filter time: ");
+      debug.print(ff_filter_time);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/heating_curve*], set the heating curve
+  if (strncmp(topic, "ecv/command/heating_curve", 25) == 0) {
+    if (strcmp(topic, "ecv/command/heating_curve") == 0)       { heating_curve_mode  = atol(value); }
+    if (strcmp(topic, "ecv/command/heating_curve_slope") == 0) { heating_curve_slope = atof(value); curve.setSlope(heating_curve_slope); }
+    if (strcmp(topic, "ecv/command/heating_curve_shift") == 0) { heating_curve_shift = atof(value); curve.setShift(heating_curve_shift); }
+    if (strcmp(topic, "ecv/command/heating_curve_room") == 0)  { heating_curve_room  = atof(value); curve.setRoomInfluence(heating_curve_room); }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set heating curve mode: ");
+      debug.print(heating_curve_mode);
+      debug.print(" slope: ");
+      debug.print(heating_curve_slope);
+      debug.print(" shift: ");
+      debug.print(heating_curve_shift);
+      debug.print(" room influence: ");
+      debug.print(heating_curve_room);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/stage_*], set the heater stage selection
+  if (strncmp(topic, "ecv/command/stage_", 18) == 0) {
+    unsigned long setting = strtoul(value, NULL, 10);
+    if (strcmp(topic, "ecv/command/stage_hysteresis") == 0) { stage_hysteresis = setting; stages.setHysteresis(stage_hysteresis); }
+    if (strcmp(topic, "ecv/command/stage_min_dwell") == 0)  { stage_min_dwell  = setting; stages.setMinDwell(stage_min_dwell); }
+    if (strcmp(topic, "ecv/command/stage_min_on") == 0)     { stage_min_on     = setting; stages.setMinOn(stage_min_on); }
+    if (strcmp(topic, "ecv/command/stage_min_off") == 0)    { stage_min_off    = setting; stages.setMinOff(stage_min_off); }
+    if (strcmp(topic, "ecv/command/stage_period") == 0)     { stage_period     = setting; dither.setPeriod(stage_period); }
+    if (strcmp(topic, "ecv/command/stage_min_slot") == 0)   { stage_min_slot   = setting; dither.setMinSlot(stage_min_slot); }
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set stage selection: ");
+      debug.print(setting);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/probe/ping], the echo of the latency probe
+  if (strcmp(topic, "ecv/probe/ping") == 0) {
+    probeReceived(value);
+  }
+
+  //MQTT TOPIC is [ecv/command/probe_interval], set the corresponding variables
+  if (strcmp(topic, "ecv/command/probe_interval") == 0) {
+    probe_interval = strtoul(value, NULL, 10);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set probe interval: ");
+      debug.print(probe_interval);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/health_interval], set the corresponding variables
+  if (strcmp(topic, "ecv/command/health_interval") == 0) {
+    health_interval = strtoul(value, NULL, 10);
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set health interval: ");
+      debug.print(health_interval);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/rawdata_format], 0 for the rawdata text, 1 for the compact frames
+  if (strcmp(topic, "ecv/command/rawdata_format") == 0) {
+    rawdata_format = atoi(value) == 1 ? 1 : 0;
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set rawdata format: ");
+      debug.print(rawdata_format);
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is [ecv/command/debug], the bitmask of the debug channels in decimal or 0x hex, see debug_log.h
+  if (strcmp(topic, "ecv/command/debug") == 0) {
+    debug.setMask(strtoul(value, NULL, 0));
+    //DEBUG_MQTT: Print payload of MQTT message
+    if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+      debug.print("   Set debug channels: ");
+      debug.print(debug.getMask());
+      debug.println();
+    }
+  }
+
+  //MQTT TOPIC is "ecv/rawdata/command", a batch of request frames for the protocol engine, see rawdataCommand()
+  if (strcmp(topic, "ecv/rawdata/command") == 0) {
+    rawdataCommand(payload, length);
+  }
+
+  //Clear a one-shot command on the broker after acting, a retained message would run it again on every (re)connect.
+  //The PubSubClient callback does not tell if the message was retained, an empty retained message removes it.
+  if (oneshot >= 0) {
+    mqtt.publish(oneshot_topics[oneshot], "", true);
+  }
+}
+
+//FUNCTION: Run a batch of request frames from MQTT [ecv/rawdata/command] through processRequest(), called from callback()
+//The frames are 8 hex digits separated by spaces, commas or semicolons, or 4 bytes binary with the high byte first.
+//A valid request starts with 0x00 to 0x2F or 0x80 to 0xAF, never with the ASCII code of a hex digit, so a payload of
+//only hex digits and separators is hex. The replies are published in the same order on [ecv/rawdata/reply] in hex.
+void EcvCore::rawdataCommand(const uint8_t* payload, unsigned int length) {
+  unsigned long frames[RAWDATA_BATCH_MAX];
+  int count    = 0;
+  bool valid   = true;
+
+  //Hex when the payload has only hex digits and separators
+  bool hex = true;
+  for (unsigned int i = 0; i < length; i++) {
+    char c = (char)payload[i];
+    if (!isxdigit((unsigned char)c) && c != ' ' && c != ',' && c != ';' && c != '\r' && c != '\n') { hex = false; break; }
+  }
+
+  if (hex) {
+    unsigned int i = 0;
+    while (i < length && valid) {
+      char c = (char)payload[i];
+      if (!isxdigit((unsigned char)c)) { i++; continue; }
+      //A frame of exactly 8 digits
+      unsigned long frame = 0;
+      int digits = 0;
+      while (i < length && isxdigit((unsigned char)payload[i])) {
+        c = (char)payload[i++];
+        frame = (frame << 4) | (unsigned long)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        digits++;
+      }
+      if (digits != 8 || count == RAWDATA_BATCH_MAX) { valid = false; break; }
+      frames[count++] = frame;
+    }
+  } else if (length % 4 == 0 && length / 4 <= RAWDATA_BATCH_MAX) {
+    for (unsigned int i = 0; i < length; i += 4) {
+      frames[count++] = ((unsigned long)payload[i] << 24) | ((unsigned long)payload[i + 1] << 16) |
+                        ((unsigned long)payload[i + 2] << 8) | (unsigned long)payload[i + 3];
+    }
+  } else {
+    valid = false;
+  }
+
+  //DEBUG_MQTT: On serial terminal report the frames of the batch
+  if (ECV_LOG_ON(debug, ECV_LOG_MQTT_IN)) {
+    debug.print("   Raw data command: ");
+    debug.print(valid ? count : 0);
+    debug.print(hex ? " hex" : " binary");
+    debug.print(valid ? " frames" : " frames, rejected");
+    debug.println();
+  }
+
+  if (!valid || count == 0) {
+    rawdata_rejected++;
+    mqtt.publish("ecv/rawdata/reply", "INVALID", false);
+    return;
+  }
+
+  //The replies go to MQTT only, an injected frame is not sent on the bus and waits for no response time
+  char replies[RAWDATA_BATCH_MAX * 9];
+  int used = 0;
+  for (int i = 0; i < count; i++) {
+    unsigned long reply = answerRequest(frames[i], false);
+    used += snprintf (replies + used, sizeof(replies) - used, i == 0 ? "%08lx" : " %08lx", reply);
+  }
+  rawdata_frames += count;
+
+  mqtt.publish("ecv/rawdata/reply", replies, false);
+}
+
+
+
+//-------------------------------------------------CONTROL FUNCTIONS------------------------------------------------------------
+//FUNCTION: Read temperature sensors
+void EcvCore::readTemperature() {
+  //Sensors backed by the plant model advance to now with the active heater stage
+  sensors.heaterOutput(heater_stage_power[stages.stage()], outside_temperature);
+  sensors.read(heater_temp, return_temp);
+
+  //DEBUG_ONEWIRE: Print the temperature readings to the terminal
+  if (ECV_LOG_ON(debug, ECV_LOG_ONEWIRE)) {
+      debug.print("Temperature heater is: ");
+      debug.print(heater_temp);
+      debug.print(" and return water is: ");
+      debug.print(return_temp);
+      debug.print(" celcius.");
+      debug.println();
+  }
+}
+
+//FUNCTION: Publish the active heater stage and the switch counts, called from modulationControl()
+void EcvCore::publishStage() {
+  //Publish the stage to MQTT [ecv/thermostat/stage], OpenHAB switches the SSRs for this stage
+  snprintf (msg, MSG_BUFFER_SIZE, "%d", stages.stage());
+  mqtt.publish("ecv/thermostat/stage", msg, mqtt_retain_state == 1);
+
+  //Publish the switch counts to MQTT [ecv/thermostat/stage_switches] and [ecv/thermostat/ssr_switches]
+  snprintf (msg, MSG_BUFFER_SIZE, "%lu", stages.stageSwitches());
+  mqtt.publish("ecv/thermostat/stage_switches", msg);
+  size_t length = 0;
+  for (int i = 0; i < HEATER_SSRS; i++) {
+    length += snprintf (msg + length, MSG_BUFFER_SIZE - length, i == 0 ? "%lu" : "/%lu", stages.ssrSwitches(i));
+  }
+  mqtt.publish("ecv/thermostat/ssr_switches", msg);
+
+  //DEBUG_UPDATE: Print the stage change
+  if (ECV_LOG_ON(debug, ECV_LOG_UPDATE)) {
+    debug.print("Heater stage: ");
+    debug.print(stages.stage());
+    debug.print(" delivered modulation: ");
+    debug.print(delivered_modulation);
+    debug.print(" requested modulation: ");
+    debug.print(set_modulation);
+    debug.println();
+  }
+}
+
+//FUNCTION: Publish the planned stage schedule of the time-proportioning period, called from modulationControl()
+void EcvCore::publishSchedule() {
+  //Publish the schedule as "<stage>:<seconds>/<stage>:<seconds>" to MQTT [ecv/thermostat/stage_schedule]
+  snprintf (msg, MSG_BUFFER_SIZE, "%d:%lu/%d:%lu", dither.firstStage(), dither.firstTime() / 1000, dither.secondStage(), dither.secondTime() / 1000);
+  mqtt.publish("ecv/thermostat/stage_schedule", msg);
+
+  //DEBUG_UPDATE: Print the schedule
+  if (ECV_LOG_ON(debug, ECV_LOG_UPDATE)) {
+    debug.print("Stage schedule: ");
+    debug.print(msg);
+    debug.print(" requested modulation: ");
+    debug.print(set_modulation);
+    debug.println();
+  }
+}
+
+//FUNCTION: Run the PID modulation controller on its own sample time, called from loop()
+void EcvCore::modulationControl() {
+  int32_t input = (int32_t)(heater_temp * 256);
+
+  //The controller only runs while CH is requested, it restarts from 0% on the next request
+  if (ch_enabled != 1) {
+    pid.setAutomatic(false, input, 0);
+    feed_forward.reset();
+    set_modulation = 0.00;
+
+    //The relay experiment needs the CH request, a running auto-tune is aborted
+    if (autotune.running()) {
+      autotune.abort();
+      publishAutotune();
+    }
+  } else {
+    //Flow temperature target from the thermostat or the heating curve
+    int32_t target = (int32_t)(control_ch_setpoint * 256);
+    if (heating_curve_mode == 1) {
+      target = curve.flowTarget((int32_t)(outside_temperature * 256), (int32_t)(room_setpoint * 256));
+    }
+
+    //Start a requested auto-tune around the current flow target
+    if (autotune_request == 1) {
+      autotune_request = 0;
+      autotune.setRelay(autotune_low, autotune_high);
+      autotune.setHysteresis(autotune_hysteresis);
+      autotune.setCycles(autotune_cycles);
+      autotune.setRule(autotune_rule);
+      //The gains are for the time-proportioning, on the nearest stage for the shortest on-off cycle of the timers
+      autotune.setActuatorPeriod(stage_period > 0 ? stage_period : stage_min_on + stage_min_off);
+      autotune.start(clock.millis(), target, input);
+      publishAutotune();
+    }
+
+    if (autotune.running()) {
+      //The relay replaces the controller until the experiment is done
+      pid.setAutomatic(false, input, 0);
+      if (autotune.update(clock.millis(), input) || autotune.cycle() != autotune_cycle) {
+        publishAutotune();
+      }
+      set_modulation = autotune.output() / 256.0;
+      flow_target    = target / 256.0;
+    } else {
+      //Continue from the last modulation, 0% on a new CH request
+      if (!pid.isAutomatic()) {
+        pid.setAutomatic(true, input, (int32_t)(set_modulation * 256));
+      }
+      //Heat demand to lift the return water to the target, without a valid return temperature the PID works alone
+      int32_t ff = 0;
+      if (return_temp > 0 && return_temp < 100) {
+        ff = feed_forward.update(clock.millis(), target, (int32_t)(return_temp * 256));
+      }
+
+      //Run a controller step if the sample time has passed
+      if (pid.compute(clock.millis(), target, input, ff)) {
+        set_modulation  = pid.output() / 256.0;
+        flow_target     = target / 256.0;
+        temp_difference = flow_target - heater_temp;
+
+        //Publish the calculation to MQTT [ecv/thermostat/rawdata/modulation]
+        char request_text[32], heater_text[32], difference_text[32], modulation_text[32], ff_text[32];
+        snprintf (msg, MSG_BUFFER_SIZE, "Request: %s Heater flow: %s Difference:%s Set Modulation: %s FF: %s",
+          format_float(request_text, flow_target, 2), format_float(heater_text, heater_temp, 2), format_float(difference_text, temp_difference, 2),
+          format_float(modulation_text, set_modulation, 2), format_float(ff_text, ff / 256.0, 2));
+        mqtt.publish("ecv/thermostat/rawdata/modulation", msg);
+
+        //Publish the heat delivered to the radiators to MQTT [ecv/thermostat/heat_delivered]
+        heat_delivered = feed_forward.heat((int32_t)(heater_temp * 256), (int32_t)(return_temp * 256));
+        snprintf (msg, MSG_BUFFER_SIZE, "%ld", (long)heat_delivered);
+        mqtt.publish("ecv/thermostat/heat_delivered", msg);
+
+        //Publish the heating curve target to MQTT [ecv/thermostat/flow_target]
+        if (heating_curve_mode == 1) {
+          publishMessage("ecv/thermostat/flow_target", format_float(request_text, flow_target, 2), mqtt_retain_state == 1);
+        }
+      }
+    }
+  }
+
+  //Time-proportioning between the two stages around the requested modulation, not during the relay experiment
+  int32_t requested = (int32_t)(set_modulation * 256);
+  if (stage_period > 0 && ch_enabled == 1 && !autotune.running()) {
+    if (dither.update(clock.millis(), requested, stages.deliveredModulation())) {
+      publishSchedule();
+    }
+    requested = dither.output();
+  } else {
+    dither.reset();
+  }
+
+  //Select the heater stage, the timers may hold the active stage but not the relay of the auto-tune
+  if (stages.update(clock.millis(), requested, ch_enabled == 1, !autotune.running())) {
+    delivered_modulation = stages.deliveredModulation() / 256.0;
+    publishStage();
+  }
+}
+
+//FUNCTION: Controllers, probes, counters, health and the sensor schedule, called from loop()
+void EcvCore::loop() {
+  //Report the time to a consistent state after (re)connect
+  bootstrapReport();
+
+  //PID modulation controller
+  modulationControl();
+
+  //Broker round-trip probe and control path timeout
+  probeProcess();
+  controlPathTimeout();
+
+  //Heap and stack health
+  healthProcess();
+
+  //Operating counters
+  countersProcess();
+
+  //Read temperature every 5 seconds
+  unsigned long now = clock.millis();
+  if (millis_since(now, last_temp) > 5000) {
+    readTemperature();
+
+    //Publish the boiler returntemperature to MQTT [ecv/thermostat/returntemp]
+    char value[32];
+    publishMessage("ecv/thermostat/returntemp", format_float(value, return_temp, 2), mqtt_retain_state == 1);
+
+    //Reset timer
+    last_temp = clock.millis();
+  }
+}
+
+
+
+//---------------------------------------------OpenTherm PROTOCOL ENGINE--------------------------------------------------------
+//FUNCTION: Print the status bits of ID 0 or 3 to the serial monitor, bit 7 first, called from processRequest()
+void EcvCore::printStatusBits(int group, const int* status) {
+  char name[48];
+  for (int bit = 7; bit >= 0; bit--) {
+    debug.print("                                  - ");
+    debug.print(opentherm_bit_name(group, bit, name, sizeof(name)));
+    debug.print(status[bit]);
+    debug.println();
+  }
+}
+
+//OpenTherm process received data and send reply
+void EcvCore::processRequest(unsigned long request) {
+  ot.sendResponse(answerRequest(request, true));
+}
+
+//FUNCTION: Decode a request, publish it and return the reply frame, called from processRequest() for the bus and
+//from rawdataCommand() for an injected frame, which is answered on MQTT only and without the response time
+unsigned long EcvCore::answerRequest(unsigned long request, bool bus) {
+//DECODE the MESSAGE_TYPE and formulate a response
+  //Initialize variables
+  unsigned long msg_rx_ts     = clock.millis();
+  const char* l2f_message     = "NO_VALID_INPUT";
+  const char* f2l_message     = "NO_VALID_REPLY";
+  char f2l_hex                = '0';
+  char msg_description[OT_DESCRIPTION_SIZE] = "NO_VALID_DESCRIPTION";
+  int msg_type                = 0;
+  const char* pass            = "";
+  char msg_rw                 = 0;
+  char msg_heater[9];
+  char msg_thermostat[11];
+  char msg_id[3];
+  char msg_value[32]          = "";
+  char msg_value_hex[12]      = "";
+  char msg_value_leader[9]    = "";
+  char msg_value_follower[9]  = "";
+  char msg_full[192];
+  char msg_compact[24];
+  char msg_pos[9];
+
+  double old_value            = 0;
+  double range_low            = 0;
+  double range_high           = 0;
+
+  //Init variables
+  f2l_parity                  = 0;
+
+  //Build incoming message into msg_heater, the lowercase hex digits are the positions msg_pos[i]
+  snprintf (msg_heater, sizeof(msg_heater), "%08lx", request & 0xFFFFFFFFUL);
+  strcpy(msg_pos, msg_heater);
+
+  //DEBUG_DEBUG: Print the decoded message
+  if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+    debug.print("Decoded message: ");
+    debug.print(msg_heater);
+    debug.println();
+  }
+
+  //Check the message type, the parity bit makes the uppercase A and B digits lowercase
+  if (msg_pos[0] == '0' || msg_pos[0] == '8') {l2f_message = "READ-DATA     ";}
+  if (msg_pos[0] == '1' || msg_pos[0] == '9') {l2f_message = "WRITE-DATA    ";}
+  if (msg_pos[0] == '2' || msg_pos[0] == 'A') {l2f_message = "INVALID-DATA  ";}
+  if (msg_pos[0] == '3' || msg_pos[0] == 'B') {l2f_message = "RESERVED      ";}
+
+  //DECODE the MESSAGE_IS and formulate a response
+  msg_id[0] = msg_pos[2]; msg_id[1] = msg_pos[3]; msg_id[2] = '\0';
+  //The rawdata text is only rendered for MQTT in the text format and for the serial monitor
+  bool rawdata_text = rawdata_format == 0 || ECV_LOG_ON(debug, ECV_LOG_MONITOR) || ECV_LOG_ON(debug, ECV_LOG_DEBUG);
+
+  //The description, data type, direction and range of the data-ID from flash, the parity adds the ones of the ID
+  OpenThermId info;
+  int data_id = (request >> 16) & 0xFF;
+  if (opentherm_id(data_id, info)) {
+    if (rawdata_text) {
+      strncpy_P(msg_description, info.description, sizeof(msg_description) - 1);
+      msg_description[sizeof(msg_description) - 1] = '\0';
+    }
+    msg_type   = info.type;
+    msg_rw     = info.rw;
+    f2l_parity = f2l_parity + __builtin_popcount(data_id);
+    range_low  = info.range_low;
+    range_high = info.range_high;
+  }
+
+  //The operating counters are read, a WRITE-DATA of 0 resets the counter
+  if (msg_type == OT_U16 && (msg_pos[0] == '1' || msg_pos[0] == '9')) {msg_rw = 'W';}
+
+  //Check the message type and set corresponding reply message type
+  if(msg_rw == 'R') {
+    f2l_message = "READ-ACK      "; f2l_hex = '4'; f2l_parity = f2l_parity + 1;
+  } else {
+    f2l_message = "WRITE-ACK     "; f2l_hex = '5'; f2l_parity = f2l_parity + 2;
+  }
+
+  //DEBUG_DEBUG: Print the received message ID and description to the serial monitor
+  if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+    debug.print("Decoded message ID:");
+    debug.print(msg_id);
+    debug.print(" with description:");
+    debug.print(msg_description);
+    debug.print(" parity count:");
+    debug.print(f2l_parity);
+    debug.println();
+  }
+
+  //DECODE message flag flag8/flag8, publish result on topic "ecv/thermostat" and send
+  if (msg_type == OT_FLAG8) {
+    char msg_leader[3] = { msg_pos[4], msg_pos[5], '\0' };
+    decodeFlagFlag8(msg_leader, msg_value_leader);
+
+    //Publish the received OpenTherm message with flag flag8/flag8 to MQTT
+    if (rawdata_text) {
+      snprintf (msg_full, sizeof(msg_full), "T-%s %s %s%s", msg_heater, l2f_message, msg_description, msg_value_leader);
+    }
+
+    //DEBUG_MONITOR: Print the OpenTherm incoming message to the serial monitor
+    if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+      debug.print(msg_full);
+      if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+        debug.print(" parity count:");
+        debug.print(f2l_parity);
+      }
+      debug.println();
+      //  Print message type 00 details
+      if (strcmp(msg_id, "00") == 0) {
+        printStatusBits(OT_BITS_LEADER_STATUS, leader_status);
+      }
+      // Print message type 03 details
+      if (strcmp(msg_id, "03") == 0) {
+        printStatusBits(OT_BITS_LEADER_CONFIG, leader_status);
+      }
+    }
+
+    //Set ch_enabled flag for MQTT modulation reporting
+    ch_enabled = leader_status[7];
+  }
+
+ //DECODE message flag flag8/u8, publish result on topic "ecv/thermostat/rawdata/rx" and send
+  if (msg_type == OT_U8) {
+    //Change the message type to DATA-INVALID and correct the parity
+    f2l_message = "DATA-INVALID  "; f2l_hex = '6'; f2l_parity = f2l_parity + 1;
+    //Set the leader status HB and LB to 0 and update parity
+    leader_status[7] = 0; leader_status[6] = 0; strcpy(msg_value, "00000000"); f2l_parity = f2l_parity + 0; strcpy(msg_value_leader, "00000000");
+
+    //Publish the received OpenTherm message with flag flag8/u8 to MQTT
+    if (rawdata_text) {
+      snprintf (msg_full, sizeof(msg_full), "T-%s %s %s %s", msg_heater, l2f_message, msg_description, msg_value_leader);
+    }
+
+    //DEBUG_MONITOR: Print the OpenTherm incoming message to the serial monitor
+    if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+      debug.print(msg_full);
+      if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+        debug.print(" parity count:");
+        debug.print(f2l_parity);
+      }
+      debug.println();
+    }
+  }
+
+  //DECODE message flag f8.8, publish result on topic "ecv/thermostat/rawdata/rx" and send
+  if (msg_type == OT_F88) {
+    decodeFlagF8(msg_pos + 4, msg_value);
+
+    //Publish the received OpenTherm message with flag f8.8 to MQTT
+    if (rawdata_text) {
+      snprintf (msg_full, sizeof(msg_full), "T-%s %s %s %s", msg_heater, l2f_message, msg_description, msg_value);
+    }
+
+    //DEBUG_MONITOR: Print the Opentherm received message to the serial monitor
+    if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+      debug.print(msg_full);
+      debug.println();
+    }
+  }
+
+  //DECODE message flag u16, publish result on topic "ecv/thermostat/rawdata/rx" and send
+  if (msg_type == OT_U16) {
+    snprintf (msg_value, sizeof(msg_value), "%lu", request & 0xFFFFUL);
+
+    //Publish the received OpenTherm message with flag u16 to MQTT
+    if (rawdata_text) {
+      snprintf (msg_full, sizeof(msg_full), "T-%s %s %s %s", msg_heater, l2f_message, msg_description, msg_value);
+    }
+
+    //DEBUG_MONITOR: Print the Opentherm received message to the serial monitor
+    if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+      debug.print(msg_full);
+      debug.println();
+    }
+  }
+
+  //Publish the received message to MQTT "ecv/thermostat/rawdata/rx", only the frame in the compact format
+  if (msg_type != 0) {
+    if (rawdata_format == 0) {
+      publishMessage("ecv/thermostat/rawdata/rx", msg_full);
+    } else {
+      snprintf (msg_compact, sizeof(msg_compact), "T-%s", msg_heater);
+      publishMessage("ecv/thermostat/rawdata/rx", msg_compact);
+    }
+  }
+
+  //ENCODE message flag flag8/flag8
+  for (int i=0; i<8; i++) {
+    msg_value_follower[i] = '0' + follower_status[i];
+  }
+  msg_value_follower[8] = '\0';
+
+  //ENCODE if message ID is 00 the follower status to msg_pos[7]
+  if (strcmp(msg_id, "00") == 0) {
+    //If no fault condition is present set the CH mode and flame status
+    if (follower_status[7] == 0 ) {
+      if (follower_status[6] == 0 && follower_status[4] == 0) {msg_pos[7] = '0'; f2l_parity = f2l_parity + 0;}
+      if (follower_status[6] == 1 && follower_status[4] == 0) {msg_pos[7] = '2'; f2l_parity = f2l_parity + 1;}
+      if (follower_status[6] == 0 && follower_status[4] == 1) {msg_pos[7] = '8'; f2l_parity = f2l_parity + 1;}
+      if (follower_status[6] == 1 && follower_status[4] == 1) {msg_pos[7] = 'A'; f2l_parity = f2l_parity + 2;}
+    } else{
+      //If fault condition is present set fault and switch off CH mode and flame status
+      msg_pos[7] = '1'; f2l_parity = f2l_parity + 1;
+    }
+  }
+
+  //ENCODE if message ID is 03 the follower status to msg_pos[4] and msg[5]
+  if (strcmp(msg_id, "03") == 0) {
+    //Correct the parity by subtracting the old leader parity
+    f2l_parity = f2l_parity - parity_correction;
+
+    //Set HARD defaults
+    leader_status[7] = 0; // DHW present
+    leader_status[6] = 1; // Modulating on/off
+    leader_status[5] = 0; // Cooling config
+    leader_status[4] = 0; // Instantaneous or not-specified storage tank
+    leader_status[3] = 0; // Leader low & pump control
+    leader_status[2] = 0; // CH2 present
+    leader_status[1] = 0; // Reserved
+    leader_status[0] = 0; // Reserved
+
+    // If DHW is present update bit 0 and set msg_pos[5] to the correct value
+    if (strcmp(DHW_mode, "1") == 0 ) {
+      leader_status[7] = 1; // DHW present
+      msg_pos[5] = '3'; f2l_parity = f2l_parity + 2;
+      strcpy(msg_value_leader, "00000011");
+    } else {
+      msg_pos[5] = '2'; f2l_parity = f2l_parity + 1;
+      strcpy(msg_value_leader, "00000010");
+    }
+
+    // msg_pos[4] permanently set to 0 as the software does not support Leader low & pump and CH2 present
+    msg_pos[4] = '0'; f2l_parity = f2l_parity + 0;
+  }
+
+  //CHECK if there are updated default or MQTT received values to report back to the ecv/thermostat/*
+  if (msg_type == OT_F88) {
+
+    //Check the ID 01 Control CH setpoint
+    if (strcmp(msg_id, "01") == 0) {
+      old_value = atof(msg_value);
+      //Setpoint for the PID modulation controller
+      control_ch_setpoint = atof(msg_value);
+    }
+
+    //Check the ID 16 Room setpoint
+    if (strcmp(msg_id, "10") == 0) {
+      old_value = atof(msg_value);
+      //Room setpoint for the heating curve
+      room_setpoint = atof(msg_value);
+    }
+
+    //Check the ID 17 Relative modulation level (Percent)
+    if (strcmp(msg_id, "11") == 0) {
+      //Compare the received value with the modulation delivered by the active heater stage
+      if (atof(msg_value) == delivered_modulation ) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, delivered_modulation, 2);
+      }
+    }
+
+   //Check the ID 18 Water pressure
+    if (strcmp(msg_id, "12") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == water_pressure_ch ) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, water_pressure_ch, 2);
+      }
+    }
+
+   //Check the ID 19 Water flow DHW
+    if (strcmp(msg_id, "13") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == water_flow_dhw ) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, water_flow_dhw, 2);
+      }
+    }
+
+ //Check the ID 25 Boiler flow temperature
+    if (strcmp(msg_id, "19") == 0){
+      //Check if a live temperature is available before using the MQTT provided temperature
+      if (heater_temp == 0) {
+        //Compare the received value with the default(MQTT update value)
+        if (atof(msg_value) == heater_flow_temperature ) {
+          old_value = atof(msg_value);
+        } else {
+          old_value = atof(msg_value);
+          format_float(msg_value, heater_flow_temperature, 2);
+        }
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, heater_temp, 2);
+      }
+      //Publish the boiler temperature to MQTT [ecv/thermostat/boilertemp]
+      char value[32];
+      publishMessage("ecv/thermostat/boilertemp", format_float(value, heater_temp, 2), mqtt_retain_state == 1);
+    }
+
+       //Check the ID 14 Max relative modulation
+    if (strcmp(msg_id, "0E") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == max_rel_modulation) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, max_rel_modulation, 2);
+      }
+    }
+
+    //Check the ID 24 Room temperature
+    if (strcmp(msg_id, "18") == 0) {
+      old_value = atof(msg_value);
+    }
+
+    //Check the ID 26 DHW Temperature
+    if (strcmp(msg_id, "1A") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == dhw_temperature ) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, dhw_temperature, 2);
+      }
+    }
+
+   //Check the ID 27 Outside temperature
+    if (strcmp(msg_id, "1B") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == outside_temperature ) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, outside_temperature, 2);
+      }
+    }
+
+ //Check the ID 28 Return water temperature
+    if (strcmp(msg_id, "1C") == 0){
+      //Check if a live temperature is available before using the MQTT provided temperature
+      if (return_temp == 0) {
+        //Compare the received value with the default(MQTT update value)
+        if (atof(msg_value) == return_water_temperature ) {
+          old_value = atof(msg_value);
+        } else {
+          old_value = atof(msg_value);
+          format_float(msg_value, return_water_temperature, 2);
+        }
+      } else {
+          old_value = atof(msg_value);
+          format_float(msg_value, return_temp, 2);
+      }
+      //Publish the boiler returntemperature to MQTT [ecv/thermostat/returntemp]
+      char value[32];
+      publishMessage("ecv/thermostat/returntemp", format_float(value, return_temp, 2), mqtt_retain_state == 1);
+    }
+
+ //Check the ID 56 DHW setpoint
+    if (strcmp(msg_id, "38") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == dhw_setpoint) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, dhw_setpoint, 2);
+      }
+    }
+
+    //Check the ID 57 Max CH Water setpoint
+    if (strcmp(msg_id, "39") == 0){
+      //Compare the received value with the default(MQTT update value)
+      if (atof(msg_value) == max_ch_water_setpoint) {
+        old_value = atof(msg_value);
+      } else {
+        old_value = atof(msg_value);
+        format_float(msg_value, max_ch_water_setpoint, 2);
+      }
+    }
+
+    //Convert the measurement value to Hex
+    encodeFlagF8(msg_value, msg_value_hex);
+
+    //Load the Hex result into the OpenTherm return message
+    memcpy(msg_pos + 4, msg_value_hex, 4);
+
+    //DEBUG_MONITOR: Result of value override
+    if (ECV_LOG_ON(debug, ECV_LOG_UPDATE)) {
+      if (old_value == atof(msg_value)) {
+        debug.print("Value of message type: ");
+        debug.print(msg_id);
+        debug.print(" did not change. The parity is: ");
+        debug.print(f2l_parity);
+        debug.println();
+      } else {
+        debug.print("Value of message type: ");
+        debug.print(msg_id);
+        debug.print(" was changed from: ");
+        debug.print(old_value);
+        debug.print(" to: ");
+        debug.print(msg_value);
+        debug.print(" and the parity is: ");
+        debug.print(f2l_parity);
+        debug.println();
+      }
+    }
+  }
+
+  //ENCODE message flag u16, the operating counters on ID 116 to 123
+  if (msg_type == OT_U16) {
+    int counter_id = strtol(msg_id, NULL, 16);
+    old_value = atof(msg_value);
+
+    //A write of 0 resets the counter
+    if (msg_rw == 'W' && old_value == 0) {
+      counters.resetOpenTherm(counter_id);
+    }
+    unsigned int counter_value = counters.openTherm(counter_id);
+    snprintf (msg_value, sizeof(msg_value), "%u", counter_value);
+
+    //Load the Hex result into the OpenTherm return message
+    encodeFlagU16(counter_value, msg_value_hex);
+    memcpy(msg_pos + 4, msg_value_hex, 4);
+  }
+
+  //CHECK if received measurement is within protocol range and update message type accordingly of other then message ID 0 & 5
+  if (strcmp(msg_id, "00") != 0 || strcmp(msg_id, "03") != 0 || strcmp(msg_id, "05") != 0 ) {
+    //Convert string to double
+    double range_test = atof(msg_value);
+    //Check against the range
+    if (range_test >= range_low && range_test <= range_high) {
+      pass = "Valid";
+    } else {
+      //If invalid change the message type and return value
+      pass = "Invalid"; f2l_message = "DATA-INVALID  "; f2l_hex = '6'; f2l_parity = f2l_parity + 1;
+      //Set the follower byte 3 & 4 and update parity
+      strcpy(msg_value, "0"); msg_pos[7] = '0'; msg_pos[6] = '0'; msg_pos[5] = '0'; msg_pos[4] = '0';
+    }
+
+    //DEBUG_RANGE: Print the resutl of checking if the measurement is in the pre-defined range
+    if (ECV_LOG_ON(debug, ECV_LOG_RANGE)) {
+      debug.print("Current measurment: ");
+      debug.print(range_test);
+      debug.print(" is being checked for range: ");
+      debug.print(range_low);
+      debug.print(" to: ");
+      debug.print(range_high);
+      debug.print(" and the result is: ");
+      debug.print(pass);
+      debug.println();
+    }
+  }
+
+  //DEBUG_CONVERT: Print the Opentherm encoded value to the serial monitor
+  if (ECV_LOG_ON(debug, ECV_LOG_CONVERT)) {
+    debug.print("Encode measurement value: ");
+    debug.print(msg_value);
+    debug.print(" to Hex: ");
+    debug.print(msg_value_hex);
+    debug.print(" with total parity count: ");
+    debug.print(f2l_parity);
+  }
+
+  //Publish the response to the OpenTherm message to MQTT
+  //Build the message type considering the parity
+  if ((f2l_parity & 1) == 0) {
+    msg_pos[0] = f2l_hex;
+    if (ECV_LOG_ON(debug, ECV_LOG_CONVERT)) {
+      debug.print(" Parity is EVEN.");
+      debug.println();
+    }
+  } else {
+    if (f2l_hex == '4') {msg_pos[0] = 'c';}
+    if (f2l_hex == '5') {msg_pos[0] = 'd';}
+    if (f2l_hex == '6') {msg_pos[0] = 'e';}
+    if (f2l_hex == '7') {msg_pos[0] = 'f';}
+    if (ECV_LOG_ON(debug, ECV_LOG_CONVERT)) {
+      debug.print(" Parity is UN-EVEN.");
+      debug.println();
+    }
+  }
+
+  //Build outgoing message type into msg_thermostat
+  snprintf (msg_thermostat, sizeof(msg_thermostat), "B-%s", msg_pos);
+
+  //Build the string for message type 00 and 03 else build all other message type strings
+  if (!rawdata_text) {
+    msg_full[0] = '\0';
+  } else if (strcmp(msg_id, "00") == 0 || strcmp(msg_id, "03") == 0) {
+    snprintf (msg_full, sizeof(msg_full), "%s %s %s%s %s", msg_thermostat, f2l_message, msg_description, msg_value_leader, msg_value_follower);
+  } else {
+    snprintf (msg_full, sizeof(msg_full), "%s %s %s %s", msg_thermostat, f2l_message, msg_description, msg_value);
+  }
+
+  //DEBUG_MONITOR: Print the OpenTherm response result to the serial monitor
+  if (ECV_LOG_ON(debug, ECV_LOG_MONITOR)) {
+    debug.print(msg_full);
+    if (ECV_LOG_ON(debug, ECV_LOG_DEBUG)) {
+      debug.print(" parity count:");
+      debug.print(f2l_parity);
+    }
+    debug.println();
+    if (strcmp(msg_id, "00") == 0) {
+      printStatusBits(OT_BITS_FOLLOWER_STATUS, follower_status);
+    }
+    if (strcmp(msg_id, "03") == 0) {
+      printStatusBits(OT_BITS_LEADER_CONFIG, leader_status);
+    }
+  }
+
+  //Delay pre-set ms to meet protocol requirements
+  unsigned long now = clock.millis();
+  if (bus && millis_since(now, msg_rx_ts) < timing) {
+    clock.wait(timing - millis_since(now, msg_rx_ts));
+    now = clock.millis();
+  }
+
+  //Publish the received message to MQTT [ecv/thermostat/rawdata/tx], the frame and the reply time in ms in the compact format
+  if (rawdata_format == 0) {
+    size_t msg_length = strlen(msg_full);
+    snprintf (msg_full + msg_length, sizeof(msg_full) - msg_length, " Replied after: %lums.", millis_since(now, msg_rx_ts));
+    publishMessage("ecv/thermostat/rawdata/tx", msg_full);
+  } else {
+    snprintf (msg_compact, sizeof(msg_compact), "%s %lu", msg_thermostat, millis_since(now, msg_rx_ts));
+    publishMessage("ecv/thermostat/rawdata/tx", msg_compact);
+  }
+
+  //Publish CH requested to MQTT [ecv/thermostat/ch_requested]
+  if ( ch_enabled != ch_enabled_history ) {
+    ch_enabled_history = ch_enabled;
+    //Start timing the control path, a transition that is still waiting is superseded
+    if (control_waiting != 0) { controlPathReport("SUPERSEDED"); }
+    controlPathStart(ch_enabled);
+    publishMessage("ecv/thermostat/ch_requested", ch_enabled == 1 ? "1" : "0", mqtt_retain_state == 1);
+  } else {
+    //Send MQTT Message every 60 sec if no change
+    unsigned long now = clock.millis();
+    if (millis_since(now, last_ch_update) > 60000) {
+      publishMessage("ecv/thermostat/ch_requested", ch_enabled == 1 ? "1" : "0", mqtt_retain_state == 1);
+      last_ch_update = clock.millis();
+    }
+  }
+
+  //Publish the CH Setpoint to MQTT [ecv/thermostat/ch_setpoint]
+  if (strcmp(msg_id, "01") == 0) {
+    publishMessage("ecv/thermostat/ch_setpoint", msg_value, mqtt_retain_state == 1);
+  }
+
+  //Publish the modulation level to MQTT [ecv/thermostat/modulation]
+  if (strcmp(msg_id, "11") == 0) {
+    publishMessage("ecv/thermostat/modulation", msg_value, mqtt_retain_state == 1);
+  }
+
+  //Convert response from Hex to Dec, the encoded digits are upper and lowercase
+  unsigned long dec_val = 0;
+  for (int i = 0; i < 8; i++) {
+    char c = msg_pos[i];
+    if (c >= '0' && c <= '9') { dec_val = (dec_val << 4) | (c - '0'); }
+    else if (c >= 'a' && c <= 'f') { dec_val = (dec_val << 4) | (c - 'a' + 10); }
+    else if (c >= 'A' && c <= 'F') { dec_val = (dec_val << 4) | (c - 'A' + 10); }
+  }
+
+  f2l_reply = dec_val;
+  return dec_val;
+}
@@ -0,0 +1,274 @@
+//E-CV core of the OT-Simulator
+//
+//The OpenTherm follower protocol, the modulation control and the MQTT telemetry of the E-CV, without any
+//dependency on the ESP8266. The platform is reached through the interfaces of hal.h and drives the core:
+// - processRequest() with every OpenTherm request frame, the reply goes out through OpenThermLink
+// - callback() with every MQTT message on the subscribed topics
+// - mqttConnected() after every (re)connect to the broker, publishes the birth message and subscribes
+// - loop() from the main loop, runs the controllers, the probes, the counters, the heap and stack health and reads
+//   the sensors
+//All state lives in the instance, the settings below are the defaults that MQTT messages update.
+
+#ifndef ECV_CORE_H
+#define ECV_CORE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "debug_log.h"
+#include "latency_stats.h"
+#include "pid_controller.h"
+#include "heater_stages.h"
+#include "stage_selector.h"
+#include "stage_dither.h"
+#include "heating_curve.h"
+#include "feed_forward.h"
+#include "relay_autotune.h"
+#include "operating_counters.h"
+#include "system_health.h"
+
+//Setup message buffer size
+#define MSG_BUFFER_SIZE (110)
+
+//Max frames of one ecv/rawdata/command message, the PubSubClient packet of 256 bytes holds 16 frames in hex
+#define RAWDATA_BATCH_MAX (16)
+
+class EcvCore {
+  public:
+    EcvCore(Clock& clock, OpenThermLink& ot, MqttLink& mqtt, TemperatureSensors& sensors, Storage& storage, DebugOutput& debug,
+      SystemMonitor& system);
+
+    //Init the controllers, restore the operating counters and the follower status, called from setup()
+    void begin();
+    //Decode an OpenTherm request frame and send the reply
+    void processRequest(unsigned long request);
+    //Handle an MQTT message, the payload is not null terminated
+    void callback(const char* topic, const uint8_t* payload, unsigned int length);
+    //Publish the birth message and subscribe after a successful connect
+    void mqttConnected();
+    //Controllers, probes, counters, health and the sensor schedule, called from loop()
+    void loop();
+
+    //The operating counters as JSON for the HTTP page /counters
+    const char* countersFormat();
+
+    //OpenTherm message codec, the values are exchanged as text like the messages on MQTT. They
+    //update f2l_parity of the reply being built, public for the benchmarks of the native build
+    void decodeFlagFlag8(const char* msg_value, char* result);
+    void decodeFlagF8(const char* msg_value, char* result);
+    void encodeFlagF8(const char* msg_value, char* result);
+    void encodeFlagU16(unsigned int value, char* result);
+
+    //Openterm Leader Follower response timing (Min. 20ms - max. 800ms)
+    unsigned int timing       = 250; // Default timing is 25ms
+
+    //MQTT session settings
+    int mqtt_retain_state          = 1;         // Default = 1, publish the ecv/thermostat/* state retained so a (re)connecting OpenHAB starts consistent
+    unsigned long bootstrap_window = 10000;     // Default = 10s, max time to wait for the retained values after connect before reporting
+    int rawdata_format             = 0;         // Default = 0, rawdata/rx and tx as text, 1 compact frames rendered by the reader, updated with MQTT topic [ecv/command/rawdata_format]
+
+    //ECV STATUS SETTINGS - Default can be adjusted with MQTT message
+    const char* fault_indication = "0";         // Default = 0, updated with MQTT topic [ecv/status/fault]
+    const char* CH_mode = "0";                  // Default = 0, updated with MQTT topic [ecv/status/ch_mode]
+    const char* flame_status = "0";             // Default = 0, updated with MQTT topic [ecv/status/flame]
+    const char* DHW_mode = "0";                 // Default = 0, if DHW is present change to 1
+    const char* cooling_status = "0";           // Default = 0, no support in this software version for cooling status
+    const char* CH2_mode = "0";                 // Default = 0, no support in this software version for CH2 mode
+    const char* diagnostic = "0";               // Default = 0, no support in this software version for diagnostics
+    const char* msg_0_bit_7 = "0";              // Reserved
+
+    //ECV COMMAND SETTINGS - Default can be adjusted with MQTT message
+    double max_rel_modulation = 100;            // Default = 100, updated with MQTT topic [ecv/command/max_rel_modulation]
+    double max_ch_water_setpoint = 70;          // Default =  70, updated with MQTT topic [ecv/command/max_ch_water_setpoint]
+    double dhw_setpoint = 65;                   // Default =  65, updated with MQTT topic [ecv/command/dhw_setpoint]
+
+    //ECV SENSORS SETTINGS - Default can be adjusted with MQTT message
+    double water_pressure_ch = 2.00;            // Default =  2, updated with MQTT topic [ecv/sensors/water_pressure_ch]
+    double outside_temperature = 0.00;          // Default =  0, updated with MQTT topic [ecv/sensors/outside_temperature]
+    double heater_flow_temperature = 0.00;      // Default =  0, updated with MQTT topic [ecv/sensors/heater_flow_temperature]
+    double return_water_temperature = 0.00;     // Default =  0, updated with MQTT topic [ecv/sensors/return_water_temperature]
+    double water_flow_dhw = 0.00;               // Default =  0, updated with MQTT topic [ecv/sensors/water_flow_dhw]
+    double dhw_temperature = 0.00;              // Default =  0, updated with MQTT topic [ecv/sensors/dhw_temperature]
+
+    //PID MODULATION CONTROLLER SETTINGS - Default can be adjusted with MQTT message
+    double pid_kp                 = 5.00;       // Default = 5 %/C, updated with MQTT topic [ecv/command/pid_kp]
+    double pid_ki                 = 0.02;       // Default = 0.02 %/(C*s), integral time 250s, updated with MQTT topic [ecv/command/pid_ki]
+    double pid_kd                 = 0.00;       // Default = 0 %*s/C, updated with MQTT topic [ecv/command/pid_kd]
+    unsigned long pid_sample_time = 5000;       // Default = 5s, same as the 1-Wire read interval, updated with MQTT topic [ecv/command/pid_sample_time]
+    double pid_out_min            = 0.00;       // Default = 0%, updated with MQTT topic [ecv/command/pid_out_min]
+    double pid_out_max            = 100.00;     // Default = 100%, updated with MQTT topic [ecv/command/pid_out_max]
+
+    //HEATING CURVE SETTINGS - Default can be adjusted with MQTT message
+    int heating_curve_mode             = 0;     // Default = 0, control setpoint from the thermostat (ID 1), 1 = heating curve from the outside temperature, updated with MQTT topic [ecv/command/heating_curve]
+    double heating_curve_slope         = 1.20;  // Default = 1.2, updated with MQTT topic [ecv/command/heating_curve_slope]
+    double heating_curve_shift         = 0.00;  // Default = 0 C parallel shift, updated with MQTT topic [ecv/command/heating_curve_shift]
+    double heating_curve_room          = 2.00;  // Default = 2 C flow per C room setpoint (ID 16) above 20 C, updated with MQTT topic [ecv/command/heating_curve_room]
+    double heating_curve_min_flow      = 20.00; // Default = 20 C minimum flow temperature target
+
+    //FEED-FORWARD SETTINGS - Default can be adjusted with MQTT message
+    double ff_gain                = 0.25;       // Default = 0.25, share of the estimated heat demand added to the PID output, 0 = off, updated with MQTT topic [ecv/command/ff_gain]
+    double ff_flow_rate           = 10.00;      // Default = 10 l/min estimated CH pump flow, updated with MQTT topic [ecv/command/ff_flow_rate]
+    unsigned long ff_filter_time  = 60000;      // Default = 60s filter time constant against return sensor noise, updated with MQTT topic [ecv/command/ff_filter_time]
+
+    //HEATER STAGE SELECTION SETTINGS - Default can be adjusted with MQTT message
+    int stage_hysteresis          = 25;         // Default = 25% of the gap between two stages, updated with MQTT topic [ecv/command/stage_hysteresis]
+    unsigned long stage_min_dwell = 60000;      // Default = 60s in a stage before the next change, updated with MQTT topic [ecv/command/stage_min_dwell]
+    unsigned long stage_min_on    = 180000;     // Default = 180s on before switching off, updated with MQTT topic [ecv/command/stage_min_on]
+    unsigned long stage_min_off   = 180000;     // Default = 180s off before switching on (anti-short-cycle), updated with MQTT topic [ecv/command/stage_min_off]
+    unsigned long stage_period    = 300000;     // Default = 5min time-proportioning period between two stages, 0 = nearest stage, updated with MQTT topic [ecv/command/stage_period]
+    unsigned long stage_min_slot  = 60000;      // Default = 60s minimum time in a stage within a period, updated with MQTT topic [ecv/command/stage_min_slot]
+
+    //AUTO-TUNE SETTINGS - Default can be adjusted with MQTT message
+    double autotune_low           = 0.00;       // Default = 0%, relay low modulation, updated with MQTT topic [ecv/command/autotune_low]
+    double autotune_high          = 100.00;     // Default = 100%, relay high modulation, updated with MQTT topic [ecv/command/autotune_high]
+    double autotune_hysteresis    = 0.50;       // Default = 0.5 C band around the flow target, updated with MQTT topic [ecv/command/autotune_hysteresis]
+    int autotune_cycles           = 3;          // Default = 3 cycles averaged after the first one, updated with MQTT topic [ecv/command/autotune_cycles]
+    int autotune_rule             = 0;          // Default = 0, PI, 1 = PID, updated with MQTT topic [ecv/command/autotune_rule]
+
+    //OPERATING COUNTER SETTINGS - Default can be adjusted with MQTT message
+    unsigned long counters_save_interval    = 900000;  // Default = 15min between writes of changed counters to flash, updated with MQTT topic [ecv/command/counters_save_interval]
+    unsigned long counters_publish_interval = 60000;   // Default = 60s between publishing the counters on [ecv/counters/*]
+
+    //LATENCY PROBE SETTINGS - Default can be adjusted with MQTT message
+    unsigned long probe_interval  = 10000;      // Default = 10s, ping interval on [ecv/probe/ping], 0 disables the probe, updated with MQTT topic [ecv/command/probe_interval]
+    int probe_report_every        = 6;          // Default =  6, publish the RTT percentiles after every 6 pings
+    unsigned long control_timeout = 120000;     // Default = 120s, max wait for ch_mode and flame after a ch_requested transition
+
+    //SYSTEM HEALTH SETTINGS - Default can be adjusted with MQTT message
+    unsigned long health_interval = 10000;      // Default = 10s between heap and stack samples, 0 disables them, updated with MQTT topic [ecv/command/health_interval]
+    int health_report_every       = 6;          // Default =  6, publish the worst values on [ecv/system/health] after every 6 samples
+    SystemStats health_limits     = { 8192, 4096, 50, 512 };  // Default = alert on [ecv/system/alert] below 8 KB free heap, 4 KB largest block, 512 bytes stack or above 50 % fragmentation
+
+    //DEBUG MESSAGE SETTING - Channels of debug_log.h, the mask can be adjusted with MQTT message
+    DebugLog debug;                             // Default = ECV_LOG_MASK, updated with MQTT topic [ecv/command/debug]
+
+    //Internal program variables, read by the platform and the host tools
+    float heater_temp = 0, return_temp = 0;
+    unsigned long last_temp;
+    unsigned long last_ch_update;
+
+    char msg[MSG_BUFFER_SIZE];
+
+    //OpenTherm message ID 0 HB and LB variables
+    int leader_status[8]   = {0,0,0,0,0,0,0,0};
+    int follower_status[8] = {0,0,0,0,0,0,0,0};
+
+    //OpenTherm reply message bit parity counter
+    int f2l_parity          = 0;   // Parity counter
+    int parity_correction   = 0;   // Parity correction for message ID 03
+    unsigned long f2l_reply = 0;   // Last reply frame
+
+    //Frames injected on ecv/rawdata/command
+    unsigned long rawdata_frames   = 0;
+    unsigned long rawdata_rejected = 0;         // Messages that are not a batch of frames
+
+    //MQTT topics with a retained value that are needed for a consistent state after (re)connect
+    static const char* const bootstrap_topics[];
+    static const int bootstrap_topic_count;
+    unsigned long bootstrap_received = 0;       // One bit per bootstrap topic received since the last connect
+    unsigned long bootstrap_start    = 0;       // Timestamp of the last successful connect
+    int bootstrap_active             = 0;       // Set to 1 while waiting for the retained values
+
+    //MQTT topics of one-shot commands, subscribed with QoS 0 and cleared on the broker after acting, not
+    //consumed as retained state
+    static const char* const oneshot_topics[];
+    static const int oneshot_topic_count;
+
+    //Broker round-trip latency probe
+    LatencyStats probe_rtt;
+    unsigned long probe_seq          = 0;       // Sequence number of the last ping sent
+    unsigned long probe_seq_received = 0;       // Sequence number of the last ping received back
+    unsigned long probe_lost         = 0;       // Pings not received back since the last report
+    unsigned long last_probe         = 0;       // Timestamp of the last ping sent
+    int probe_since_report           = 0;       // Pings sent since the last report
+
+    //Heap and stack health, sampled every health_interval
+    SystemHealth health;
+    unsigned long last_health        = 0;       // Timestamp of the last sample
+    int health_alerts_published      = -1;      // Alerts of the last [ecv/system/alert], -1 before the first sample
+
+    //Control path timing from a ch_requested transition to the ch_mode and flame status arriving back
+    LatencyStats control_rtt;
+    unsigned long control_id         = 0;       // Correlation ID of the last ch_requested transition
+    unsigned long control_start      = 0;       // Timestamp of the last ch_requested transition
+    unsigned long control_ch_mode_ms = 0;       // Time until ecv/status/ch_mode matched the transition
+    unsigned long control_flame_ms   = 0;       // Time until ecv/status/flame matched the transition
+    int control_value                = 0;       // Requested CH value of the transition
+    int control_waiting              = 0;       // Bit 0 waiting for ch_mode, bit 1 waiting for flame
+
+    //Flag for MQTT modulation reporting
+    int ch_enabled          = 0;
+    int ch_enabled_history  = 0;
+
+    //Variables for modulation level
+    double set_modulation      =  0.00;
+    double control_ch_setpoint =  0.00;
+    double room_setpoint       = 20.00;         // Room setpoint from the thermostat (ID 16)
+    double flow_target         =  0.00;         // Flow temperature target of the PID controller
+    double temp_difference     =  0.00;
+
+    //PID modulation controller, runs on its own sample time from loop()
+    PidController pid;
+
+    //Weather-compensated heating curve, replaces the control setpoint with heating_curve_mode = 1
+    HeatingCurve curve;
+
+    //Feed-forward of the heat demand from the return temperature, added to the PID output
+    FeedForward feed_forward;
+    double heat_delivered = 0.00;
+
+    //Relay auto-tune of the PID gains, replaces the controller while it runs
+    RelayAutoTune autotune;
+    int autotune_request = 0;
+    int autotune_cycle   = 0;
+
+    //Operating counters, answered on ID 116 to 123 and persisted alternately in two records in the storage
+    OperatingCounters counters;
+    static const char* const counter_files[2];
+    static const char* const stage_files[2];    // Switch counts of the heater stages, same sequence as the counters
+    unsigned long saved_stage_switches  = 0;    // Stage switches in the last record
+    int counters_mounted                = 0;
+    unsigned long last_counters_save    = 0;
+    unsigned long last_counters_publish = 0;
+    char counters_json[320];
+
+    //Heater stage selection, the delivered modulation of the active stage is reported on ID 17
+    StageSelector stages;
+    StageDither dither;
+    double delivered_modulation = 0.00;
+
+  private:
+    //Copy into msg and publish, a text beyond MSG_BUFFER_SIZE is cut off
+    void publishMessage(const char* topic, const char* text, bool retained = false);
+
+    void bootstrapMark(const char* topic);
+    void bootstrapReport();
+    int oneShotIndex(const char* topic);
+    void probeProcess();
+    void probeReceived(const char* value);
+    void healthProcess();
+    void rawdataCommand(const uint8_t* payload, unsigned int length);
+    unsigned long answerRequest(unsigned long request, bool bus);
+    void printStatusBits(int group, const int* status);
+    void controlPathStart(int value);
+    void controlPathReport(const char* result);
+    void controlPathStatus(int waiting_bit, int value);
+    void controlPathTimeout();
+    void publishAutotune();
+    void countersLoad();
+    void countersSave();
+    void publishCounters();
+    void countersProcess();
+    void readTemperature();
+    void publishStage();
+    void publishSchedule();
+    void modulationControl();
+
+    Clock& clock;
+    OpenThermLink& ot;
+    MqttLink& mqtt;
+    TemperatureSensors& sensors;
+    Storage& storage;
+    SystemMonitor& system;
+};
+
+#endif
@@ -0,0 +1,65 @@
+//Feed-forward of the heat demand for the OT-Simulator, see feed_forward.h
+
+#include "hal.h"
+#include "feed_forward.h"
+#include "heater_stages.h"
+
+FeedForward::FeedForward() {
+  setFlowRate(10.0);
+  setGain(0.25);
+  filter_time = 60000;
+  reset();
+}
+
+void FeedForward::setFilterTime(unsigned long ms) {
+  filter_time = ms;
+}
+
+void FeedForward::reset() {
+  filtered = 0;
+  last_output = 0;
+  last_update = 0;
+  started = false;
+}
+
+void FeedForward::setFlowRate(double l_min) {
+  if (l_min < 0) { return; }
+  flow_capacity = (int32_t)(l_min / 60.0 * 4186.0 + 0.5);
+}
+
+void FeedForward::setGain(double new_gain) {
+  if (new_gain < 0) { return; }
+  gain = (int32_t)(new_gain * 256);
+}
+
+int32_t FeedForward::modulation(int32_t target, int32_t return_temperature) const {
+  int32_t difference = target - return_temperature;
+  if (difference <= 0 || gain == 0) { return 0; }
+
+  //f8.8 C * W/K gives f8.8 W, as share of the maximum heater power in f8.8 percent
+  int64_t power = (int64_t)difference * flow_capacity;
+  int64_t result = power * 100 / HEATER_MAX_POWER * gain >> 8;
+  if (result > 100 * 256) { result = 100 * 256; }
+  return (int32_t)result;
+}
+
+int32_t FeedForward::update(unsigned long now, int32_t target, int32_t return_temperature) {
+  int64_t raw = (int64_t)return_temperature << 16;
+  if (!started || filter_time == 0) {
+    filtered = raw;
+  } else {
+    //First order filter, the time since the last update as share of the time constant
+    unsigned long elapsed = millis_since(now, last_update);
+    filtered += (raw - filtered) * (int64_t)elapsed / (int64_t)(filter_time + elapsed);
+  }
+  last_update = now;
+  started = true;
+  last_output = modulation(target, (int32_t)(filtered >> 16));
+  return last_output;
+}
+
+int32_t FeedForward::heat(int32_t flow_temperature, int32_t return_temperature) const {
+  int32_t difference = flow_temperature - return_temperature;
+  if (difference <= 0) { return 0; }
+  return (int32_t)((int64_t)difference * flow_capacity >> 8);
+}
@@ -0,0 +1,52 @@
+//Feed-forward of the heat demand for the OT-Simulator
+//
+//The power needed to bring the return water to the flow temperature target is
+//  P = (target - return) * flow * c
+//with the pump flow rate as estimate of the flow. As modulation of the 9kW heater this is added to the PID
+//output, so the controller reacts to a setpoint or load change without waiting for the error to integrate.
+//The return sensor is quantized and follows every heater stage change, so the return temperature is low-pass filtered
+//before it is used; otherwise it would move the output across the stage hysteresis on sensor noise. The target is
+//not filtered, a setpoint change is fed forward at once.
+//The return is the flow minus the heat the radiators take, so (target - return) is the demand plus the flow error
+//times flow * c, about 7.7 %/C at 10 l/min. Fed forward in full that error term adds to the PID gain and the stages
+//switch more, a share of 0.25 settles faster with fewer stage changes on the plant model.
+//The same relation with the measured flow temperature gives the heat actually delivered to the radiators.
+
+#ifndef FEED_FORWARD_H
+#define FEED_FORWARD_H
+
+#include <stdint.h>
+
+class FeedForward {
+  public:
+    FeedForward();
+
+    //Estimated CH pump flow rate in l/min
+    void setFlowRate(double l_min);
+    //Share of the estimated demand that is fed forward, 0 switches the feed-forward off
+    void setGain(double gain);
+    //Time constant in ms of the first order filter on the return temperature, 0 switches the filter off
+    void setFilterTime(unsigned long ms);
+
+    //Feed-forward modulation in f8.8 percent for a flow target and return temperature in f8.8 C
+    int32_t modulation(int32_t target, int32_t return_temperature) const;
+    //Feed-forward modulation in f8.8 percent on the filtered return temperature
+    int32_t update(unsigned long now, int32_t target, int32_t return_temperature);
+    //Last feed-forward modulation in f8.8 percent
+    int32_t output() const { return last_output; }
+    //Restart the filter at the unfiltered return temperature on the next update
+    void reset();
+    //Heat in W carried by the flow for a flow and return temperature in f8.8 C
+    int32_t heat(int32_t flow_temperature, int32_t return_temperature) const;
+
+  private:
+    int32_t flow_capacity;        // W/K carried by the pump flow
+    int32_t gain;                 // f8.8
+    unsigned long filter_time;    // ms
+    int64_t filtered;             // Return temperature in f8.8 C << 16, keeps the filter moving on short update intervals
+    int32_t last_output;          // f8.8 percent
+    unsigned long last_update;
+    bool started;
+};
+
+#endif
@@ -0,0 +1,66 @@
+//Hardware abstraction of the E-CV core for the OT-Simulator, see hal.h
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+
+void DebugOutput::print(char c) {
+  char text[2] = { c, '\0' };
+  write(text);
+}
+
+void DebugOutput::print(long value) {
+  char text[24];
+  snprintf (text, sizeof(text), "%ld", value);
+  write(text);
+}
+
+void DebugOutput::print(unsigned long value) {
+  char text[24];
+  snprintf (text, sizeof(text), "%lu", value);
+  write(text);
+}
+
+void DebugOutput::print(double value, int decimals) {
+  char text[32];
+  write(format_float(text, value, decimals));
+}
+
+char* format_float(char* buffer, double value, unsigned char decimals) {
+  //The dtostrf() of the ESP8266 core: round half up on the last decimal and print the digits without printf
+  if (isnan(value)) { strcpy(buffer, "nan"); return buffer; }
+  if (isinf(value)) { strcpy(buffer, "inf"); return buffer; }
+  if (value > 1e15 || value < -1e15) { strcpy(buffer, "ovf"); return buffer; }
+  char* out = buffer;
+  if (value < 0.0) {
+    *out++ = '-';
+    value = -value;
+  }
+
+  double rounding = 2.0;
+  for (unsigned char i = 0; i < decimals; i++) { rounding *= 10.0; }
+  value += 1.0 / rounding;
+
+  double scale = 1.0;
+  int digits = 1;
+  while (value >= 10.0 * scale) {
+    scale *= 10.0;
+    digits++;
+  }
+  value /= scale;
+
+  while (digits-- > 0) {
+    int digit = (int)value;
+    value = (value - digit) * 10.0;
+    *out++ = '0' + digit;
+  }
+  if (decimals > 0) { *out++ = '.'; }
+  while (decimals-- > 0) {
+    int digit = (int)value;
+    value = (value - digit) * 10.0;
+    *out++ = '0' + digit;
+  }
+  *out = '\0';
+  return buffer;
+}
@@ -0,0 +1,114 @@
+//Hardware abstraction of the E-CV core for the OT-Simulator
+//
+//The protocol, control and telemetry logic in ecv_core.h only talks to the platform through these interfaces:
+// - Clock               time in ms and the reply delay of the OpenTherm response
+// - OpenThermLink       the reply frame to the OpenTherm adapter
+// - MqttLink            publish and subscribe on the broker
+// - TemperatureSensors  heater flow and return temperature (1-Wire or the plant model)
+// - Storage             small named records in flash
+// - DebugOutput         the serial monitor, with the print() formatting of the Arduino Print class
+// - SystemMonitor       free heap, fragmentation and stack high-water mark, and the reason of the last reset
+//src/main.cpp implements them on the ESP8266 and src/host on Linux, so the core runs unchanged on both.
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Constant tables in flash: on the ESP8266 a PROGMEM table does not take RAM and is read with the _P functions of
+//pgmspace.h, on other platforms it is normal read-only data
+#ifdef ARDUINO
+#include <pgmspace.h>
+#else
+#include <string.h>
+#define PROGMEM
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_ptr(address)  (*(const void* const*)(address))
+#endif
+
+class Clock {
+  public:
+    virtual ~Clock() {}
+    virtual unsigned long millis() = 0;
+    //Block for ms, used for the reply delay of the OpenTherm response
+    virtual void wait(unsigned long ms) = 0;
+};
+
+//Time in ms from since to now. millis() of the ESP8266 wraps after 49.7 days, the difference is taken modulo 2^32
+//so intervals across the wrap are right on a host with a 64-bit unsigned long as well.
+inline unsigned long millis_since(unsigned long now, unsigned long since) { return (uint32_t)(now - since); }
+
+class OpenThermLink {
+  public:
+    virtual ~OpenThermLink() {}
+    virtual void sendResponse(unsigned long frame) = 0;
+};
+
+class MqttLink {
+  public:
+    virtual ~MqttLink() {}
+    virtual bool publish(const char* topic, const char* payload, bool retained = false) = 0;
+    virtual bool subscribe(const char* topic, int qos = 0) = 0;
+    virtual bool connected() = 0;
+};
+
+class TemperatureSensors {
+  public:
+    virtual ~TemperatureSensors() {}
+    //Read the heater flow and return temperature in C
+    virtual void read(float& flow, float& ret) = 0;
+    //Power in W of the active heater stage and the outside temperature, set before every read for sensors backed
+    //by a thermal model
+    virtual void heaterOutput(int power, double outside) { (void)power; (void)outside; }
+};
+
+class Storage {
+  public:
+    virtual ~Storage() {}
+    //Mount the storage, returns false if it can not be used
+    virtual bool begin() = 0;
+    //Read or write a complete record, returns false if the record was not read or written completely
+    virtual bool read(const char* name, void* data, size_t length) = 0;
+    virtual bool write(const char* name, const void* data, size_t length) = 0;
+};
+
+class DebugOutput {
+  public:
+    virtual ~DebugOutput() {}
+    virtual void write(const char* text) = 0;
+
+    void print(const char* text) { write(text); }
+    void print(char c);
+    void print(int value)           { print((long)value); }
+    void print(unsigned int value)  { print((unsigned long)value); }
+    void print(long value);
+    void print(unsigned long value);
+    //Fixed number of decimals, 2 by default like Serial.print()
+    void print(double value, int decimals = 2);
+    void println() { write("\r\n"); }
+};
+
+//Heap and stack of the platform in bytes, fragmentation in % of the free heap that is not in the largest block
+struct SystemStats {
+  unsigned long free_heap;
+  unsigned long max_free_block;
+  int fragmentation;
+  unsigned long stack_free;             // Stack never used since the start, from the painted stack
+};
+
+class SystemMonitor {
+  public:
+    virtual ~SystemMonitor() {}
+    virtual void read(SystemStats& stats) = 0;
+    //Reason of the last reset as text, e.g. "Exception" or "Software Watchdog" on the ESP8266
+    virtual const char* resetReason() = 0;
+};
+
+//Format a value with a fixed number of decimals, same result as String(value, decimals) on the ESP8266. The
+//buffer needs 18 characters plus the decimals, values beyond 1e15 are formatted as "ovf".
+char* format_float(char* buffer, double value, unsigned char decimals);
+
+#endif
@@ -0,0 +1,26 @@
+//Heater power stages of the E-CV, see heater_stages.h
+
+#include "heater_stages.h"
+
+const int heater_stage_power[HEATER_STAGES + 1] = {0, 1000, 1500, 2000, 3000, 4500, 6000, 9000};
+const uint8_t heater_stage_ssrs[HEATER_STAGES + 1] = {0x00, 0x63, 0x2E, 0x5E, 0x13, 0x57, 0x1B, 0x7B};
+
+int32_t heater_stage_modulation(int stage) {
+  if (stage < 0) { stage = 0; }
+  if (stage > HEATER_STAGES) { stage = HEATER_STAGES; }
+  return (int32_t)heater_stage_power[stage] * 100 * 256 / HEATER_MAX_POWER;
+}
+
+int heater_stage_nearest(int32_t modulation) {
+  int nearest = 0;
+  int32_t nearest_difference = modulation < 0 ? -modulation : modulation;
+  for (int stage = 1; stage <= HEATER_STAGES; stage++) {
+    int32_t difference = modulation - heater_stage_modulation(stage);
+    if (difference < 0) { difference = -difference; }
+    if (difference < nearest_difference) {
+      nearest = stage;
+      nearest_difference = difference;
+    }
+  }
+  return nearest;
+}
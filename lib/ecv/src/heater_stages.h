@@ -0,0 +1,41 @@
+//Heater power stages of the E-CV
+//
+//The Mini Europe+ has 3 equal 3kW coils. The SSRs switch them in series/parallel configurations to create
+//7 power levels, stage 0 is off:
+//  stage 1 - 3 coils in series                     1000W
+//  stage 2 - 2 coils in series                     1500W
+//  stage 3 - 2 parallel coils in series with 1     2000W
+//  stage 4 - 1 coil                                3000W
+//  stage 5 - 1 coil parallel to 2 in series        4500W
+//  stage 6 - 2 coils in parallel                   6000W
+//  stage 7 - 3 coils in parallel                   9000W
+//
+//The switch counts model the SSRs of the configurations, a coil starts at a and ends at b:
+//  SSR 1 - L to coil 1a                  SSR 5 - coil 1b to coil 2b
+//  SSR 2 - coil 2b to N                  SSR 6 - coil 1b to coil 3b
+//  SSR 3 - L to coil 3b                  SSR 7 - coil 2a to coil 3a
+//  SSR 4 - coil 1a to coil 2a
+//The 7 SSRs are the fewest that make all stages, per stage the closed ones are chosen for the fewest toggles
+//between adjacent stages. The count follows this wiring, adjust heater_stage_ssrs when OpenHAB switches another.
+
+#ifndef HEATER_STAGES_H
+#define HEATER_STAGES_H
+
+#include <stdint.h>
+
+#define HEATER_STAGES 7
+#define HEATER_COILS 3
+#define HEATER_SSRS 7
+#define HEATER_MAX_POWER 9000
+
+//Power in W per stage, index 0 is off
+extern const int heater_stage_power[HEATER_STAGES + 1];
+//Closed SSRs per stage, bit 0 is SSR 1, used to count the switching per SSR
+extern const uint8_t heater_stage_ssrs[HEATER_STAGES + 1];
+
+//Modulation in f8.8 percent that a stage delivers
+int32_t heater_stage_modulation(int stage);
+//Stage with the power nearest to a modulation in f8.8 percent
+int heater_stage_nearest(int32_t modulation);
+
+#endif
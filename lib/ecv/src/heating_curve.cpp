@@ -0,0 +1,66 @@
+//Weather-compensated heating curve for the OT-Simulator, see heating_curve.h
+
+#include "heating_curve.h"
+
+//Largest flow temperature in C of the int16_t f8.8 table
+#define CURVE_FLOW_RANGE 127.0
+
+HeatingCurve::HeatingCurve() {
+  shift          = 0;
+  room_influence = 2 * 256;
+  min_flow       = 20 * 256;
+  max_flow       = 70 * 256;
+  setSlope(1.2);
+}
+
+void HeatingCurve::setSlope(double new_slope) {
+  if (new_slope < 0 || new_slope > 4) { return; }
+  slope_set = new_slope;
+
+  //Floating-point math only here, once per slope change
+  for (int i = 0; i < CURVE_POINTS; i++) {
+    double d = (CURVE_OUTSIDE_MIN + i) - CURVE_DESIGN_ROOM;
+    double flow = CURVE_DESIGN_ROOM - new_slope * d * (1.4347 + 0.021 * d + 247.9e-6 * d * d);
+    //A steep slope passes the f8.8 range at the coldest points, the limits of flowTarget() cut it off anyway
+    if (flow > CURVE_FLOW_RANGE) { flow = CURVE_FLOW_RANGE; }
+    if (flow < -CURVE_FLOW_RANGE) { flow = -CURVE_FLOW_RANGE; }
+    table[i] = (int16_t)(flow * 256 + 0.5);
+  }
+}
+
+void HeatingCurve::setShift(double new_shift) {
+  shift = (int32_t)(new_shift * 256);
+}
+
+void HeatingCurve::setRoomInfluence(double influence) {
+  room_influence = (int32_t)(influence * 256);
+}
+
+void HeatingCurve::setLimits(double new_min, double new_max) {
+  if (new_min >= new_max) { return; }
+  min_flow = (int32_t)(new_min * 256);
+  max_flow = (int32_t)(new_max * 256);
+}
+
+int32_t HeatingCurve::flowTarget(int32_t outside, int32_t room_setpoint) const {
+  //Interpolate the table between the two 1C points around the outside temperature
+  int32_t position = outside - CURVE_OUTSIDE_MIN * 256;
+  int32_t flow;
+  if (position <= 0) {
+    flow = table[0];
+  } else if (position >= (CURVE_POINTS - 1) * 256) {
+    flow = table[CURVE_POINTS - 1];
+  } else {
+    int32_t index    = position >> 8;
+    int32_t fraction = position & 0xFF;
+    flow = table[index] + (((int32_t)table[index + 1] - table[index]) * fraction >> 8);
+  }
+
+  //Parallel shift and the room setpoint influence
+  flow += shift;
+  flow += room_influence * (room_setpoint - CURVE_DESIGN_ROOM * 256) >> 8;
+
+  if (flow < min_flow) { flow = min_flow; }
+  if (flow > max_flow) { flow = max_flow; }
+  return flow;
+}
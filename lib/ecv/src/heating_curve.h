@@ -0,0 +1,47 @@
+//Weather-compensated heating curve for the OT-Simulator
+//
+//The flow temperature target follows the outside temperature:
+//  flow = room + shift - slope * d * (1.4347 + 0.021 * d + 247.9e-6 * d^2), d = outside - room
+//for the design room temperature of 20C, plus room_influence times the deviation of the room setpoint (ID 16)
+//from 20C. The curve is calculated into a table with 1C steps from -30C to +30C when the slope changes, an
+//evaluation interpolates the table in f8.8 fixed point without floating-point math.
+
+#ifndef HEATING_CURVE_H
+#define HEATING_CURVE_H
+
+#include <stdint.h>
+
+#define CURVE_OUTSIDE_MIN -30
+#define CURVE_OUTSIDE_MAX  30
+#define CURVE_POINTS (CURVE_OUTSIDE_MAX - CURVE_OUTSIDE_MIN + 1)
+#define CURVE_DESIGN_ROOM  20
+
+class HeatingCurve {
+  public:
+    HeatingCurve();
+
+    //Set the slope and rebuild the table, typical 0.8 to 1.6 for radiators. A slope of 2.2 or more passes the f8.8
+    //range of the table at -30C, those points are held at 127C and cut off by the flow limits
+    void setSlope(double slope);
+    //Parallel shift of the curve in C
+    void setShift(double shift);
+    //Flow temperature change per C room setpoint deviation from 20C
+    void setRoomInfluence(double influence);
+    //Flow temperature limits in C
+    void setLimits(double min_flow, double max_flow);
+
+    //Flow temperature target in f8.8 C for the outside temperature and room setpoint in f8.8 C
+    int32_t flowTarget(int32_t outside, int32_t room_setpoint) const;
+
+    double slope() const { return slope_set; }
+
+  private:
+    int16_t table[CURVE_POINTS];     // Flow temperature in f8.8 C per 1C outside temperature, without shift
+    double slope_set;
+    int32_t shift;                   // f8.8 C
+    int32_t room_influence;          // f8.8 C per C
+    int32_t min_flow;                // f8.8 C
+    int32_t max_flow;                // f8.8 C
+};
+
+#endif
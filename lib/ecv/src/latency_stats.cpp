@@ -0,0 +1,52 @@
+//Latency statistics for the OT-Simulator, see latency_stats.h
+
+#include "latency_stats.h"
+
+LatencyStats::LatencyStats() {
+  clear();
+}
+
+void LatencyStats::add(unsigned long sample) {
+  samples[next] = sample;
+  next = (next + 1) % LATENCY_SAMPLES;
+  if (used < LATENCY_SAMPLES) { used++; }
+}
+
+void LatencyStats::clear() {
+  next = 0;
+  used = 0;
+}
+
+int LatencyStats::count() const {
+  return used;
+}
+
+unsigned long LatencyStats::percentile(int percent) const {
+  if (used == 0) { return 0; }
+  if (percent < 1) { percent = 1; }
+  if (percent > 100) { percent = 100; }
+
+  //Insertion sort a copy of the samples, the buffer is small
+  unsigned long sorted[LATENCY_SAMPLES];
+  for (int i = 0; i < used; i++) {
+    unsigned long sample = samples[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > sample) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = sample;
+  }
+
+  //Nearest-rank: the smallest sample with at least percent of the samples at or below it
+  int rank = (percent * used + 99) / 100;
+  return sorted[rank - 1];
+}
+
+unsigned long LatencyStats::maximum() const {
+  unsigned long result = 0;
+  for (int i = 0; i < used; i++) {
+    if (samples[i] > result) { result = samples[i]; }
+  }
+  return result;
+}
@@ -0,0 +1,32 @@
+//Latency statistics for the OT-Simulator
+//
+//Keeps the last LATENCY_SAMPLES round-trip times in a ring buffer and reports nearest-rank percentiles.
+//No heap is used, the percentile calculation sorts a copy of the samples on the stack.
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#define LATENCY_SAMPLES 32
+
+class LatencyStats {
+  public:
+    LatencyStats();
+
+    //Add a sample in ms, the oldest sample is dropped when the buffer is full
+    void add(unsigned long sample);
+    //Remove all samples
+    void clear();
+    //Number of samples in the buffer
+    int count() const;
+    //Nearest-rank percentile (1..100) of the samples in the buffer, 0 if empty
+    unsigned long percentile(int percent) const;
+    //Largest sample in the buffer, 0 if empty
+    unsigned long maximum() const;
+
+  private:
+    unsigned long samples[LATENCY_SAMPLES];
+    int next;
+    int used;
+};
+
+#endif
@@ -0,0 +1,185 @@
+//OpenTherm data-IDs of the E-CV, see opentherm_ids.h
+
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+#include "opentherm_ids.h"
+
+static const char id_0[]   PROGMEM = "Status flags: ";
+static const char id_1[]   PROGMEM = "Control setpoint CH water temperature (C): ";
+static const char id_3[]   PROGMEM = "Follower config flags and Leader MemberID code: ";
+static const char id_5[]   PROGMEM = "Application-specific and OEM fault flags: ";
+static const char id_14[]  PROGMEM = "Maximum relative modulation level setting (Percent): ";
+static const char id_16[]  PROGMEM = "Room setpoint: ";
+static const char id_17[]  PROGMEM = "Relative modulation level (Percent): ";
+static const char id_18[]  PROGMEM = "Water pressure in CH circuit (bar): ";
+static const char id_19[]  PROGMEM = "Water flow rate in DHW circuit (litres/minute): ";
+static const char id_24[]  PROGMEM = "Room temperature (C): ";
+static const char id_25[]  PROGMEM = "Boiler flow water temperature (C): ";
+static const char id_26[]  PROGMEM = "DHW temperature (C): ";
+static const char id_27[]  PROGMEM = "Outside temperature (C): ";
+static const char id_28[]  PROGMEM = "Return water temperature (C): ";
+static const char id_56[]  PROGMEM = "DHW setpoint (C): ";
+static const char id_57[]  PROGMEM = "Maximum CH water setpoint (C): ";
+static const char id_116[] PROGMEM = "Burner starts: ";
+static const char id_117[] PROGMEM = "CH pump starts: ";
+static const char id_118[] PROGMEM = "DHW pump/valve starts: ";
+static const char id_119[] PROGMEM = "DHW burner starts: ";
+static const char id_120[] PROGMEM = "Burner operation hours: ";
+static const char id_121[] PROGMEM = "CH pump operation hours: ";
+static const char id_122[] PROGMEM = "DHW pump/valve operation hours: ";
+static const char id_123[] PROGMEM = "DHW burner operation hours: ";
+
+//Ordered by data-ID
+static const OpenThermId opentherm_ids[] PROGMEM = {
+  {   0, OT_FLAG8, 'R',   0,     0, id_0   },
+  {   1, OT_F88,   'W',   0,   100, id_1   },
+  {   3, OT_FLAG8, 'R',   0,     0, id_3   },
+  {   5, OT_U8,    'R',   0,     0, id_5   },
+  {  14, OT_F88,   'W',   0,   100, id_14  },
+  {  16, OT_F88,   'W', -40,   127, id_16  },
+  {  17, OT_F88,   'R',   0,   100, id_17  },
+  {  18, OT_F88,   'R',   0,     5, id_18  },
+  {  19, OT_F88,   'R',   0,    16, id_19  },
+  {  24, OT_F88,   'W', -40,   127, id_24  },
+  {  25, OT_F88,   'R', -40,   127, id_25  },
+  {  26, OT_F88,   'R', -40,   127, id_26  },
+  {  27, OT_F88,   'R', -40,   127, id_27  },
+  {  28, OT_F88,   'R', -40,   127, id_28  },
+  {  56, OT_F88,   'R',   0,   127, id_56  },
+  {  57, OT_F88,   'R',   0,   127, id_57  },
+  { 116, OT_U16,   'R',   0, 65535, id_116 },
+  { 117, OT_U16,   'R',   0, 65535, id_117 },
+  { 118, OT_U16,   'R',   0, 65535, id_118 },
+  { 119, OT_U16,   'R',   0, 65535, id_119 },
+  { 120, OT_U16,   'R',   0, 65535, id_120 },
+  { 121, OT_U16,   'R',   0, 65535, id_121 },
+  { 122, OT_U16,   'R',   0, 65535, id_122 },
+  { 123, OT_U16,   'R',   0, 65535, id_123 },
+};
+
+static const int opentherm_id_count = sizeof(opentherm_ids) / sizeof(opentherm_ids[0]);
+
+//Status bits, bit 7 first, with the text of the serial monitor
+static const char bit_ls7[] PROGMEM = "CH  Enabled is: ";
+static const char bit_ls6[] PROGMEM = "DHW Enabled is: ";
+static const char bit_ls5[] PROGMEM = "Cooling enable: ";
+static const char bit_ls4[] PROGMEM = "OTC active: ";
+static const char bit_ls3[] PROGMEM = "CH2 enable: ";
+static const char bit_fs7[] PROGMEM = "Fault indication is: ";
+static const char bit_fs6[] PROGMEM = "CH Mode is: ";
+static const char bit_fs5[] PROGMEM = "DHW Mode: ";
+static const char bit_fs4[] PROGMEM = "Flame status is: ";
+static const char bit_fs3[] PROGMEM = "Cooling status: ";
+static const char bit_fs2[] PROGMEM = "CH2 mode: ";
+static const char bit_fs1[] PROGMEM = "Diagnostics indication: ";
+static const char bit_lc7[] PROGMEM = "DHW present: ";
+static const char bit_lc6[] PROGMEM = "Control type: ";
+static const char bit_lc5[] PROGMEM = "Cooling config: ";
+static const char bit_lc4[] PROGMEM = "DHW Config: ";
+static const char bit_lc3[] PROGMEM = "Leader low-off & pump control function: ";
+static const char bit_lc2[] PROGMEM = "CH2 present: ";
+static const char bit_reserved[] PROGMEM = "Reserved: ";
+
+static const char* const opentherm_bits[3][8] PROGMEM = {
+  { bit_ls7, bit_ls6, bit_ls5, bit_ls4, bit_ls3, bit_reserved, bit_reserved, bit_reserved },
+  { bit_fs7, bit_fs6, bit_fs5, bit_fs4, bit_fs3, bit_fs2, bit_fs1, bit_reserved },
+  { bit_lc7, bit_lc6, bit_lc5, bit_lc4, bit_lc3, bit_lc2, bit_reserved, bit_reserved },
+};
+
+//Message types of bit 30 to 28
+static const char type_0[] PROGMEM = "READ-DATA     ";
+static const char type_1[] PROGMEM = "WRITE-DATA    ";
+static const char type_2[] PROGMEM = "INVALID-DATA  ";
+static const char type_3[] PROGMEM = "RESERVED      ";
+static const char type_4[] PROGMEM = "READ-ACK      ";
+static const char type_5[] PROGMEM = "WRITE-ACK     ";
+static const char type_6[] PROGMEM = "DATA-INVALID  ";
+static const char type_7[] PROGMEM = "UNKNOWN-DATAID";
+
+static const char* const opentherm_types[8] PROGMEM = { type_0, type_1, type_2, type_3, type_4, type_5, type_6, type_7 };
+
+//Copy a string from flash, cut off at size
+static char* copy_P(char* buffer, const char* text, size_t size) {
+  strncpy_P(buffer, text, size - 1);
+  buffer[size - 1] = '\0';
+  return buffer;
+}
+
+bool opentherm_id(int id, OpenThermId& info) {
+  for (int i = 0; i < opentherm_id_count; i++) {
+    int entry = pgm_read_byte(&opentherm_ids[i].id);
+    if (entry < id) { continue; }
+    if (entry > id) { break; }
+    memcpy_P(&info, &opentherm_ids[i], sizeof(info));
+    return true;
+  }
+  return false;
+}
+
+char* opentherm_description(int id, char* buffer, size_t size) {
+  OpenThermId info;
+  if (!opentherm_id(id, info)) {
+    snprintf (buffer, size, "NO_VALID_DESCRIPTION");
+    return buffer;
+  }
+  return copy_P(buffer, info.description, size);
+}
+
+char* opentherm_bit_name(int group, int bit, char* buffer, size_t size) {
+  if (group < 0 || group > 2 || bit < 0 || bit > 7) { buffer[0] = '\0'; return buffer; }
+  return copy_P(buffer, (const char*)pgm_read_ptr(&opentherm_bits[group][7 - bit]), size);
+}
+
+char* opentherm_type_name(unsigned long frame, char* buffer, size_t size) {
+  return copy_P(buffer, (const char*)pgm_read_ptr(&opentherm_types[(frame >> 28) & 7]), size);
+}
+
+//The bits of a byte as 8 characters, bit 7 first
+static void format_bits(char* buffer, unsigned int value) {
+  for (int i = 0; i < 8; i++) { buffer[i] = (value & (0x80 >> i)) ? '1' : '0'; }
+  buffer[8] = '\0';
+}
+
+char* opentherm_render(unsigned long frame, char* buffer, size_t size) {
+  int id = (frame >> 16) & 0xFF;
+  unsigned int value = frame & 0xFFFF;
+  bool reply = (frame & 0x40000000UL) != 0;
+  char type[16];
+  char description[OT_DESCRIPTION_SIZE];
+  char text[32];
+  char bits[9];
+
+  opentherm_type_name(frame, type, sizeof(type));
+  opentherm_description(id, description, sizeof(description));
+  OpenThermId info;
+  if (!opentherm_id(id, info)) { info.type = 0; }
+
+  //The value as the rawdata text of processRequest() shows it, a DATA-INVALID reply shows 0 and an unknown ID none
+  if (reply && ((frame >> 28) & 7) == 6 && info.type != OT_FLAG8 && info.type != OT_U8) { info.type = OT_U16; value = 0; }
+  switch (info.type) {
+    case OT_U8:
+      format_bits(text, value >> 8);
+      break;
+    case OT_FLAG8:
+      format_bits(text, value >> 8);
+      if (reply) {
+        format_bits(bits, value & 0xFF);
+        snprintf (buffer, size, "%s %s%s %s", type, description, text, bits);
+      } else {
+        snprintf (buffer, size, "%s %s%s", type, description, text);
+      }
+      return buffer;
+    case OT_F88:
+      format_float(text, value / 256.0, 2);
+      break;
+    case OT_U16:
+      snprintf (text, sizeof(text), "%u", value);
+      break;
+    default:
+      text[0] = '\0';
+      break;
+  }
+  snprintf (buffer, size, "%s %s %s", type, description, text);
+  return buffer;
+}
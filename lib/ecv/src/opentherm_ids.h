@@ -0,0 +1,46 @@
+//OpenTherm data-IDs of the E-CV
+//
+//The description, data type, direction and range of every data-ID the E-CV answers, and the names of the status
+//bits of ID 0 and 3. The text lives in flash (PROGMEM) and is looked up by data-ID, it is only copied into RAM when
+//a message is rendered for a reader: the rawdata text on MQTT, the serial monitor or the decoder of the native build.
+
+#ifndef OPENTHERM_IDS_H
+#define OPENTHERM_IDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Data type of the value
+#define OT_FLAG8  1             // Two bytes of flags
+#define OT_U8     2             // Two bytes
+#define OT_F88    3             // Signed fixed point f8.8
+#define OT_U16    4             // Unsigned 16-bit
+
+//Status bit groups, the names of bit 7 to 0
+#define OT_BITS_LEADER_STATUS   0   // ID 0 high byte
+#define OT_BITS_FOLLOWER_STATUS 1   // ID 0 low byte
+#define OT_BITS_LEADER_CONFIG   2   // ID 3 high byte
+
+#define OT_DESCRIPTION_SIZE 64
+
+struct OpenThermId {
+  uint8_t id;
+  uint8_t type;                 // OT_*
+  char rw;                      // 'R' read by the thermostat, 'W' written
+  int32_t range_low;
+  int32_t range_high;
+  const char* description;      // In flash
+};
+
+//Copy the entry of a data-ID from flash, returns false for a data-ID the E-CV does not answer
+bool opentherm_id(int id, OpenThermId& info);
+//Copy the description of a data-ID into buffer (OT_DESCRIPTION_SIZE), "NO_VALID_DESCRIPTION" for an unknown ID
+char* opentherm_description(int id, char* buffer, size_t size);
+//Copy the name of a status bit into buffer
+char* opentherm_bit_name(int group, int bit, char* buffer, size_t size);
+//Name of the message type of a frame, padded to 14 characters like the rawdata text
+char* opentherm_type_name(unsigned long frame, char* buffer, size_t size);
+//Render a frame as the rawdata text without the "T-" or "B-" prefix: type, description and value
+char* opentherm_render(unsigned long frame, char* buffer, size_t size);
+
+#endif
@@ -0,0 +1,111 @@
+//Operating counters of the E-CV for the OT-Simulator, see operating_counters.h
+
+#include "hal.h"
+#include "operating_counters.h"
+
+OperatingCounters::OperatingCounters() {
+  sequence  = 0;
+  last_tick = 0;
+  started   = false;
+  for (int i = 0; i < COUNTERS; i++) { active[i] = false; }
+  active_power = 0;
+  resetAll();
+  changed = false;
+}
+
+void OperatingCounters::update(unsigned long now, bool flame, bool ch_mode, bool dhw_mode, int power) {
+  bool state[COUNTERS];
+  state[COUNTER_BURNER]     = flame;
+  state[COUNTER_CH_PUMP]    = ch_mode;
+  state[COUNTER_DHW_PUMP]   = dhw_mode;
+  state[COUNTER_DHW_BURNER] = flame && dhw_mode;
+
+  if (!started) {
+    started   = true;
+    last_tick = now;
+  }
+
+  //Integrate the whole ticks with the state and power of the last update, the part of a tick is carried to the next update
+  uint32_t ticks = millis_since(now, last_tick) / COUNTER_TICK;
+  if (ticks > 0) {
+    last_tick += ticks * COUNTER_TICK;
+    for (int i = 0; i < COUNTERS; i++) {
+      if (active[i]) { running[i] += ticks; changed = true; }
+    }
+    if (active[COUNTER_BURNER] && active_power > 0) {
+      energy_ws += (uint32_t)active_power * ticks;
+      energy_wh += energy_ws / 3600;
+      energy_ws  = energy_ws % 3600;
+    }
+  }
+
+  //A start is the transition to on
+  for (int i = 0; i < COUNTERS; i++) {
+    if (state[i] && !active[i]) { start_count[i]++; changed = true; }
+    active[i] = state[i];
+  }
+  active_power = power;
+}
+
+uint16_t OperatingCounters::openTherm(int id) const {
+  uint32_t value = 0;
+  if (id >= 116 && id <= 119) { value = start_count[id - 116]; }
+  if (id >= 120 && id <= 123) { value = running[id - 120] / 3600; }
+  return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+void OperatingCounters::resetOpenTherm(int id) {
+  if (id >= 116 && id <= 119) { start_count[id - 116] = 0; changed = true; }
+  if (id >= 120 && id <= 123) { running[id - 120] = 0; changed = true; }
+}
+
+void OperatingCounters::resetAll() {
+  for (int i = 0; i < COUNTERS; i++) {
+    start_count[i] = 0;
+    running[i]     = 0;
+  }
+  energy_wh = 0;
+  energy_ws = 0;
+  changed   = true;
+}
+
+void OperatingCounters::toRecord(CounterRecord& record) {
+  sequence++;
+  record.magic    = COUNTER_MAGIC;
+  record.sequence = sequence;
+  for (int i = 0; i < COUNTERS; i++) {
+    record.starts[i]  = start_count[i];
+    record.seconds[i] = running[i];
+  }
+  record.energy_wh = energy_wh;
+  record.energy_ws = energy_ws;
+  record.checksum  = checksum(record);
+  changed = false;
+}
+
+bool OperatingCounters::fromRecord(const CounterRecord& record) {
+  if (!validRecord(record)) { return false; }
+  sequence = record.sequence;
+  for (int i = 0; i < COUNTERS; i++) {
+    start_count[i] = record.starts[i];
+    running[i]     = record.seconds[i];
+  }
+  energy_wh = record.energy_wh;
+  energy_ws = record.energy_ws % 3600;
+  changed   = false;
+  return true;
+}
+
+bool OperatingCounters::validRecord(const CounterRecord& record) {
+  return record.magic == COUNTER_MAGIC && record.checksum == checksum(record);
+}
+
+uint32_t OperatingCounters::checksum(const CounterRecord& record) {
+  //FNV-1a over all words before the checksum
+  const uint32_t* words = (const uint32_t*)&record;
+  uint32_t hash = 2166136261UL;
+  for (unsigned int i = 0; i < sizeof(CounterRecord) / sizeof(uint32_t) - 1; i++) {
+    hash = (hash ^ words[i]) * 16777619UL;
+  }
+  return hash;
+}
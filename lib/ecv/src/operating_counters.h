@@ -0,0 +1,75 @@
+//Operating counters of the E-CV for the OT-Simulator
+//
+//Counts starts and running time of the burner (flame), CH pump, DHW pump/valve and DHW burner as reported in
+//the follower status, and the energy delivered by the active heater stage while the flame is on. The time
+//and energy are integrated in whole ticks of one second with integer arithmetic only: the seconds are counted
+//directly and the energy is kept in Wh with the remainder in Ws, so nothing drifts over the years.
+//The counters are answered on OpenTherm IDs 116 to 123 (u16, saturating) and persisted as a CounterRecord
+//with a sequence number and checksum, so the newest valid record of several copies can be restored.
+
+#ifndef OPERATING_COUNTERS_H
+#define OPERATING_COUNTERS_H
+
+#include <stdint.h>
+
+#define COUNTER_BURNER      0
+#define COUNTER_CH_PUMP     1
+#define COUNTER_DHW_PUMP    2
+#define COUNTER_DHW_BURNER  3
+#define COUNTERS            4
+
+#define COUNTER_TICK        1000        // ms
+#define COUNTER_MAGIC       0x45435631  // "ECV1"
+
+//Persisted counters, a record is only valid with the magic and checksum
+struct CounterRecord {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t starts[COUNTERS];
+  uint32_t seconds[COUNTERS];
+  uint32_t energy_wh;
+  uint32_t energy_ws;           // Remainder below 1Wh
+  uint32_t checksum;
+};
+
+class OperatingCounters {
+  public:
+    OperatingCounters();
+
+    //Count the starts and integrate the whole ticks since the last update, power in W of the active stage
+    void update(unsigned long now, bool flame, bool ch_mode, bool dhw_mode, int power);
+
+    uint32_t starts(int counter) const { return counter < 0 || counter >= COUNTERS ? 0 : start_count[counter]; }
+    uint32_t seconds(int counter) const { return counter < 0 || counter >= COUNTERS ? 0 : running[counter]; }
+    uint32_t energyWh() const { return energy_wh; }
+
+    //OpenTherm ID 116 to 123 value, starts for ID 116 to 119 and hours for ID 120 to 123
+    uint16_t openTherm(int id) const;
+    //Reset the counter behind an OpenTherm ID 116 to 123, the thermostat writes 0 to reset
+    void resetOpenTherm(int id);
+    void resetAll();
+
+    //Counters changed since the last record
+    bool dirty() const { return changed; }
+    //Fill a record with the next sequence number
+    void toRecord(CounterRecord& record);
+    //Restore from a record, returns false if the record is not valid
+    bool fromRecord(const CounterRecord& record);
+    static bool validRecord(const CounterRecord& record);
+
+  private:
+    static uint32_t checksum(const CounterRecord& record);
+
+    uint32_t start_count[COUNTERS];
+    uint32_t running[COUNTERS];
+    uint32_t energy_wh;
+    uint32_t energy_ws;
+    uint32_t sequence;
+    bool active[COUNTERS];
+    int active_power;             // W of the stage since the last update
+    unsigned long last_tick;
+    bool started;
+    bool changed;
+};
+
+#endif
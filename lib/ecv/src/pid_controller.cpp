@@ -0,0 +1,100 @@
+//Fixed-point PID controller for the OT-Simulator modulation, see pid_controller.h
+
+#include "hal.h"
+#include "pid_controller.h"
+
+PidController::PidController() {
+  kp_set = 0; ki_set = 0; kd_set = 0;
+  kp_q = 0; ki_q = 0; kd_q = 0;
+  integral   = 0;
+  out_min    = 0;
+  out_max    = 100 * 256;
+  out        = 0;
+  last_input = 0;
+  last_feed_forward = 0;
+  sample_ms  = 5000;
+  last_time  = 0;
+  automatic  = false;
+  started    = false;
+}
+
+void PidController::setTunings(double kp, double ki, double kd) {
+  if (kp < 0 || ki < 0 || kd < 0) { return; }
+  kp_set = kp; ki_set = ki; kd_set = kd;
+  scaleGains();
+}
+
+void PidController::setSampleTime(unsigned long new_sample_ms) {
+  if (new_sample_ms == 0) { return; }
+  sample_ms = new_sample_ms;
+  scaleGains();
+}
+
+void PidController::setOutputLimits(double new_min, double new_max) {
+  if (new_min >= new_max) { return; }
+  out_min = (int32_t)(new_min * 256);
+  out_max = (int32_t)(new_max * 256);
+  if (out > out_max) { out = out_max; }
+  if (out < out_min) { out = out_min; }
+  clampIntegral(last_feed_forward);
+}
+
+void PidController::setAutomatic(bool new_automatic, int32_t input, int32_t output) {
+  //Initialize on the switch to automatic so the output continues from the manual value
+  if (new_automatic && !automatic) {
+    out = output;
+    if (out > out_max) { out = out_max; }
+    if (out < out_min) { out = out_min; }
+    integral   = (int64_t)(out - last_feed_forward) << 16;
+    last_input = input;
+    started    = false;
+  }
+  automatic = new_automatic;
+}
+
+bool PidController::compute(unsigned long now, int32_t setpoint, int32_t input, int32_t feed_forward) {
+  if (!automatic) { return false; }
+  if (started && millis_since(now, last_time) < sample_ms) { return false; }
+  last_time = now;
+  started   = true;
+
+  int32_t error = setpoint - input;
+  int32_t delta_input = input - last_input;
+  last_input = input;
+
+  //Proportional and derivative on measurement, in f8.8 percent << 16
+  int64_t p_term = (int64_t)kp_q * error;
+  int64_t d_term = -(int64_t)kd_q * delta_input;
+
+  //Integrate unless the output is saturated and the error would drive it further (conditional integration)
+  int64_t i_step = (int64_t)ki_q * error;
+  bool saturated_high = out >= out_max && i_step > 0;
+  bool saturated_low  = out <= out_min && i_step < 0;
+  if (!saturated_high && !saturated_low) {
+    integral += i_step;
+  }
+  clampIntegral(feed_forward);
+  last_feed_forward = feed_forward;
+
+  int64_t result = ((p_term + integral + d_term) >> 16) + feed_forward;
+  if (result > out_max) { result = out_max; }
+  if (result < out_min) { result = out_min; }
+  out = (int32_t)result;
+  return true;
+}
+
+void PidController::scaleGains() {
+  //Fold the sample time into the integral and derivative gain, the step then needs no division
+  double sample_s = sample_ms / 1000.0;
+  kp_q = (int32_t)(kp_set * 65536 + 0.5);
+  ki_q = (int32_t)(ki_set * sample_s * 65536 + 0.5);
+  kd_q = (int32_t)(kd_set / sample_s * 65536 + 0.5);
+}
+
+void PidController::clampIntegral(int32_t feed_forward) {
+  //The integral and the feed-forward together stay within the output limits
+  int64_t high = (int64_t)(out_max - feed_forward) << 16;
+  int64_t low  = (int64_t)(out_min - feed_forward) << 16;
+  if (integral > high) { integral = high; }
+  if (integral < low)  { integral = low; }
+}
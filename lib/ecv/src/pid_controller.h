@@ -0,0 +1,59 @@
+//Fixed-point PID controller for the OT-Simulator modulation
+//
+//Setpoint, input and output are f8.8 values (1/256 units), the same format OpenTherm uses for temperatures and
+//modulation. The gains are stored as 16.16 fixed point with the sample time folded in, so a controller step only
+//uses integer multiply and add. Features:
+// - fixed sample time, compute() only runs a step when the sample time has passed
+// - derivative on measurement, no derivative kick on a setpoint change
+// - anti-windup, the integral is clamped to the output limits and frozen while the output saturates
+// - bumpless switching between manual and automatic mode
+// - optional feed-forward term that is added to the output, the integral only corrects what it leaves
+
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <stdint.h>
+
+class PidController {
+  public:
+    PidController();
+
+    //Set the gains, kp in %/C, ki in %/(C*s) and kd in %*s/C
+    void setTunings(double kp, double ki, double kd);
+    //Set the sample time in ms, the integral and derivative gains are rescaled
+    void setSampleTime(unsigned long sample_ms);
+    //Set the output limits in percent, the output and integral are clamped to the new limits
+    void setOutputLimits(double out_min, double out_max);
+    //Switch between manual (output is held) and automatic mode, input and output in f8.8 for a bumpless start
+    void setAutomatic(bool automatic, int32_t input, int32_t output);
+
+    //Run a controller step if the sample time has passed, setpoint and input in f8.8 C, feed_forward in f8.8
+    //percent, returns true if a step ran
+    bool compute(unsigned long now, int32_t setpoint, int32_t input, int32_t feed_forward = 0);
+
+    //Controller output in f8.8 percent
+    int32_t output() const { return out; }
+    bool isAutomatic() const { return automatic; }
+    unsigned long sampleTime() const { return sample_ms; }
+    double kp() const { return kp_set; }
+    double ki() const { return ki_set; }
+    double kd() const { return kd_set; }
+
+  private:
+    void scaleGains();
+    void clampIntegral(int32_t feed_forward);
+
+    double kp_set, ki_set, kd_set;          // Gains as set, for reporting and rescaling
+    int32_t kp_q, ki_q, kd_q;               // 16.16 gains, ki_q and kd_q include the sample time
+    int64_t integral;                       // Integral term in f8.8 percent << 16
+    int32_t out_min, out_max;               // Output limits in f8.8 percent
+    int32_t out;                            // Last output in f8.8 percent
+    int32_t last_input;                     // Input of the last step for the derivative on measurement
+    int32_t last_feed_forward;              // Feed-forward of the last step in f8.8 percent
+    unsigned long sample_ms;
+    unsigned long last_time;
+    bool automatic;
+    bool started;                           // Set after the first step, the first step runs immediately
+};
+
+#endif
@@ -0,0 +1,21 @@
+//Temperature sensors backed by the thermal model, see plant_sensors.h
+
+#include "plant_sensors.h"
+
+PlantSensors::PlantSensors(Clock& clock) : clock(clock) {
+  last_step = clock.millis();
+}
+
+void PlantSensors::heaterOutput(int power, double outside) {
+  heater_power        = power;
+  outside_temperature = outside;
+}
+
+void PlantSensors::read(float& flow, float& ret) {
+  //Advance the thermal model to now with the active heater stage
+  unsigned long now = clock.millis();
+  model.step(millis_since(now, last_step) / 1000.0, heater_power, outside_temperature);
+  last_step = now;
+  flow = model.sensorFlowTemperature();
+  ret  = model.sensorReturnTemperature();
+}
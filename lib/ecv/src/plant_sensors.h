@@ -0,0 +1,29 @@
+//Temperature sensors backed by the thermal model of boiler_plant.h
+//
+//Replaces the 1-Wire sensors with env:d1_mini_plant and in the host build. Every read() advances the model to
+//the current time with the heater power and outside temperature of the last heaterOutput() call.
+
+#ifndef PLANT_SENSORS_H
+#define PLANT_SENSORS_H
+
+#include "hal.h"
+#include "boiler_plant.h"
+
+class PlantSensors : public TemperatureSensors {
+  public:
+    explicit PlantSensors(Clock& clock);
+
+    void heaterOutput(int power, double outside) override;
+    void read(float& flow, float& ret) override;
+
+    BoilerPlant& plant() { return model; }
+
+  private:
+    Clock& clock;
+    BoilerPlant model;
+    unsigned long last_step;
+    int heater_power = 0;
+    double outside_temperature = 0;
+};
+
+#endif
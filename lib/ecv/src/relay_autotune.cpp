@@ -0,0 +1,120 @@
+//Relay auto-tuning of the PID gains for the OT-Simulator, see relay_autotune.h
+
+#include <math.h>
+#include "hal.h"
+#include "relay_autotune.h"
+
+RelayAutoTune::RelayAutoTune() {
+  setRelay(0, 100);
+  setHysteresis(0.5);
+  setCycles(3);
+  timeout = 14400000;
+  rule    = AUTOTUNE_RULE_PI;
+  actuator_period = 300000;
+  current_state = AUTOTUNE_IDLE;
+  relay_high  = false;
+  cycles_done = 0;
+  ku = 0; pu = 0;
+  result_kp = 0; result_ki = 0; result_kd = 0;
+}
+
+void RelayAutoTune::setRelay(double new_low, double new_high) {
+  if (new_low < 0 || new_high > 100 || new_low >= new_high) { return; }
+  low  = (int32_t)(new_low * 256);
+  high = (int32_t)(new_high * 256);
+}
+
+void RelayAutoTune::setHysteresis(double new_hysteresis) {
+  if (new_hysteresis < 0) { return; }
+  hysteresis = (int32_t)(new_hysteresis * 256);
+}
+
+void RelayAutoTune::setCycles(int new_cycles) {
+  if (new_cycles < 1) { return; }
+  cycles = new_cycles;
+}
+
+void RelayAutoTune::start(unsigned long now, int32_t new_setpoint, int32_t input) {
+  setpoint      = new_setpoint;
+  relay_high    = input < setpoint;
+  start_time    = now;
+  cycle_start   = now;
+  cycles_done   = -1;
+  cycle_max     = input;
+  cycle_min     = input;
+  sum_amplitude = 0;
+  sum_period    = 0;
+  current_state = AUTOTUNE_RUNNING;
+}
+
+void RelayAutoTune::abort() {
+  if (current_state == AUTOTUNE_RUNNING) { current_state = AUTOTUNE_IDLE; }
+  relay_high = false;
+}
+
+bool RelayAutoTune::update(unsigned long now, int32_t input) {
+  if (current_state != AUTOTUNE_RUNNING) { return false; }
+
+  if (millis_since(now, start_time) > timeout) {
+    current_state = AUTOTUNE_FAILED;
+    relay_high = false;
+    return true;
+  }
+
+  if (input > cycle_max) { cycle_max = input; }
+  if (input < cycle_min) { cycle_min = input; }
+
+  if (!relay_high && input < setpoint - hysteresis) {
+    relay_high = true;
+  } else if (relay_high && input > setpoint + hysteresis) {
+    relay_high = false;
+
+    //A switch from high to low closes a cycle, the first partial and the first full cycle are skipped
+    if (cycles_done >= 1) {
+      sum_amplitude += cycle_max - cycle_min;
+      sum_period    += millis_since(now, cycle_start);
+    }
+    cycles_done++;
+    cycle_start = now;
+    cycle_max   = input;
+    cycle_min   = input;
+
+    if (cycles_done > cycles) {
+      finish();
+      return true;
+    }
+  }
+  return false;
+}
+
+void RelayAutoTune::finish() {
+  relay_high = false;
+
+  //Amplitude of the oscillation (half the peak to peak) and the relay in the units of the controller
+  double a = sum_amplitude / 256.0 / cycles / 2.0;
+  double d = (high - low) / 256.0 / 2.0;
+  double e = hysteresis / 256.0;
+  if (a <= e) {
+    current_state = AUTOTUNE_FAILED;
+    return;
+  }
+  ku = 4.0 * d / (M_PI * a);
+  pu = sum_period / 1000.0 / cycles;
+
+  //Heater gain in C/(%*s) and the crossover in rad/s, the heater adds -90 degrees and the controller the rest down to
+  //the phase margin: PI with wc * Ti = tan(pm), PID with Td = Ti / 4 and wc * Ti = 2 * tan(pm / 2). Both give
+  //|C(wc)| = Kp / sin(pm)
+  double heater    = 2.0 * M_PI / (ku * pu);
+  double crossover = 1000.0 / actuator_period;
+  double margin    = AUTOTUNE_PHASE_MARGIN * M_PI / 180.0;
+  result_kp = crossover * sin(margin) / heater;
+  if (rule == AUTOTUNE_RULE_PID) {
+    double ti = 2.0 * tan(margin / 2.0) / crossover;
+    result_ki = result_kp / ti;
+    result_kd = result_kp * ti / 4.0;
+  } else {
+    result_ki = result_kp * crossover / tan(margin);
+    result_kd = 0;
+  }
+  current_state = AUTOTUNE_DONE;
+}
@@ -0,0 +1,96 @@
+//Relay auto-tuning of the PID gains for the OT-Simulator (Astrom-Hagglund relay experiment)
+//
+//The controller is replaced by a relay between a high and a low modulation around the flow temperature
+//setpoint, with a hysteresis band against sensor noise. The relay drives the heater stages directly, without the
+//stage timers and the time-proportioning, so the heater temperature oscillates with the heater and radiators alone.
+//From the amplitude a of that oscillation and the relay amplitude d the gain of the relay follows as
+//  Ku = 4 * d / (pi * a)
+//and the heater, an integrator at these periods, has a gain of 2 * pi / (Ku * Pu) C per % and second.
+//The PID drives the heater through the time-proportioning, so Ziegler-Nichols on Ku and Pu would put the loop far
+//above the stage period. The gains place the crossover of the loop at one radian per actuator period (the stage
+//period) with a phase margin of AUTOTUNE_PHASE_MARGIN instead. The first cycle starts from an arbitrary temperature
+//and is skipped, the result is the average of the next cycles. update() is called from loop() and never blocks.
+
+#ifndef RELAY_AUTOTUNE_H
+#define RELAY_AUTOTUNE_H
+
+#include <stdint.h>
+
+#define AUTOTUNE_IDLE     0
+#define AUTOTUNE_RUNNING  1
+#define AUTOTUNE_DONE     2
+#define AUTOTUNE_FAILED   3
+
+#define AUTOTUNE_RULE_PI  0
+#define AUTOTUNE_RULE_PID 1
+
+#define AUTOTUNE_PHASE_MARGIN 40    // Degrees at the crossover of the loop
+
+class RelayAutoTune {
+  public:
+    RelayAutoTune();
+
+    //Relay modulation in percent, the relay amplitude is half the difference
+    void setRelay(double low, double high);
+    //Hysteresis band around the setpoint in C
+    void setHysteresis(double hysteresis);
+    //Number of cycles to average after the first one
+    void setCycles(int cycles);
+    //Maximum duration of the experiment in ms before it fails
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    //PI or PID (derivative time a quarter of the integral time) for the gains
+    void setRule(int new_rule) { rule = new_rule; }
+    //Period in ms of the actuator the PID drives, the crossover of the loop is one radian per period
+    void setActuatorPeriod(unsigned long ms) { if (ms > 0) { actuator_period = ms; } }
+
+    //Start the experiment around setpoint and input in f8.8 C
+    void start(unsigned long now, int32_t setpoint, int32_t input);
+    void abort();
+    //Feed the heater temperature in f8.8 C, returns true when the state changed to DONE or FAILED
+    bool update(unsigned long now, int32_t input);
+
+    int state() const { return current_state; }
+    bool running() const { return current_state == AUTOTUNE_RUNNING; }
+    //Relay output in f8.8 percent
+    int32_t output() const { return relay_high ? high : low; }
+    //Completed cycles, including the skipped first one
+    int cycle() const { return cycles_done; }
+
+    //Gain of the relay at the oscillation in %/C and its period in s
+    double ultimateGain() const { return ku; }
+    double ultimatePeriod() const { return pu; }
+    //Proposed gains in the units of PidController::setTunings()
+    double kp() const { return result_kp; }
+    double ki() const { return result_ki; }
+    double kd() const { return result_kd; }
+
+  private:
+    void finish();
+
+    int32_t low;                  // f8.8 percent
+    int32_t high;                 // f8.8 percent
+    int32_t hysteresis;           // f8.8 C
+    int32_t setpoint;             // f8.8 C
+    int cycles;
+    unsigned long timeout;
+    int rule;
+    unsigned long actuator_period;  // ms
+
+    int current_state;
+    bool relay_high;
+    unsigned long start_time;
+    unsigned long cycle_start;    // Last switch from high to low, a cycle runs from one to the next
+    int cycles_done;
+    int32_t cycle_max;
+    int32_t cycle_min;
+    int64_t sum_amplitude;        // f8.8 C, peak to peak
+    unsigned long sum_period;     // ms
+
+    double ku;
+    double pu;
+    double result_kp;
+    double result_ki;
+    double result_kd;
+};
+
+#endif
@@ -0,0 +1,93 @@
+//Time-proportioning between adjacent heater stages for the OT-Simulator, see stage_dither.h
+
+#include "hal.h"
+#include "stage_dither.h"
+
+StageDither::StageDither() {
+  period   = 300000;
+  min_slot = 60000;
+  reset();
+}
+
+void StageDither::setPeriod(unsigned long ms) {
+  if (ms == 0) { return; }
+
+  //Keep the share of the first stage in the running period, the next plan takes up the difference in the error
+  first_ms = (unsigned long)((uint64_t)first_ms * ms / period);
+  period   = ms;
+}
+
+void StageDither::reset() {
+  started      = false;
+  period_start = 0;
+  last_update  = 0;
+  elapsed      = 0;
+  error        = 0;
+  first_stage  = 0;
+  second_stage = 0;
+  first_ms     = period;
+}
+
+int StageDither::stage() const {
+  return elapsed < first_ms ? first_stage : second_stage;
+}
+
+bool StageDither::update(unsigned long now, int32_t requested, int32_t delivered) {
+  if (!started) {
+    started      = true;
+    period_start = now;
+    last_update  = now;
+    elapsed      = 0;
+    plan(requested, delivered);
+    return true;
+  }
+
+  //Integrate what was requested but not delivered since the last update
+  error += (int64_t)(requested - delivered) * (int64_t)millis_since(now, last_update);
+  last_update = now;
+  elapsed     = millis_since(now, period_start);
+
+  if (elapsed < period) { return false; }
+  period_start = now;
+  elapsed      = 0;
+  plan(requested, delivered);
+  return true;
+}
+
+void StageDither::plan(int32_t requested, int32_t delivered) {
+  //The two stages around the requested modulation
+  int low = 0;
+  while (low < HEATER_STAGES && heater_stage_modulation(low + 1) <= requested) { low++; }
+  if (low == HEATER_STAGES) {
+    first_stage  = HEATER_STAGES;
+    second_stage = HEATER_STAGES;
+    first_ms     = period;
+    error        = 0;
+    return;
+  }
+  int high = low + 1;
+  int64_t gap = heater_stage_modulation(high) - heater_stage_modulation(low);
+
+  //No more than one period of error is made up, so a long hold by the stage timers does not wind up
+  int64_t limit = gap * (int64_t)period;
+  if (error > limit) { error = limit; }
+  if (error < -limit) { error = -limit; }
+
+  //Time in the upper stage for the requested modulation and the error still to make up
+  int64_t high_ms = ((int64_t)(requested - heater_stage_modulation(low)) * (int64_t)period + error) / gap;
+  if (high_ms < 0) { high_ms = 0; }
+  if (high_ms > (int64_t)period) { high_ms = period; }
+  if (high_ms < (int64_t)min_slot) { high_ms = 0; }
+  else if ((int64_t)period - high_ms < (int64_t)min_slot) { high_ms = period; }
+
+  //Continue in the stage the heater is in, so the period boundary is not a stage change
+  if (heater_stage_nearest(delivered) == high) {
+    first_stage  = high;
+    second_stage = low;
+    first_ms     = (unsigned long)high_ms;
+  } else {
+    first_stage  = low;
+    second_stage = high;
+    first_ms     = period - (unsigned long)high_ms;
+  }
+}
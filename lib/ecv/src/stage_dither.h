@@ -0,0 +1,60 @@
+//Time-proportioning between adjacent heater stages for the OT-Simulator
+//
+//A modulation between two stages is delivered as a schedule of the lower and the upper stage within a fixed
+//period, so the average power follows the requested modulation instead of the nearest stage. The error
+//between requested and delivered modulation is integrated (sigma-delta), every new period plans the time in
+//the upper stage from the requested modulation plus the error still to make up. This keeps the average exact
+//when a schedule is rounded or the stage selector timers delay a change. Switching is bounded:
+// - a stage is never planned shorter than the minimum slot, shorter remainders are carried to a later period
+// - a period starts in the stage the previous one ended in, so there is at most one change per period
+//   while the modulation stays between the same two stages
+//The integrated error stays within one period of the gap between the two stages, so with a selector that follows
+//the schedule the average over n periods is within gap / n of the requested modulation.
+
+#ifndef STAGE_DITHER_H
+#define STAGE_DITHER_H
+
+#include <stdint.h>
+#include "heater_stages.h"
+
+class StageDither {
+  public:
+    StageDither();
+
+    //Length of a schedule in ms. A running schedule is scaled to the new length and ends with it
+    void setPeriod(unsigned long ms);
+    //Minimum time in ms a stage is planned within a period
+    void setMinSlot(unsigned long ms) { min_slot = ms; }
+
+    //Integrate the delivered modulation and plan a new period when the last one has passed, requested and
+    //delivered in f8.8 percent, returns true when a new schedule was planned
+    bool update(unsigned long now, int32_t requested, int32_t delivered);
+    //Forget the schedule and the integrated error, the next update starts a new period
+    void reset();
+
+    //Modulation in f8.8 percent of the stage that is planned now
+    int32_t output() const { return heater_stage_modulation(stage()); }
+    int stage() const;
+
+    //Planned schedule, the first stage runs from the period start for first_ms, then the second stage
+    int firstStage() const { return first_stage; }
+    unsigned long firstTime() const { return first_ms; }
+    int secondStage() const { return second_stage; }
+    unsigned long secondTime() const { return period - first_ms; }
+
+  private:
+    void plan(int32_t requested, int32_t delivered);
+
+    unsigned long period;
+    unsigned long min_slot;
+    unsigned long period_start;
+    unsigned long last_update;
+    unsigned long elapsed;        // ms since the period start at the last update
+    bool started;
+    int64_t error;                // f8.8 percent * ms requested but not delivered yet
+    int first_stage;
+    int second_stage;
+    unsigned long first_ms;
+};
+
+#endif
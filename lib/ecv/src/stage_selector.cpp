@@ -0,0 +1,119 @@
+//Heater stage selection for the OT-Simulator, see stage_selector.h
+
+#include "hal.h"
+#include "stage_selector.h"
+
+StageSelector::StageSelector() {
+  min_dwell      = 60000;
+  min_on         = 180000;
+  min_off        = 180000;
+  last_change    = 0;
+  changed_once   = false;
+  current        = 0;
+  target         = 0;
+  stage_switches = 0;
+  for (int i = 0; i < HEATER_SSRS; i++) { ssr_switches[i] = 0; }
+  setHysteresis(25);
+}
+
+void StageSelector::setHysteresis(int percent_of_gap) {
+  if (percent_of_gap < 0) { percent_of_gap = 0; }
+  if (percent_of_gap > 50) { percent_of_gap = 50; }
+
+  //Switch point between stage i and i + 1 is the middle, the band is a share of the gap between them
+  for (int i = 0; i <= HEATER_STAGES; i++) {
+    if (i < HEATER_STAGES) {
+      int32_t low  = heater_stage_modulation(i);
+      int32_t high = heater_stage_modulation(i + 1);
+      int32_t band = (high - low) * percent_of_gap / 100;
+      up_threshold[i] = (low + high) / 2 + band;
+    } else {
+      up_threshold[i] = INT32_MAX;
+    }
+    if (i > 0) {
+      int32_t low  = heater_stage_modulation(i - 1);
+      int32_t high = heater_stage_modulation(i);
+      int32_t band = (high - low) * percent_of_gap / 100;
+      down_threshold[i] = (low + high) / 2 - band;
+    } else {
+      down_threshold[i] = INT32_MIN;
+    }
+  }
+}
+
+int StageSelector::selectTarget(int32_t modulation) const {
+  int stage = current;
+  while (stage < HEATER_STAGES && modulation > up_threshold[stage]) { stage++; }
+  while (stage > 0 && modulation < down_threshold[stage]) { stage--; }
+  return stage;
+}
+
+bool StageSelector::update(unsigned long now, int32_t modulation, bool enabled, bool timers) {
+  //CH off switches the heater off without waiting for the timers
+  if (!enabled) {
+    target = 0;
+    if (current == 0) { return false; }
+    change(now, 0);
+    return true;
+  }
+
+  target = selectTarget(modulation);
+  if (target == current) { return false; }
+
+  //Hold the active stage until the timers allow a change
+  if (changed_once && timers) {
+    unsigned long in_stage = millis_since(now, last_change);
+    if (in_stage < min_dwell) { return false; }
+    if (current == 0 && in_stage < min_off) { return false; }
+    if (target == 0 && in_stage < min_on) { return false; }
+  }
+
+  change(now, target);
+  return true;
+}
+
+void StageSelector::change(unsigned long now, int stage) {
+  uint8_t toggled = heater_stage_ssrs[current] ^ heater_stage_ssrs[stage];
+  for (int i = 0; i < HEATER_SSRS; i++) {
+    if (toggled & (1 << i)) { ssr_switches[i]++; }
+  }
+  stage_switches++;
+  current      = stage;
+  last_change  = now;
+  changed_once = true;
+}
+
+void StageSelector::setSwitchCounts(unsigned long stages, const unsigned long* ssrs) {
+  stage_switches = stages;
+  for (int i = 0; i < HEATER_SSRS; i++) { ssr_switches[i] = ssrs[i]; }
+}
+
+void StageSelector::toRecord(StageRecord& record, uint32_t sequence) const {
+  record.magic          = STAGE_RECORD_MAGIC;
+  record.sequence       = sequence;
+  record.stage_switches = stage_switches;
+  for (int i = 0; i < HEATER_SSRS; i++) { record.ssr_switches[i] = ssr_switches[i]; }
+  record.checksum       = checksum(record);
+}
+
+bool StageSelector::fromRecord(const StageRecord& record) {
+  if (!validRecord(record)) { return false; }
+  unsigned long ssrs[HEATER_SSRS];
+  for (int i = 0; i < HEATER_SSRS; i++) { ssrs[i] = record.ssr_switches[i]; }
+  setSwitchCounts(record.stage_switches, ssrs);
+  return true;
+}
+
+bool StageSelector::validRecord(const StageRecord& record) {
+  return record.magic == STAGE_RECORD_MAGIC && record.checksum == checksum(record);
+}
+
+uint32_t StageSelector::checksum(const StageRecord& record) {
+  //FNV-1a over all words before the checksum, as the counter record
+  const uint32_t* words = (const uint32_t*)&record;
+  uint32_t hash = 2166136261UL;
+  for (unsigned int i = 0; i < sizeof(StageRecord) / sizeof(uint32_t) - 1; i++) {
+    hash = (hash ^ words[i]) * 16777619UL;
+  }
+  return hash;
+}
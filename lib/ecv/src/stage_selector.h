@@ -0,0 +1,76 @@
+//Heater stage selection for the OT-Simulator
+//
+//Maps the requested modulation onto one of the 7 heater stages (heater_stages.h) on the E-CV itself:
+// - per-stage hysteresis, the switch point between two stages is the middle between their modulation with a
+//   band of hysteresis percent of the gap between the stages on either side
+// - minimum dwell time in a stage before the next stage change
+// - anti-short-cycle, a minimum on time before the heater switches off and a minimum off time before it
+//   switches on again
+//CH off (enabled false) switches the heater off immediately regardless of the timers.
+//Every stage change is counted, as well as the toggles per SSR of the wiring in heater_stages.h to track the SSR
+//wear. The counts are persisted as a StageRecord next to the operating counters, so the SSR wear is tracked across
+//reboots.
+
+#ifndef STAGE_SELECTOR_H
+#define STAGE_SELECTOR_H
+
+#include <stdint.h>
+#include "heater_stages.h"
+
+#define STAGE_RECORD_MAGIC  0x45435652  // "ECVR", the per-SSR counts replaced the per-coil counts of "ECVS"
+
+//Persisted switch counts, a record is only valid with the magic and checksum
+struct StageRecord {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t stage_switches;
+  uint32_t ssr_switches[HEATER_SSRS];
+  uint32_t checksum;
+};
+
+class StageSelector {
+  public:
+    StageSelector();
+
+    //Hysteresis band in percent of the gap between adjacent stages (0..50)
+    void setHysteresis(int percent_of_gap);
+    void setMinDwell(unsigned long ms) { min_dwell = ms; }
+    void setMinOn(unsigned long ms) { min_on = ms; }
+    void setMinOff(unsigned long ms) { min_off = ms; }
+
+    //Select the stage for a requested modulation in f8.8 percent, returns true if the stage changed. Without timers
+    //(the relay auto-tune) the stage follows the request at once
+    bool update(unsigned long now, int32_t modulation, bool enabled, bool timers = true);
+
+    int stage() const { return current; }
+    //Modulation in f8.8 percent delivered by the active stage
+    int32_t deliveredModulation() const { return heater_stage_modulation(current); }
+    unsigned long stageSwitches() const { return stage_switches; }
+    unsigned long ssrSwitches(int ssr) const { return ssr < 0 || ssr >= HEATER_SSRS ? 0 : ssr_switches[ssr]; }
+    void setSwitchCounts(unsigned long stages, const unsigned long* ssrs);
+
+    //Fill a record with the switch counts and the sequence number of the record
+    void toRecord(StageRecord& record, uint32_t sequence) const;
+    //Restore the switch counts from a record, returns false if the record is not valid
+    bool fromRecord(const StageRecord& record);
+    static bool validRecord(const StageRecord& record);
+
+  private:
+    static uint32_t checksum(const StageRecord& record);
+    int selectTarget(int32_t modulation) const;
+    void change(unsigned long now, int stage);
+
+    int32_t up_threshold[HEATER_STAGES + 1];      // Modulation above which stage i moves up
+    int32_t down_threshold[HEATER_STAGES + 1];    // Modulation below which stage i moves down
+    unsigned long min_dwell;
+    unsigned long min_on;
+    unsigned long min_off;
+    unsigned long last_change;
+    bool changed_once;
+    int current;
+    int target;
+    unsigned long stage_switches;
+    unsigned long ssr_switches[HEATER_SSRS];
+};
+
+#endif
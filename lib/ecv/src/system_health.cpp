@@ -0,0 +1,55 @@
+//Heap and stack health of the OT-Simulator, see system_health.h
+
+#include <stdio.h>
+#include "system_health.h"
+
+//Append "NAME=value" to the alert text, separated by a space. A text that does not fit is cut off
+static void append_alert(char* buffer, size_t size, size_t& used, const char* name, unsigned long value) {
+  if (used >= size) { return; }
+  int written = snprintf (buffer + used, size - used, "%s%s=%lu", used > 0 ? " " : "", name, value);
+  used += written > 0 ? (size_t)written : 0;
+}
+
+SystemHealth::SystemHealth() : worst(), latest(), count(0), active(0) {}
+
+int SystemHealth::add(const SystemStats& stats, const SystemStats& limits) {
+  if (count == 0) {
+    worst = stats;
+  } else {
+    if (stats.free_heap < worst.free_heap)           { worst.free_heap = stats.free_heap; }
+    if (stats.max_free_block < worst.max_free_block) { worst.max_free_block = stats.max_free_block; }
+    if (stats.fragmentation > worst.fragmentation)   { worst.fragmentation = stats.fragmentation; }
+    if (stats.stack_free < worst.stack_free)         { worst.stack_free = stats.stack_free; }
+  }
+  latest = stats;
+  count++;
+
+  active = 0;
+  if (stats.free_heap < limits.free_heap)           { active |= HEALTH_LOW_HEAP; }
+  if (stats.max_free_block < limits.max_free_block) { active |= HEALTH_LOW_BLOCK; }
+  if (stats.fragmentation > limits.fragmentation)   { active |= HEALTH_FRAGMENTED; }
+  if (stats.stack_free < limits.stack_free)         { active |= HEALTH_LOW_STACK; }
+  return active;
+}
+
+bool SystemHealth::report(char* buffer, size_t size) {
+  if (count == 0) { return false; }
+  snprintf (buffer, size, "%lu/%lu/%d/%lu", worst.free_heap, worst.max_free_block, worst.fragmentation, worst.stack_free);
+  count = 0;
+  return true;
+}
+
+void SystemHealth::alertText(char* buffer, size_t size) const {
+  if (size == 0) { return; }
+  buffer[0] = '\0';
+  if (active == 0) {
+    snprintf (buffer, size, "OK");
+    return;
+  }
+
+  size_t used = 0;
+  if (active & HEALTH_LOW_HEAP)   { append_alert(buffer, size, used, "LOW_HEAP", latest.free_heap); }
+  if (active & HEALTH_LOW_BLOCK)  { append_alert(buffer, size, used, "LOW_BLOCK", latest.max_free_block); }
+  if (active & HEALTH_FRAGMENTED) { append_alert(buffer, size, used, "FRAGMENTED", (unsigned long)latest.fragmentation); }
+  if (active & HEALTH_LOW_STACK)  { append_alert(buffer, size, used, "LOW_STACK", latest.stack_free); }
+}
@@ -0,0 +1,46 @@
+//Heap and stack health of the OT-Simulator
+//
+//Collects the SystemStats samples of the platform and keeps the worst value of each since the last report: the
+//lowest free heap, largest free block and free stack, the highest fragmentation. A reboot after a long uptime is
+//mostly the heap running out or breaking up, the free heap and the largest block shrink over days before an
+//allocation fails, the worst values show that trend where a single sample can miss it.
+//
+//Every sample is compared with the limits, the alerts are a bit mask of HEALTH_* and reported as text such as
+//"LOW_HEAP=7345 FRAGMENTED=62", or "OK" without an alert. No heap is used.
+
+#ifndef SYSTEM_HEALTH_H
+#define SYSTEM_HEALTH_H
+
+#include <stddef.h>
+#include "hal.h"
+
+#define HEALTH_LOW_HEAP    1
+#define HEALTH_LOW_BLOCK   2
+#define HEALTH_FRAGMENTED  4
+#define HEALTH_LOW_STACK   8
+
+class SystemHealth {
+  public:
+    SystemHealth();
+
+    //Add a sample and compare it with the limits: the minimum free heap, largest free block and free stack, the
+    //maximum fragmentation. Returns the HEALTH_* bits of the sample
+    int add(const SystemStats& stats, const SystemStats& limits);
+    //Worst values since the last report as "free heap/max free block/fragmentation/stack free", then start a new
+    //report. Returns false without samples
+    bool report(char* buffer, size_t size);
+    //The alerts of the last sample with their values, "OK" without an alert
+    void alertText(char* buffer, size_t size) const;
+
+    int alerts() const { return active; }
+    int samples() const { return count; }
+    const SystemStats& last() const { return latest; }
+
+  private:
+    SystemStats worst;
+    SystemStats latest;
+    int count;
+    int active;
+};
+
+#endif
@@ -0,0 +1,169 @@
+//Heap allocation counter of the host build, see alloc_counter.h
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <new>
+#include "alloc_counter.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+//The allocator of glibc behind the replaced malloc
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* block, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void* block);
+}
+#define real_malloc(size)           __libc_malloc(size)
+#define real_free(block)            __libc_free(block)
+#define usable_size(block)          malloc_usable_size(block)
+#else
+#define real_malloc(size)           malloc(size)
+#define real_free(block)            free(block)
+#define usable_size(block)          0
+#endif
+
+//Zero initialized before the first allocation of the C++ runtime. The totals are shared by the threads of the
+//fleet, a scope and its statistics belong to the thread that opened it.
+static std::atomic<unsigned long> allocations {0};
+static std::atomic<unsigned long> allocated   {0};
+static std::atomic<unsigned long> live        {0};
+static std::atomic<unsigned long> peak        {0};
+
+static AllocStats stats[ALLOC_PATHS];
+static thread_local bool scope_active         = false;
+static thread_local AllocPath scope_path      = ALLOC_FRAME;
+static thread_local unsigned long scope_peak  = 0;
+static bool strict                            = false;
+
+static const char* const path_names[ALLOC_PATHS] = { "frame", "message", "loop" };
+
+unsigned long alloc_count() { return allocations; }
+unsigned long alloc_bytes() { return allocated; }
+unsigned long alloc_live()  { return live; }
+unsigned long alloc_peak()  { return peak; }
+
+const AllocStats& alloc_stats(AllocPath path) { return stats[path]; }
+const char* alloc_path_name(AllocPath path)   { return path_names[path]; }
+void alloc_stats_reset()                      { memset(stats, 0, sizeof(stats)); }
+void alloc_strict(bool enable)                { strict = enable; }
+
+//FUNCTION: Count an allocation, block is nullptr if it failed
+static void counted(void* block, size_t size) {
+  if (block == nullptr) { return; }
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated.fetch_add(size, std::memory_order_relaxed);
+  unsigned long now = live.fetch_add(usable_size(block), std::memory_order_relaxed) + usable_size(block);
+  unsigned long highest = peak.load(std::memory_order_relaxed);
+  while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {}
+  if (!scope_active) { return; }
+  if (now > scope_peak) { scope_peak = now; }
+
+  //Without printf, it could allocate itself
+  if (strict) {
+    const char* name = path_names[scope_path];
+    static const char text[] = "allocation on the hot path: ";
+    if (write(2, text, sizeof(text) - 1) < 0 || write(2, name, strlen(name)) < 0 || write(2, "\n", 1) < 0) {}
+    abort();
+  }
+}
+
+static void released(void* block) {
+  if (block == nullptr) { return; }
+  live.fetch_sub(usable_size(block), std::memory_order_relaxed);
+}
+
+AllocScope::AllocScope(AllocPath path)
+  : path(path), outer_path(scope_path), outer_active(scope_active), start_allocations(allocations), start_bytes(allocated),
+    start_live(live), outer_peak(scope_peak) {
+  scope_active = true;
+  scope_path   = path;
+  scope_peak   = live;
+}
+
+AllocScope::~AllocScope() {
+  AllocStats& s = stats[path];
+  unsigned long count = allocations - start_allocations;
+  s.entries++;
+  s.allocations += count;
+  s.bytes += allocated - start_bytes;
+  if (count > s.max_allocations) { s.max_allocations = count; }
+  if (scope_peak - start_live > s.peak) { s.peak = scope_peak - start_live; }
+
+  //The allocations of a nested scope also count for the outer one
+  scope_active = outer_active;
+  scope_path   = outer_path;
+  if (outer_peak > scope_peak) { scope_peak = outer_peak; }
+}
+
+static void* counted_alloc(size_t size) {
+  void* block = real_malloc(size == 0 ? 1 : size);
+  if (block == nullptr) { throw std::bad_alloc(); }
+  counted(block, size);
+  return block;
+}
+
+static void counted_free(void* block) {
+  released(block);
+  real_free(block);
+}
+
+void* operator new(size_t size)   { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* block) noexcept                { counted_free(block); }
+void operator delete[](void* block) noexcept              { counted_free(block); }
+void operator delete(void* block, size_t) noexcept        { counted_free(block); }
+void operator delete[](void* block, size_t) noexcept      { counted_free(block); }
+
+#ifdef __GLIBC__
+//The C allocation functions, for strdup(), the stdio buffers and the C libraries
+extern "C" {
+  void* malloc(size_t size) {
+    void* block = __libc_malloc(size);
+    counted(block, size);
+    return block;
+  }
+
+  void* calloc(size_t count, size_t size) {
+    void* block = __libc_calloc(count, size);
+    counted(block, count * size);
+    return block;
+  }
+
+  void* realloc(void* block, size_t size) {
+    size_t old = block != nullptr ? malloc_usable_size(block) : 0;
+    void* moved = __libc_realloc(block, size);
+    //A size of 0 frees the block
+    if (moved == nullptr && size > 0) { return nullptr; }
+    live.fetch_sub(old, std::memory_order_relaxed);
+    if (moved == nullptr) { return nullptr; }
+    counted(moved, size);
+    return moved;
+  }
+
+  void free(void* block) {
+    released(block);
+    __libc_free(block);
+  }
+
+  void* memalign(size_t alignment, size_t size) {
+    void* block = __libc_memalign(alignment, size);
+    counted(block, size);
+    return block;
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size) { return memalign(alignment, size); }
+
+  int posix_memalign(void** result, size_t alignment, size_t size) {
+    void* block = memalign(alignment, size);
+    if (block == nullptr) { return ENOMEM; }
+    *result = block;
+    return 0;
+  }
+}
+#endif
@@ -0,0 +1,57 @@
+//Heap allocation counter of the host build
+//
+//Replaces the global operator new and delete and, with glibc, malloc, calloc, realloc and free. Counts the calls,
+//the requested bytes and the live heap with its peak; the core on the ESP8266 should not allocate on the hot
+//paths as the heap fragments over days of uptime.
+//
+//An AllocScope around a hot path adds its allocations to the statistics of the path:
+//  { AllocScope scope(ALLOC_FRAME); ecv.processRequest(request); }
+//With alloc_strict(true) an allocation inside a scope prints the path and aborts, so a debugger or the core dump
+//shows where it came from. The totals count all threads, the scopes are meant for a single thread.
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <stddef.h>
+
+//Number of allocations and requested bytes since the start of the program
+unsigned long alloc_count();
+unsigned long alloc_bytes();
+//Heap in use and the highest heap in use since the start of the program, in usable bytes of the allocator (glibc
+//only, 0 elsewhere)
+unsigned long alloc_live();
+unsigned long alloc_peak();
+
+//Hot paths of the core
+enum AllocPath { ALLOC_FRAME, ALLOC_MESSAGE, ALLOC_LOOP, ALLOC_PATHS };
+
+struct AllocStats {
+  unsigned long entries;          // Times the path ran
+  unsigned long allocations;      // Allocations in all runs
+  unsigned long bytes;            // Requested bytes in all runs
+  unsigned long max_allocations;  // Most allocations in a single run
+  unsigned long peak;             // Highest growth of the live heap within a run
+};
+
+class AllocScope {
+  public:
+    explicit AllocScope(AllocPath path);
+    ~AllocScope();
+
+  private:
+    AllocPath path;
+    AllocPath outer_path;
+    bool outer_active;
+    unsigned long start_allocations;
+    unsigned long start_bytes;
+    unsigned long start_live;
+    unsigned long outer_peak;
+};
+
+const AllocStats& alloc_stats(AllocPath path);
+const char* alloc_path_name(AllocPath path);
+void alloc_stats_reset();
+//Abort on an allocation inside a scope
+void alloc_strict(bool strict);
+
+#endif
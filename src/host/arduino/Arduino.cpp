@@ -0,0 +1,12 @@
+//Arduino API for the libraries of the ESP8266 build on the host, see Arduino.h
+
+#include "Arduino.h"
+
+unsigned long host_micros = 0;
+uint8_t host_pins[32]     = {0};
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode) {
+  (void)interrupt;
+  (void)handler;
+  (void)mode;
+}
@@ -0,0 +1,53 @@
+//Arduino API for the libraries of the ESP8266 build on the host
+//
+//Only what the OpenTherm Library uses. Time and the pin levels are simulated: micros() returns host_micros, which
+//delay() and delayMicroseconds() advance, digitalRead() returns host_pins. The line simulator sets them before it
+//calls the interrupt handler.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t byte;
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+#define CHANGE 1
+
+#define B000 0
+#define B001 1
+#define B010 2
+#define B011 3
+#define B100 4
+#define B101 5
+#define B110 6
+#define B111 7
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define digitalPinToInterrupt(pin) (pin)
+
+//Simulated time in us and pin levels
+extern unsigned long host_micros;
+extern uint8_t host_pins[32];
+
+inline unsigned long micros() { return host_micros; }
+inline unsigned long millis() { return host_micros / 1000; }
+inline void delay(unsigned long ms) { host_micros += ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { host_micros += us; }
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline int digitalRead(uint8_t pin) { return host_pins[pin & 31]; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { host_pins[pin & 31] = level; }
+
+//The handler is not called on a pin change, the simulator calls it for every edge it delivers
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+inline void detachInterrupt(uint8_t interrupt) { (void)interrupt; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#endif
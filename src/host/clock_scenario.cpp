@@ -0,0 +1,136 @@
+//Day scenarios of the E-CV core on the virtual clock, see clock_scenario.h
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <ecv_core.h>
+#include <plant_sensors.h>
+#include "clock_scenario.h"
+#include "host_platform.h"
+
+//Records the publish times of the schedules, the ping of the probe is returned after the loop like the broker would
+class ScheduleMqtt : public MqttLink {
+  public:
+    ScheduleMqtt(Clock& clock, unsigned long start, ScenarioResult& result) : clock(clock), start(start), result(result) {}
+
+    bool publish(const char* topic, const char* payload, bool retained) override {
+      (void)retained;
+      result.publishes++;
+      if (strcmp(topic, "ecv/probe/ping") == 0) { ping = payload; }
+
+      unsigned long elapsed = millis_since(clock.millis(), start);
+      for (ScheduleStats& schedule : result.schedules) {
+        if (strcmp(topic, schedule.topic) != 0) { continue; }
+        if (schedule.count > 0) {
+          unsigned long gap = elapsed - schedule.last;
+          if (schedule.count == 1 || gap < schedule.min_gap) { schedule.min_gap = gap; }
+          if (gap > schedule.max_gap) { schedule.max_gap = gap; }
+        }
+        schedule.last = elapsed;
+        schedule.count++;
+      }
+      return true;
+    }
+
+    bool subscribe(const char* topic, int qos) override {
+      (void)topic;
+      (void)qos;
+      return true;
+    }
+
+    bool connected() override { return true; }
+
+    std::string ping;
+
+  private:
+    Clock& clock;
+    unsigned long start;
+    ScenarioResult& result;
+};
+
+int ScenarioResult::failedSchedules() const {
+  int failed = 0;
+  for (const ScheduleStats& schedule : schedules) {
+    if (schedule.count < 2 || schedule.max_gap > schedule.interval + 1000) { failed++; }
+  }
+  return failed;
+}
+
+bool ScenarioResult::sameAs(const ScenarioResult& other) const {
+  if (schedules.size() != other.schedules.size()) { return false; }
+  for (size_t i = 0; i < schedules.size(); i++) {
+    const ScheduleStats& a = schedules[i];
+    const ScheduleStats& b = other.schedules[i];
+    if (a.count != b.count || a.min_gap != b.min_gap || a.max_gap != b.max_gap || a.last != b.last) { return false; }
+  }
+  return frames == other.frames && publishes == other.publishes && flow_temperature == other.flow_temperature &&
+    counters == other.counters;
+}
+
+void run_clock_scenario(const ScenarioOptions& options, ScenarioResult& result) {
+  //The clock is set before the core and the plant read it in their constructors
+  HostClock clock;
+  clock.set(options.start);
+  CaptureLink link;
+  ScheduleMqtt mqtt(clock, options.start, result);
+  PlantSensors sensors(clock);
+  FileStorage storage(nullptr);
+  HostDebug debug;
+  HostSystem system;
+  EcvCore ecv(clock, link, mqtt, sensors, storage, debug, system);
+  ecv.begin();
+  ecv.timing = 0;
+  sensors.plant().reset(20.0, 20.0);
+
+  result.schedules = {
+    { "ch_requested", "ecv/thermostat/ch_requested",        60000 },
+    { "returntemp",   "ecv/thermostat/returntemp",          5000 },
+    { "modulation",   "ecv/thermostat/rawdata/modulation",  ecv.pid_sample_time },
+    { "counters",     "ecv/counters/energy",                ecv.counters_publish_interval },
+    { "ping",         "ecv/probe/ping",                     ecv.probe_interval },
+    { "health",       "ecv/system/health",                  ecv.health_interval * ecv.health_report_every },
+  };
+
+  //ID 0 with CH enable in the leader status and ID 1 with the control setpoint in f8.8
+  unsigned long status_request   = frame_with_parity(0x00000100UL);
+  unsigned long setpoint_request = frame_with_parity(0x10010000UL | ((unsigned long)(options.setpoint * 256) & 0xFFFF));
+
+  unsigned long duration = (unsigned long)(options.hours * 3600000.0);
+  unsigned long previous = clock.millis();
+  char payload[16];
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long t = 0; t < duration; t += options.step) {
+    clock.set(options.start + t);
+    if (clock.millis() < previous) { result.wraps++; }
+    previous = clock.millis();
+
+    //OpenHAB publishes the outside temperature, lowest at the start of the day
+    if (t % 300000 == 0) {
+      double outside = options.outside - 2.5 * cos(2.0 * M_PI * t / 86400000.0);
+      snprintf (payload, sizeof(payload), "%.1f", outside);
+      ecv.callback("ecv/sensors/outside_temperature", (const uint8_t*)payload, strlen(payload));
+    }
+
+    if (t % 1000 == 0) {
+      ecv.processRequest((t / 1000) % 2 == 0 ? status_request : setpoint_request);
+      result.frames++;
+    }
+    ecv.loop();
+
+    //The broker returns the ping, the OpenHAB rule reports the CH mode and the flame of the active stage back
+    if (!mqtt.ping.empty()) {
+      ecv.callback("ecv/probe/ping", (const uint8_t*)mqtt.ping.c_str(), mqtt.ping.size());
+      mqtt.ping.clear();
+    }
+    int ch_mode = ecv.ch_enabled == 1 ? 1 : 0;
+    int flame   = ecv.stages.stage() > 0 ? 1 : 0;
+    if (ch_mode != ecv.follower_status[6]) { ecv.callback("ecv/status/ch_mode", (const uint8_t*)(ch_mode ? "1" : "0"), 1); }
+    if (flame != ecv.follower_status[4])   { ecv.callback("ecv/status/flame", (const uint8_t*)(flame ? "1" : "0"), 1); }
+  }
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result.flow_temperature = sensors.plant().flowTemperature();
+  result.counters = ecv.countersFormat();
+}
@@ -0,0 +1,57 @@
+//Day scenarios of the E-CV core on the virtual clock
+//
+//The core, the plant model and a thermostat run on HostClock, so hours of the time-based logic take milliseconds of
+//wall time and the result does not depend on the machine. The thermostat requests CH at the setpoint with a status
+//and a setpoint frame per second, OpenHAB reports the CH mode and flame back and publishes the outside temperature
+//of a daily cycle every 5 minutes. The publish times of the schedules of the core are recorded:
+// - ch_requested  heartbeat every 60s while the CH request does not change, on a request frame
+// - returntemp    1-Wire read every 5s, from loop()
+// - modulation    sample of the PID modulation controller on [ecv/thermostat/rawdata/modulation]
+// - counters      operating counters on [ecv/counters/energy]
+// - ping          broker round-trip probe
+//A schedule fails if a gap is longer than its interval plus one frame period. millis() of the ESP8266 wraps after
+//49.7 days, HostClock wraps at 32 bits as well: the same scenario from a start just before 2^32 must give exactly
+//the result of a start at 0.
+
+#ifndef CLOCK_SCENARIO_H
+#define CLOCK_SCENARIO_H
+
+#include <string>
+#include <vector>
+
+struct ScenarioOptions {
+  double hours         = 24;
+  unsigned long start  = 0;         // millis() at the start of the scenario
+  unsigned long step   = 100;       // ms between loop() calls, the thermostat sends a frame every 1000 ms
+  double setpoint      = 55;        // C, control setpoint of the thermostat
+  double outside       = 5;         // C, mean of the daily outside temperature, 5 C day to night
+};
+
+struct ScheduleStats {
+  const char* name;
+  const char* topic;
+  unsigned long interval;           // ms, the interval the core is configured for
+  unsigned long count   = 0;
+  unsigned long min_gap = 0;        // ms between two publishes
+  unsigned long max_gap = 0;
+  unsigned long last    = 0;        // Virtual time of the last publish since the start
+};
+
+struct ScenarioResult {
+  std::vector<ScheduleStats> schedules;
+  unsigned long frames    = 0;
+  unsigned long publishes = 0;
+  unsigned long wraps     = 0;      // Times millis() wrapped during the scenario
+  double flow_temperature = 0;      // C, plant at the end of the scenario
+  std::string counters;             // Counters JSON of the core at the end
+  double seconds          = 0;      // Wall time
+
+  //Schedules with a gap longer than their interval plus one frame period
+  int failedSchedules() const;
+  //Same schedules, frames, publishes and end state
+  bool sameAs(const ScenarioResult& other) const;
+};
+
+void run_clock_scenario(const ScenarioOptions& options, ScenarioResult& result);
+
+#endif
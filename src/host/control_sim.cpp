@@ -0,0 +1,273 @@
+//Closed-loop runs of the E-CV control on the plant model, see control_sim.h
+
+#include <math.h>
+#include <vector>
+#include <control_metrics.h>
+#include "control_sim.h"
+#include "host_platform.h"
+
+//The proportional step before the PID, flow error band and update interval
+#define STEP_LOWER_LIMIT   2.00
+#define STEP_UPPER_LIMIT  20.00
+#define STEP_INTERVAL     60000
+//Width of the output limits that hold the PID at the step value, one f8.8 LSB as the limits may not be equal
+#define STEP_HOLD         (1.0 / 256)
+
+//Modulation of the step controller for a flow error in C
+static double step_modulation(double difference) {
+  if (difference > STEP_UPPER_LIMIT) { return 100.00; }
+  if (difference < STEP_LOWER_LIMIT) { return 0.00; }
+  return difference / (STEP_UPPER_LIMIT - STEP_LOWER_LIMIT) * 100;
+}
+
+static const char* const autotune_names[] = { "idle", "running", "done", "failed" };
+
+const char* sim_controller_name(SimController controller) {
+  return controller == CONTROL_STEP ? "step" : "pid";
+}
+
+void run_control_sim(const SimOptions& options, SimResult& result) {
+  HostEcv host;
+  EcvCore& ecv = host.ecv;
+  host.sensors.plant().reset(20.0, 20.0);
+  if (options.controller == CONTROL_STEP) { ecv.pid.setOutputLimits(0, STEP_HOLD); }
+
+  //The heating curve over MQTT as OpenHAB sets it
+  char payload[32];
+  if (options.curve) {
+    snprintf (payload, sizeof(payload), "%.2f", options.slope);
+    host.receive("ecv/command/heating_curve_slope", payload);
+    snprintf (payload, sizeof(payload), "%.2f", options.shift);
+    host.receive("ecv/command/heating_curve_shift", payload);
+    host.receive("ecv/command/heating_curve", "1");
+  }
+  if (!options.feed_forward) { host.receive("ecv/command/ff_gain", "0"); }
+
+  //ID 0 with CH enable in the leader status and ID 1 with the control setpoint in f8.8
+  unsigned long status_request   = frame_with_parity(0x00000100UL);
+  unsigned long setpoint_request = frame_with_parity(0x10010000UL | ((unsigned long)(options.setpoint * 256) & 0xFFFF));
+
+  ControlMetrics metrics, event;
+  unsigned long duration  = (unsigned long)(options.hours * 3600000.0);
+  unsigned long change_at = options.change_at < 0 ? duration : (unsigned long)(options.change_at * 3600000.0);
+  unsigned long load_at   = options.load_at < 0 ? duration : (unsigned long)(options.load_at * 3600000.0);
+  double setpoint = options.setpoint;
+
+  //Mean flow over the stage period, the time-proportioning holds the mean and the ripple within a period is no error
+  std::vector<double> window(ecv.stage_period >= 1000 ? ecv.stage_period / 1000 : 1, 0.0);
+  size_t window_next = 0;
+  double window_sum  = 0;
+  unsigned long last_step = 0;
+  bool started = false;
+  int autotune = options.autotune ? 1 : 0;        // 1 to start, 2 running, 0 done
+  result.room_min = result.room_max = host.sensors.plant().roomTemperature();
+
+  for (unsigned long t = 0; t < duration; t += 100) {
+    host.clock.set(t);
+
+    //The thermostat steps the setpoint or the radiator valves open, measured from here on
+    if (t == change_at) {
+      setpoint = options.change_to;
+      setpoint_request = frame_with_parity(0x10010000UL | ((unsigned long)(setpoint * 256) & 0xFFFF));
+      event.start(t, setpoint, window_sum / window.size(), 1.0);
+    }
+    if (t == load_at) {
+      PlantParameters parameters = plant_defaults;
+      parameters.radiator_power *= options.load;
+      host.sensors.plant().setParameters(parameters);
+      event.start(t, setpoint, window_sum / window.size(), 1.0);
+    }
+
+    //OpenHAB publishes the outside temperature, lowest at the start of the day
+    if (t % 300000 == 0) {
+      double outside = options.outside - options.outside_swing * cos(2.0 * M_PI * t / 86400000.0);
+      snprintf (payload, sizeof(payload), "%.1f", outside);
+      host.receive("ecv/sensors/outside_temperature", payload);
+    }
+
+    if (t % 1000 == 0) {
+      ecv.processRequest((t / 1000) % 2 == 0 ? status_request : setpoint_request);
+      result.frames++;
+    }
+
+    //The step controller sets the modulation every minute, the PID follows it within the limits
+    if (options.controller == CONTROL_STEP && ecv.ch_enabled == 1 && t - last_step >= STEP_INTERVAL) {
+      double modulation = step_modulation(ecv.control_ch_setpoint - ecv.heater_temp);
+      ecv.pid.setOutputLimits(modulation, modulation + STEP_HOLD);
+      last_step = t;
+    }
+
+    //Start the auto-tune with the CH request once the setpoint arrived, it runs around the target at the start,
+    //and confirm the gains when it is done
+    if (autotune == 1 && ecv.ch_enabled == 1 && ecv.control_ch_setpoint > 0) {
+      host.receive("ecv/command/autotune", "1");
+      autotune = 2;
+    }
+    if (autotune == 2 && ecv.autotune.state() == AUTOTUNE_DONE) {
+      host.receive("ecv/command/autotune", "2");
+      autotune = 0;
+    }
+    ecv.loop();
+
+    //The OpenHAB rule reports the CH mode and the flame of the active stage back
+    int ch_mode = ecv.ch_enabled == 1 ? 1 : 0;
+    int flame   = ecv.stages.stage() > 0 ? 1 : 0;
+    if (ch_mode != ecv.follower_status[6]) { host.receive("ecv/status/ch_mode", ch_mode ? "1" : "0"); }
+    if (flame != ecv.follower_status[4])   { host.receive("ecv/status/flame", flame ? "1" : "0"); }
+
+    //Measure from the first sensor reading
+    if (t % 1000 == 0 && ecv.heater_temp != 0) {
+      if (!started) {
+        metrics.start(t, options.setpoint, ecv.heater_temp, 1.0);
+        started = true;
+      }
+      metrics.add(t, ecv.heater_temp, ecv.stages.stage());
+      window_sum += ecv.heater_temp - window[window_next];
+      window[window_next] = ecv.heater_temp;
+      window_next = (window_next + 1) % window.size();
+      if (t >= change_at || t >= load_at) { event.add(t, window_sum / window.size(), ecv.stages.stage()); }
+    }
+
+    //The room against the design temperature of 20 C
+    if (t % 1000 == 0) {
+      double room = host.sensors.plant().roomTemperature();
+      if (room < result.room_min) { result.room_min = room; }
+      if (room > result.room_max) { result.room_max = room; }
+      result.room_iae += fabs(room - 20.0) / 3600.0;
+    }
+  }
+
+  result.publishes = host.mqtt.published;
+  result.flow      = host.sensors.plant().flowTemperature();
+  result.ret       = host.sensors.plant().returnTemperature();
+  result.room      = host.sensors.plant().roomTemperature();
+  result.overshoot = metrics.overshoot();
+  result.settling  = metrics.settlingTime();
+  result.switches  = metrics.switchCount();
+  result.iae       = metrics.integralAbsoluteError();
+  result.energy    = ecv.counters.energyWh() / 1000.0;
+  if (change_at < duration || load_at < duration) {
+    result.event_overshoot = event.overshoot();
+    result.event_settling  = event.settlingTime();
+    result.event_switches  = event.switchCount();
+    result.event_iae       = event.integralAbsoluteError();
+  }
+  result.counters  = ecv.countersFormat();
+  if (options.autotune) {
+    result.autotune    = autotune_names[ecv.autotune.state()];
+    result.autotune_kp = ecv.autotune.kp();
+    result.autotune_ki = ecv.autotune.ki();
+  }
+}
+
+//FUNCTION: One row of the comparison
+static void print_row(FILE* out, const char* name, const SimResult& result) {
+  fprintf(out, "%-10s %9.2f %10ld %9lu %10.0f %8.2f\n", name, result.overshoot, result.settling < 0 ? -1L : result.settling / 1000,
+    result.switches, result.iae, result.room);
+}
+
+bool compare_controllers(const SimOptions& options, FILE* out) {
+  SimOptions step = options;
+  step.controller = CONTROL_STEP;
+  SimOptions pid = options;
+  pid.controller = CONTROL_PID;
+
+  SimResult step_result, pid_result;
+  run_control_sim(step, step_result);
+  run_control_sim(pid, pid_result);
+
+  fprintf(out, "%-10s %9s %10s %9s %10s %8s\n", "controller", "overshoot", "settling_s", "switches", "iae_cs", "room");
+  print_row(out, sim_controller_name(CONTROL_STEP), step_result);
+  print_row(out, sim_controller_name(CONTROL_PID), pid_result);
+
+  //The step controller has no integral action, the flow stays below the setpoint by the error of its band
+  bool better = pid_result.settling >= 0 && pid_result.overshoot <= SIM_PID_MAX_OVERSHOOT && pid_result.iae < step_result.iae;
+  fprintf(out, "pid: %s\n", better ? "better than the step controller" : "NOT better than the step controller");
+  return better;
+}
+
+//FUNCTION: One row of the heating curve comparison
+static void print_room_row(FILE* out, const char* name, const SimResult& result) {
+  fprintf(out, "%-10s %8.2f %8.2f %10.1f %9.1f %9lu\n", name, result.room_min, result.room_max, result.room_iae,
+    result.energy, result.switches);
+}
+
+bool compare_heating_curve(const SimOptions& options, FILE* out) {
+  SimOptions setpoint = options;
+  setpoint.controller = CONTROL_PID;
+  setpoint.curve      = false;
+  if (setpoint.outside_swing == 0) { setpoint.outside_swing = 5; }
+  SimOptions curve = setpoint;
+  curve.curve = true;
+
+  SimResult setpoint_result, curve_result;
+  run_control_sim(setpoint, setpoint_result);
+  run_control_sim(curve, curve_result);
+
+  fprintf(out, "%-10s %8s %8s %10s %9s %9s\n", "target", "room_min", "room_max", "room_iae_ch", "energy", "switches");
+  print_room_row(out, "setpoint", setpoint_result);
+  print_room_row(out, "curve", curve_result);
+
+  //The curve raises the flow in the cold night and lowers it in the day, the room stays closer to 20 C
+  bool better = curve_result.room_iae < setpoint_result.room_iae;
+  fprintf(out, "curve: %s\n", better ? "room closer to 20 C than on the setpoint" : "room NOT closer to 20 C than on the setpoint");
+  return better;
+}
+
+//FUNCTION: One row of the feed-forward comparison
+static void print_event_row(FILE* out, const char* name, const char* feed_forward, const SimResult& result) {
+  fprintf(out, "%-10s %-4s %9.2f %10ld %9lu %10.0f\n", name, feed_forward, result.event_overshoot,
+    result.event_settling < 0 ? -1L : result.event_settling / 1000, result.event_switches, result.event_iae);
+}
+
+//FUNCTION: The event metrics of a settle faster than those of b, or b does not settle
+static bool settles_faster(const SimResult& a, const SimResult& b) {
+  return a.event_settling >= 0 && (b.event_settling < 0 || a.event_settling <= b.event_settling);
+}
+
+bool compare_feed_forward(const SimOptions& options, FILE* out) {
+  SimOptions change = options;
+  change.controller = CONTROL_PID;
+  change.load_at    = -1;
+  if (change.change_at < 0) {
+    change.setpoint  = options.setpoint + 10;
+    change.change_at = 12;
+    change.change_to = options.setpoint;
+  }
+  SimOptions load = options;
+  load.controller = CONTROL_PID;
+  load.change_at  = -1;
+  if (load.load_at < 0) {
+    load.load_at = 12;
+    load.load    = 1.5;
+  }
+
+  SimResult results[4];
+  const SimOptions* runs[2] = { &change, &load };
+  for (int i = 0; i < 4; i++) {
+    SimOptions run = *runs[i / 2];
+    run.feed_forward = i % 2 == 0;
+    run_control_sim(run, results[i]);
+  }
+
+  fprintf(out, "%-10s %-4s %9s %10s %9s %10s\n", "event", "ff", "overshoot", "settling_s", "switches", "iae_cs");
+  print_event_row(out, "setpoint", "on", results[0]);
+  print_event_row(out, "setpoint", "off", results[1]);
+  print_event_row(out, "load", "on", results[2]);
+  print_event_row(out, "load", "off", results[3]);
+
+  //The feed-forward drops with the target at once, the PID alone waits for the error to integrate. After the load
+  //change it follows the return temperature, the radiators taking more heat, without overshooting more
+  const SimResult& step_on  = results[0];
+  const SimResult& step_off = results[1];
+  const SimResult& load_on  = results[2];
+  const SimResult& load_off = results[3];
+  bool step_better = settles_faster(step_on, step_off) && step_on.event_overshoot < step_off.event_overshoot &&
+    step_on.event_switches <= step_off.event_switches;
+  bool load_better = settles_faster(load_on, load_off) && load_on.event_overshoot <= load_off.event_overshoot + FF_OVERSHOOT_MARGIN &&
+    load_on.event_switches <= load_off.event_switches;
+  fprintf(out, "feed-forward: %s after the setpoint step, %s after the load change\n",
+    step_better ? "settles faster with fewer switches" : "does NOT settle faster with fewer switches",
+    load_better ? "settles faster with fewer switches" : "does NOT settle faster with fewer switches");
+  return step_better && load_better;
+}
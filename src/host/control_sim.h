@@ -0,0 +1,92 @@
+//Closed-loop runs of the E-CV control on the plant model
+//
+//The core and the plant run on HostClock. The thermostat sends CH on and the control setpoint every second like a
+//real leader, the OpenHAB rule reports the CH mode and the flame of the active stage back. The flow temperature is
+//measured with ControlMetrics from the first sensor reading against the setpoint, the room against 20 C. The
+//controller is one of:
+// - CONTROL_PID   the PID controller of pid_controller.h as the core runs it
+// - CONTROL_STEP  the proportional step of the E-CV before the PID: 0 to 100 % over a flow error of 2 to 20 C,
+//                 updated every 60 s. The core PID is held at the step value with its output limits
+//The options switch on the heating curve of the core (the flow target from the outside temperature in place of the
+//setpoint) and a relay auto-tune at the first CH request, its gains are confirmed when it is done. OpenHAB
+//publishes the outside temperature every 5 minutes, with outside_swing it follows a daily cycle lowest at the
+//start of the day.
+//A setpoint step of the thermostat or a load change of the radiators (the thermostatic valves open or close) during
+//the run is measured again with its own ControlMetrics from that moment on, on the mean flow over the stage period:
+//the time-proportioning holds that mean and its ripple within a period would decide the settling time.
+//compare_controllers() runs the same day with both controllers and checks that the PID does better,
+//compare_heating_curve() runs a day with the outside temperature cycle on the setpoint and on the curve,
+//compare_feed_forward() runs a setpoint step and a load change with and without the feed-forward.
+
+#ifndef CONTROL_SIM_H
+#define CONTROL_SIM_H
+
+#include <stdio.h>
+#include <string>
+
+enum SimController { CONTROL_PID, CONTROL_STEP };
+
+//Overshoot in C of the PID at the cold start of the day, with a quarter of the demand fed forward. The integral of the
+//heat-up takes the PID alone 3.8 C past the setpoint
+#define SIM_PID_MAX_OVERSHOOT 2.5
+//Overshoot after a load change that the feed-forward may add, the resolution of the 1-Wire sensors
+#define FF_OVERSHOOT_MARGIN (1.0 / 16)
+
+struct SimOptions {
+  double hours             = 24;
+  double outside           = 0;         // C
+  double setpoint          = 45;        // C, control setpoint of the thermostat (ID 1)
+  SimController controller = CONTROL_PID;
+  double outside_swing     = 0;         // C, amplitude of the daily outside temperature cycle
+  bool curve               = false;     // Flow target from the heating curve
+  double slope             = 1.8;       // Heating curve slope matched to the plant model and parallel shift in C
+  double shift             = 0;
+  bool autotune            = false;     // Relay auto-tune at the first CH request
+  bool feed_forward        = true;      // Feed-forward of the heat demand, off with ff_gain 0
+  double change_at         = -1;        // h, setpoint step to change_to, -1 without
+  double change_to         = 45;        // C
+  double load_at           = -1;        // h, radiator output times load, the valves open or close, -1 without
+  double load              = 1;
+};
+
+struct SimResult {
+  unsigned long frames    = 0;
+  unsigned long publishes = 0;
+  double flow             = 0;          // C, plant at the end of the run
+  double ret              = 0;
+  double room             = 0;
+  double overshoot        = 0;          // C past the setpoint
+  long settling           = -1;         // ms until the flow stays within 1 C, -1 if it does not
+  unsigned long switches  = 0;          // Heater stage changes
+  double iae              = 0;          // Integral absolute error of the flow in C*s
+  double room_min         = 0;          // C
+  double room_max         = 0;
+  double room_iae         = 0;          // Integral absolute error of the room against 20 C in C*h
+  double energy           = 0;          // kWh delivered by the heater
+  double event_overshoot  = 0;          // Flow metrics from the setpoint step or load change on
+  long event_settling     = -1;
+  unsigned long event_switches = 0;
+  double event_iae        = 0;
+  const char* autotune    = "";         // State of the auto-tune at the end, the tuned gains if it is done
+  double autotune_kp      = 0;
+  double autotune_ki      = 0;
+  std::string counters;                 // Counters JSON of the core at the end
+};
+
+void run_control_sim(const SimOptions& options, SimResult& result);
+const char* sim_controller_name(SimController controller);
+
+//Run the options with the step and the PID controller and print a row per run to out. Returns false if the PID
+//does not settle or overshoots more than SIM_PID_MAX_OVERSHOOT or integrates more error than the step controller
+bool compare_controllers(const SimOptions& options, FILE* out);
+//Run the options with outside_swing 5 C if it is not set, on the setpoint and on the heating curve, print a row per
+//run to out. Returns false if the curve does not keep the room closer to 20 C
+bool compare_heating_curve(const SimOptions& options, FILE* out);
+//Run the setpoint step and the load change apart with and without the feed-forward, a step from 10 C above the
+//setpoint down to it and 1.5 times the radiator output after 12 h if they are not set, and print a row per run to
+//out. Returns false if the feed-forward does not settle faster with less overshoot and no more stage changes after
+//the setpoint step, or does not settle as fast with no more stage changes and at most a sensor step more overshoot
+//after the load change
+bool compare_feed_forward(const SimOptions& options, FILE* out);
+
+#endif
@@ -0,0 +1,200 @@
+//Fleet of E-CV instances in one process, see fleet.h
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <ecv_core.h>
+#include <plant_sensors.h>
+#include "fleet.h"
+#include "host_platform.h"
+#include "mqtt_broker.h"
+#include "mqtt_client.h"
+#include "virtual_thermostat.h"
+
+static double now_us() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//The MQTT connection of an instance, replaces the ecv of the topics with the prefix and times the ping probe
+class FleetMqtt : public MqttClient {
+  public:
+    bool publish(const char* topic, const char* payload, bool retained) override {
+      if (strcmp(topic, "ecv/probe/ping") == 0) { pings[payload] = now_us(); }
+      return MqttClient::publish(prefixed(topic).c_str(), payload, retained);
+    }
+
+    bool subscribe(const char* topic, int qos) override {
+      return MqttClient::subscribe(prefixed(topic).c_str(), qos);
+    }
+
+    //Topic of the core for a received topic, nullptr if it is not of this instance
+    const char* local(const char* topic, std::string& buffer) const {
+      size_t length = prefix.size();
+      if (strncmp(topic, prefix.c_str(), length) != 0 || topic[length] != '/') { return nullptr; }
+      buffer = "ecv";
+      buffer += topic + length;
+      return buffer.c_str();
+    }
+
+    std::string prefix;
+    std::map<std::string, double> pings;
+
+  private:
+    std::string prefixed(const char* topic) const {
+      return strncmp(topic, "ecv/", 4) == 0 ? prefix + (topic + 3) : std::string(topic);
+    }
+};
+
+//Notes when the reply goes out
+class TimedLink : public OpenThermLink {
+  public:
+    void sendResponse(unsigned long frame) override {
+      response = frame;
+      sent_at = now_us();
+    }
+
+    unsigned long response = 0;
+    double sent_at = 0;
+};
+
+class FleetInstance {
+  public:
+    FleetInstance(int index, const FleetOptions& options)
+      : sensors(clock), storage(nullptr), ecv(clock, link, mqtt, sensors, storage, debug, system), thermostat(POLL_RANDOM, index + 1),
+        options(options) {
+      char text[16];
+      snprintf(text, sizeof(text), "ecv%03d", index + 1);
+      mqtt.prefix = text;
+      result.prefix = text;
+      snprintf(text, sizeof(text), "ECV%03d", index + 1);
+      client_id = text;
+      will_topic = mqtt.prefix + "/system";
+      mqtt.host     = options.host != nullptr ? options.host : "127.0.0.1";
+      mqtt.username = options.username;
+      mqtt.password = options.password;
+      mqtt.setCallback([this](const char* topic, const uint8_t* payload, unsigned int length) { receive(topic, payload, length); });
+
+      ecv.begin();
+      ecv.timing = 0;
+      ecv.probe_interval = 1000;
+      //The instances do not start their frames all at the same time
+      next_frame = (index * 37) % 1000;
+    }
+
+    //One pass of the worker
+    void step(uint16_t port, bool sending) {
+      unsigned long now = clock.millis();
+      if (!mqtt.loop() && (result.connects == 0 || now - last_attempt >= 1000)) {
+        last_attempt = now;
+        if (mqtt.connect(port, client_id.c_str(), will_topic.c_str(), "E-CV is OFFLINE", true, false)) {
+          result.connects++;
+          ecv.mqttConnected();
+        }
+      }
+      ecv.loop();
+
+      if (sending && now >= next_frame) {
+        unsigned long request = thermostat.nextRequest();
+        double start = now_us();
+        ecv.processRequest(request);
+        result.reply_latency.push_back(link.sent_at - start);
+        if (thermostat.verify(request, link.response, ecv) & ~CHECK_KNOWN) { result.failed++; }
+        result.frames++;
+        //A worker that falls behind does not catch up with a burst
+        next_frame += (unsigned long)(1000 / options.rate);
+        if (now > next_frame + 1000) { next_frame = now; }
+      }
+    }
+
+    void finish() {
+      mqtt.disconnect();
+      result.published = mqtt.sent;
+      result.received  = mqtt.received;
+      std::sort(result.reply_latency.begin(), result.reply_latency.end());
+      std::sort(result.rtt.begin(), result.rtt.end());
+    }
+
+    int socket() const { return mqtt.socket(); }
+
+    SystemClock clock;
+    TimedLink link;
+    FleetMqtt mqtt;
+    PlantSensors sensors;
+    FileStorage storage;
+    HostDebug debug;
+    HostSystem system;
+    EcvCore ecv;
+    VirtualThermostat thermostat;
+    FleetInstanceResult result;
+
+  private:
+    void receive(const char* topic, const uint8_t* payload, unsigned int length) {
+      std::string buffer;
+      const char* local = mqtt.local(topic, buffer);
+      if (local == nullptr) { return; }
+      if (strcmp(local, "ecv/probe/ping") == 0) {
+        auto sent = mqtt.pings.find(std::string((const char*)payload, length));
+        if (sent != mqtt.pings.end()) {
+          result.rtt.push_back(now_us() - sent->second);
+          mqtt.pings.erase(sent);
+        }
+      }
+      ecv.callback(local, payload, length);
+    }
+
+    const FleetOptions& options;
+    std::string client_id;
+    std::string will_topic;
+    unsigned long next_frame;
+    unsigned long last_attempt = 0;
+};
+
+bool run_fleet(const FleetOptions& options, FleetResult& result) {
+  MqttBroker broker;
+  uint16_t port = options.port;
+  if (options.host == nullptr) {
+    if (!broker.start()) { return false; }
+    port = broker.port();
+  }
+
+  std::vector<std::unique_ptr<FleetInstance>> fleet;
+  for (int i = 0; i < options.instances; i++) { fleet.emplace_back(new FleetInstance(i, options)); }
+
+  //Worker w steps the instances w, w + threads, ...
+  int threads = std::max(1, std::min(options.threads, options.instances));
+  unsigned long duration = (unsigned long)(options.seconds * 1000);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads; w++) {
+    workers.emplace_back([&, w] {
+      std::vector<FleetInstance*> own;
+      for (size_t i = w; i < fleet.size(); i += threads) { own.push_back(fleet[i].get()); }
+      std::vector<pollfd> fds;
+      for (;;) {
+        unsigned long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        //The last 500ms only receive what is still on the way
+        if (elapsed >= duration + 500) { break; }
+        fds.clear();
+        for (FleetInstance* instance : own) {
+          instance->step(port, elapsed < duration);
+          fds.push_back(pollfd { instance->socket(), POLLIN, 0 });
+        }
+        poll(fds.data(), fds.size(), 1);
+      }
+      for (FleetInstance* instance : own) { instance->finish(); }
+    });
+  }
+  for (std::thread& worker : workers) { worker.join(); }
+  result.seconds = options.seconds;
+
+  broker.stop();
+  result.broker_published = broker.published;
+  result.broker_delivered = broker.delivered;
+  for (auto& instance : fleet) { result.instances.push_back(instance->result); }
+  return true;
+}
@@ -0,0 +1,52 @@
+//Fleet of E-CV instances in one process for load tests of a broker and the OpenHAB rules
+//
+//Every instance is a complete E-CV: its own core, plant model, virtual thermostat and MQTT connection with its own
+//client ID and topic prefix. The topics of the core start with ecv/, the connection replaces that with the prefix
+//of the instance: ecv001/thermostat/rawdata/rx, ecv002/... The instances are spread over a pool of worker threads,
+//a worker steps its instances in turn, so an instance is only used by one thread.
+//
+//Runs in wall time against the in-process broker or an external broker, measured per instance:
+// - reply latency   from the request frame until the core sends the reply, including its MQTT publishes
+// - broker RTT      of the ping probe of the core, once per second, in us
+// - publishes and received messages
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct FleetOptions {
+  int instances         = 10;
+  int threads           = 2;
+  double seconds        = 10;
+  double rate           = 1;            // Request frames per second per instance
+  const char* host      = nullptr;      // External broker, nullptr for the in-process broker
+  uint16_t port         = 1883;
+  const char* username  = nullptr;
+  const char* password  = nullptr;
+};
+
+struct FleetInstanceResult {
+  std::string prefix;
+  unsigned long frames    = 0;
+  unsigned long failed    = 0;          // Replies that failed the checks of the virtual thermostat
+  unsigned long published = 0;
+  unsigned long received  = 0;
+  unsigned long connects  = 0;
+  std::vector<double> reply_latency;    // us, sorted
+  std::vector<double> rtt;              // us, sorted
+};
+
+struct FleetResult {
+  std::vector<FleetInstanceResult> instances;
+  double seconds = 0;                   // Measured duration
+  unsigned long broker_published = 0;   // In-process broker only
+  unsigned long broker_delivered = 0;
+};
+
+//Run the fleet, returns false if the broker could not be started
+bool run_fleet(const FleetOptions& options, FleetResult& result);
+
+#endif
@@ -0,0 +1,473 @@
+//Node-RED test flows as scenarios against the in-process MQTT broker, see flows_scenario.h
+
+#include <ctype.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <utility>
+#include <ecv_core.h>
+#include "flows_scenario.h"
+#include "host_platform.h"
+#include "mqtt_broker.h"
+#include "mqtt_client.h"
+
+static double now_us() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//JSON, enough for a Node-RED export
+
+struct JsonValue {
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+  std::string text;                     // String, or the literal of a number or boolean
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  const JsonValue* get(const char* key) const {
+    for (const auto& member : members) {
+      if (member.first == key) { return &member.second; }
+    }
+    return nullptr;
+  }
+
+  //Text of a member, empty for a missing member or an array or object
+  std::string str(const char* key) const {
+    const JsonValue* value = get(key);
+    return value != nullptr && value->type != ARRAY && value->type != OBJECT ? value->text : "";
+  }
+};
+
+class JsonParser {
+  public:
+    explicit JsonParser(const std::string& json) : p(json.c_str()) {}
+
+    bool parse(JsonValue& value) {
+      if (!parseValue(value, 0)) { return false; }
+      space();
+      return *p == '\0';
+    }
+
+  private:
+    void space() { while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') { p++; } }
+
+    bool parseValue(JsonValue& value, int depth) {
+      if (depth > 64) { return false; }
+      space();
+      if (*p == '{') {
+        value.type = JsonValue::OBJECT;
+        p++;
+        space();
+        if (*p == '}') { p++; return true; }
+        while (true) {
+          std::string key;
+          space();
+          if (!parseString(key)) { return false; }
+          space();
+          if (*p++ != ':') { return false; }
+          value.members.emplace_back(key, JsonValue());
+          if (!parseValue(value.members.back().second, depth + 1)) { return false; }
+          space();
+          if (*p == ',') { p++; continue; }
+          if (*p == '}') { p++; return true; }
+          return false;
+        }
+      }
+      if (*p == '[') {
+        value.type = JsonValue::ARRAY;
+        p++;
+        space();
+        if (*p == ']') { p++; return true; }
+        while (true) {
+          value.items.emplace_back();
+          if (!parseValue(value.items.back(), depth + 1)) { return false; }
+          space();
+          if (*p == ',') { p++; continue; }
+          if (*p == ']') { p++; return true; }
+          return false;
+        }
+      }
+      if (*p == '"') {
+        value.type = JsonValue::STRING;
+        return parseString(value.text);
+      }
+      if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0) {
+        value.type = JsonValue::BOOLEAN;
+        value.text = *p == 't' ? "true" : "false";
+        p += *p == 't' ? 4 : 5;
+        return true;
+      }
+      if (strncmp(p, "null", 4) == 0) {
+        p += 4;
+        return true;
+      }
+      const char* start = p;
+      strtod(start, (char**)&p);
+      if (p == start) { return false; }
+      value.type = JsonValue::NUMBER;
+      value.text.assign(start, p - start);
+      return true;
+    }
+
+    bool parseString(std::string& text) {
+      if (*p++ != '"') { return false; }
+      while (*p != '"') {
+        if (*p == '\0') { return false; }
+        if (*p != '\\') { text += *p++; continue; }
+        p++;
+        switch (*p++) {
+          case '"':  text += '"'; break;
+          case '\\': text += '\\'; break;
+          case '/':  text += '/'; break;
+          case 'b':  text += '\b'; break;
+          case 'f':  text += '\f'; break;
+          case 'n':  text += '\n'; break;
+          case 'r':  text += '\r'; break;
+          case 't':  text += '\t'; break;
+          case 'u': {
+            char hex[5] = { 0 };
+            for (int i = 0; i < 4; i++) {
+              if (!isxdigit((unsigned char)p[i])) { return false; }
+              hex[i] = p[i];
+            }
+            p += 4;
+            //UTF-8 of the code unit, a surrogate pair is kept as two units
+            unsigned long code = strtoul(hex, nullptr, 16);
+            if (code < 0x80) {
+              text += (char)code;
+            } else if (code < 0x800) {
+              text += (char)(0xC0 | (code >> 6));
+              text += (char)(0x80 | (code & 0x3F));
+            } else {
+              text += (char)(0xE0 | (code >> 12));
+              text += (char)(0x80 | ((code >> 6) & 0x3F));
+              text += (char)(0x80 | (code & 0x3F));
+            }
+            break;
+          }
+          default: return false;
+        }
+      }
+      p++;
+      return true;
+    }
+
+    const char* p;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//Converter
+
+//Data-IDs whose reply reports an injected value, known for the IDs whose override never matches
+struct ReportedValue {
+  int id;
+  const char* topic;
+  bool known;
+};
+
+static const ReportedValue reported_values[] = {
+  { 0x0E, "ecv/command/max_rel_modulation",        true  },
+  { 0x12, "ecv/sensors/water_pressure_ch",         false },
+  { 0x13, "ecv/sensors/water_flow_dhw",            false },
+  { 0x19, "ecv/sensors/heater_flow_temperature",   false },
+  { 0x1A, "ecv/sensors/dhw_temperature",           true  },
+  { 0x1B, "ecv/sensors/outside_temperature",       true  },
+  { 0x1C, "ecv/sensors/return_water_temperature",  true  },
+  { 0x38, "ecv/command/dhw_setpoint",              false },
+  { 0x39, "ecv/command/max_ch_water_setpoint",     false },
+};
+
+struct FlowInject {
+  std::string name;
+  std::string topic;
+  std::string payload;
+  double x, y;
+  bool frame;
+};
+
+//Topic or payload of an inject node, from the props of Node-RED 1.x or the fields of older exports. Returns false
+//for a type that only has a value in a running Node-RED (flow, global, env, date)
+static bool inject_property(const JsonValue& node, const char* name, std::string& value) {
+  std::string type = strcmp(name, "payload") == 0 ? node.str("payloadType") : "str";
+  value = node.str(name);
+  const JsonValue* props = node.get("props");
+  if (props != nullptr) {
+    for (const JsonValue& prop : props->items) {
+      if (prop.str("p") != name || prop.get("v") == nullptr) { continue; }
+      value = prop.str("v");
+      type  = prop.str("vt");
+    }
+  }
+  return type.empty() || type == "str" || type == "num" || type == "json" || type == "bool";
+}
+
+bool flows_convert(const std::string& json, std::string& scenario, std::string& error) {
+  JsonValue flows;
+  if (!JsonParser(json).parse(flows) || flows.type != JsonValue::ARRAY) {
+    error = "not a Node-RED flows export";
+    return false;
+  }
+
+  std::vector<FlowInject> injects;
+  unsigned long skipped = 0;
+  for (const JsonValue& node : flows.items) {
+    if (node.str("type") != "inject") { continue; }
+    FlowInject inject;
+    inject.name = node.str("name");
+    if (!inject_property(node, "topic", inject.topic) || !inject_property(node, "payload", inject.payload) ||
+        inject.topic.empty()) {
+      skipped++;
+      continue;
+    }
+    inject.x = atof(node.str("x").c_str());
+    inject.y = atof(node.str("y").c_str());
+    inject.frame = inject.topic == "ecv/rawdata/command";
+    injects.push_back(inject);
+  }
+
+  //Values before frames, then top to bottom and left to right
+  std::stable_sort(injects.begin(), injects.end(), [](const FlowInject& a, const FlowInject& b) {
+    if (a.frame != b.frame) { return !a.frame; }
+    if (a.y != b.y) { return a.y < b.y; }
+    return a.x < b.x;
+  });
+
+  char line[256];
+  snprintf(line, sizeof(line), "#Converted from %zu inject nodes, %lu skipped\n", injects.size() + skipped, skipped);
+  scenario = line;
+  std::map<std::string, std::string> values;
+  for (const FlowInject& inject : injects) {
+    scenario += "\n#" + inject.name + "\n";
+    scenario += "inject " + inject.topic + " " + inject.payload + "\n";
+    if (!inject.frame) {
+      values[inject.topic] = inject.payload;
+      continue;
+    }
+
+    //The frame as the core formats it in rawdata/rx and the injected value in the reply
+    unsigned long frame = strtoul(inject.payload.c_str(), nullptr, 16) & 0xFFFFFFFFUL;
+    int id = (frame >> 16) & 0xFF;
+    snprintf(line, sizeof(line), "expect ecv/thermostat/rawdata/rx T-%08lx *\n", frame);
+    scenario += line;
+    const ReportedValue* reported = nullptr;
+    for (const ReportedValue& candidate : reported_values) {
+      if (candidate.id == id && values.count(candidate.topic) > 0) { reported = &candidate; }
+    }
+    if (reported == nullptr) {
+      snprintf(line, sizeof(line), "expect ecv/thermostat/rawdata/tx B-??%02x* Replied after: *\n", id);
+    } else {
+      snprintf(line, sizeof(line), "%sexpect ecv/thermostat/rawdata/tx B-??%02x* %.2f Replied after: *\n",
+        reported->known ? "known " : "", id, atof(values[reported->topic].c_str()));
+    }
+    scenario += line;
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//Scenario
+
+bool scenario_parse(const std::string& text, std::vector<ScenarioStep>& steps, std::string& error) {
+  steps.clear();
+  size_t start = 0;
+  int number = 0;
+  while (start < text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos) { end = text.size(); }
+    std::string line = text.substr(start, end - start);
+    start = end + 1;
+    number++;
+    if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+    if (line.empty() || line[0] == '#') { continue; }
+
+    ScenarioStep step;
+    step.line = number;
+    const char* p = line.c_str();
+    if (strncmp(p, "known ", 6) == 0) {
+      step.known = true;
+      p += 6;
+    }
+    const char* space = strchr(p, ' ');
+    std::string action = space != nullptr ? std::string(p, space - p) : std::string(p);
+    const char* rest = space != nullptr ? space + 1 : "";
+
+    if (action == "inject" || action == "expect") {
+      step.action = action == "inject" ? STEP_INJECT : STEP_EXPECT;
+      const char* topic_end = strchr(rest, ' ');
+      step.topic = topic_end != nullptr ? std::string(rest, topic_end - rest) : std::string(rest);
+      step.text  = topic_end != nullptr ? std::string(topic_end + 1) : std::string(step.action == STEP_EXPECT ? "*" : "");
+      if (step.topic.empty() || (step.known && step.action != STEP_EXPECT)) { step.topic.clear(); }
+    } else if (action == "timeout" || action == "wait") {
+      step.action = action == "timeout" ? STEP_TIMEOUT : STEP_WAIT;
+      char* number_end;
+      step.ms = strtoul(rest, &number_end, 10);
+      if (number_end == rest || step.known) { action.clear(); }
+    } else {
+      action.clear();
+    }
+    if (action.empty() || ((step.action == STEP_INJECT || step.action == STEP_EXPECT) && step.topic.empty())) {
+      error = "line " + std::to_string(number) + ": " + line;
+      return false;
+    }
+    steps.push_back(step);
+  }
+  return true;
+}
+
+bool scenario_matches(const char* pattern, const char* text) {
+  //Greedy match with backtracking to the last *
+  const char* star = nullptr;
+  const char* resume = nullptr;
+  while (*text != '\0') {
+    if (*pattern == '*') {
+      star = pattern++;
+      resume = text;
+    } else if (*pattern == '?' || *pattern == *text) {
+      pattern++;
+      text++;
+    } else if (star != nullptr) {
+      pattern = star + 1;
+      text = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*') { pattern++; }
+  return *pattern == '\0';
+}
+
+//The E-CV without 1-Wire sensors, the replies of ID 25 and 28 report the MQTT values
+class NoSensors : public TemperatureSensors {
+  public:
+    void read(float& flow, float& ret) override {
+      flow = 0;
+      ret  = 0;
+    }
+};
+
+struct ScenarioMessage {
+  std::string topic;
+  std::string payload;
+  double time;
+  bool used;
+};
+
+bool run_scenario(const std::vector<ScenarioStep>& steps, int repeat, FILE* report, ScenarioRun& run) {
+  MqttBroker broker;
+  if (!broker.start()) { return false; }
+
+  SystemClock clock;
+  CaptureLink link;
+  MqttClient core_mqtt;
+  NoSensors sensors;
+  FileStorage storage(nullptr);
+  HostDebug debug;
+  HostSystem system;
+  EcvCore ecv(clock, link, core_mqtt, sensors, storage, debug, system);
+  ecv.begin();
+  ecv.timing = 0;
+  core_mqtt.setCallback([&](const char* topic, const uint8_t* payload, unsigned int length) {
+    ecv.callback(topic, payload, length);
+  });
+
+  std::vector<ScenarioMessage> messages;
+  MqttClient nodered;
+  nodered.setCallback([&](const char* topic, const uint8_t* payload, unsigned int length) {
+    messages.push_back({ topic, std::string((const char*)payload, length), now_us(), false });
+  });
+
+  if (!core_mqtt.connect(broker.port(), "ECV", "ecv/system", "E-CV is OFFLINE", true, false) ||
+      !nodered.connect(broker.port(), "nodered")) {
+    broker.stop();
+    return false;
+  }
+  ecv.mqttConnected();
+  nodered.subscribe("ecv/#");
+
+  //Run the core, the clients and the broker until the deadline or until done() is true
+  auto pump = [&](double deadline, const std::function<bool()>& done) {
+    while (!done() && now_us() < deadline) {
+      core_mqtt.loop();
+      ecv.loop();
+      nodered.loop();
+      pollfd fds[2] = { { core_mqtt.socket(), POLLIN, 0 }, { nodered.socket(), POLLIN, 0 } };
+      poll(fds, 2, 1);
+    }
+  };
+
+  //The subscriptions of both clients are active when a message of the core arrives at Node-RED
+  core_mqtt.publish("ecv/scenario/ready", "1");
+  pump(now_us() + 2000000, [&]() {
+    for (const ScenarioMessage& message : messages) {
+      if (message.topic == "ecv/scenario/ready") { return true; }
+    }
+    return false;
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < repeat; pass++) {
+    unsigned long timeout = 250;
+    double injected = now_us();
+    for (const ScenarioStep& step : steps) {
+      switch (step.action) {
+        case STEP_TIMEOUT:
+          timeout = step.ms;
+          break;
+        case STEP_WAIT:
+          pump(now_us() + step.ms * 1000.0, []() { return false; });
+          break;
+        case STEP_INJECT:
+          messages.clear();
+          nodered.publish(step.topic.c_str(), step.text.c_str());
+          injected = now_us();
+          run.injects++;
+          break;
+        case STEP_EXPECT: {
+          //The next message on the topic since the inject, the expects of a topic take its messages in turn
+          ScenarioMessage* next = nullptr;
+          auto arrived = [&]() {
+            for (ScenarioMessage& message : messages) {
+              if (message.used || message.topic != step.topic) { continue; }
+              next = &message;
+              return true;
+            }
+            return false;
+          };
+          pump(now_us() + timeout * 1000.0, arrived);
+          if (next != nullptr) { next->used = true; }
+          if (next != nullptr && scenario_matches(step.text.c_str(), next->payload.c_str())) {
+            if (step.known) {
+              run.known_passed++;
+              if (report != nullptr) { fprintf(report, "line %d: known divergence passes: %s %s\n", step.line, step.topic.c_str(), step.text.c_str()); }
+            } else {
+              run.passed++;
+            }
+            run.latency.push_back(next->time - injected);
+            break;
+          }
+
+          if (step.known) { run.known_failed++; } else { run.failed++; }
+          if (report == nullptr || (step.known && pass > 0)) { break; }
+          fprintf(report, "line %d: %s%s %s\n", step.line, step.known ? "known divergence: " : "FAILED: ", step.topic.c_str(), step.text.c_str());
+          if (next != nullptr) {
+            fprintf(report, "  got: %s\n", next->payload.c_str());
+          } else {
+            fprintf(report, "  got nothing within %lu ms\n", timeout);
+          }
+          break;
+        }
+      }
+    }
+  }
+  run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::sort(run.latency.begin(), run.latency.end());
+
+  core_mqtt.disconnect();
+  nodered.disconnect();
+  broker.stop();
+  return true;
+}
@@ -0,0 +1,60 @@
+//Node-RED test flows as scenarios against the in-process MQTT broker
+//
+//test/flows.json holds the manual test injections of the E-CV: raw OpenTherm frames on ecv/rawdata/command and the
+//status, sensor and command values of OpenHAB. flows_convert() turns its inject nodes into a scenario, a text file
+//with one step per line:
+//  inject <topic> <payload>          publish as the inject node does, QoS 0 and not retained
+//  expect <topic> [pattern]          the next publish on topic after the last inject arrives within the timeout and
+//                                    its payload matches the pattern (* any text, ? one character). The expects of a
+//                                    topic take its messages in turn
+//  known expect <topic> [pattern]    same, for a known divergence: a failure is counted apart, a pass is reported
+//  timeout <ms>                      timeout of the following expects, 250 by default
+//  wait <ms>                         let the core and the broker run
+//  #...                              comment, the converter writes the name of the node
+//The injects are ordered top to bottom and left to right as on the tab, the frames after the values so the replies
+//report the injected values. Every frame expects its rawdata/rx and rawdata/tx, a frame of a data-ID that reports an
+//injected value expects that value in the reply. IDs 14 and 26 to 28 echo the request value, see golden_corpus.h,
+//their value is a known expect.
+//
+//run_scenario() runs the core and a Node-RED client on the in-process broker in wall time and times every expect
+//from the publish of its inject until the message arrives at the Node-RED client.
+
+#ifndef FLOWS_SCENARIO_H
+#define FLOWS_SCENARIO_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum ScenarioAction { STEP_INJECT, STEP_EXPECT, STEP_TIMEOUT, STEP_WAIT };
+
+struct ScenarioStep {
+  ScenarioAction action;
+  std::string topic;
+  std::string text;                     // Payload of an inject, pattern of an expect
+  unsigned long ms = 0;                 // Timeout or wait
+  bool known       = false;             // Known divergence
+  int line         = 0;
+};
+
+struct ScenarioRun {
+  unsigned long injects = 0;
+  unsigned long passed  = 0;
+  unsigned long failed  = 0;
+  unsigned long known_failed = 0;
+  unsigned long known_passed = 0;
+  std::vector<double> latency;          // us of the passed expects, sorted
+  double seconds = 0;
+};
+
+//Convert the inject nodes of a Node-RED flows export, returns false with the reason in error if it is not one
+bool flows_convert(const std::string& json, std::string& scenario, std::string& error);
+//Parse a scenario, returns false with the line in error on a syntax error
+bool scenario_parse(const std::string& text, std::vector<ScenarioStep>& steps, std::string& error);
+//Match a payload with a pattern of * and ?
+bool scenario_matches(const char* pattern, const char* text);
+//Run the steps repeat times in one session, the failed expects are printed to report. Returns false if the broker
+//could not start or a client could not connect.
+bool run_scenario(const std::vector<ScenarioStep>& steps, int repeat, FILE* report, ScenarioRun& run);
+
+#endif
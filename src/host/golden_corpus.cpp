@@ -0,0 +1,230 @@
+//Golden-response corpus of the OpenTherm protocol engine, see golden_corpus.h
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <ecv_core.h>
+#include <plant_sensors.h>
+#include "golden_corpus.h"
+#include "host_platform.h"
+
+//Data values of every ID and type: 0 and 1, the byte boundaries, the f8.8 range limits of the supported IDs (5 bar,
+//16 l/min, 100 %, -40 and 127 C) with one LSB beyond, and the extremes of u16 and s16
+static const unsigned int golden_values[] = {
+  0x0000, 0x0001, 0x00FF, 0x0100, 0x0500, 0x0501, 0x1000, 0x1001, 0x6400,
+  0x6401, 0x7F00, 0x7F01, 0x7FFF, 0x8000, 0xD800, 0xD7FF, 0xFFFF
+};
+
+//The message types of a request: READ-DATA, WRITE-DATA and INVALID-DATA
+static const int golden_types[] = { 0, 1, 2 };
+
+//Direction of the data-IDs in the table of processRequest(), 'R', 'W' or 0 for an ID without a description
+static char golden_direction(int id) {
+  switch (id) {
+    case 1: case 14: case 16: case 24:
+      return 'W';
+    case 0: case 3: case 5: case 17: case 18: case 19: case 25: case 26: case 27: case 28: case 56: case 57:
+      return 'R';
+    default:
+      return id >= 116 && id <= 123 ? 'R' : 0;
+  }
+}
+
+static const char* const golden_tag_names[GOLDEN_TAGS] = {
+  "id-case", "unknown-id", "direction", "invalid-data", "invalid-parity", "odd-parity"
+};
+
+//Records the publishes of a case as HostMqtt prints them
+class GoldenMqtt : public MqttLink {
+  public:
+    bool publish(const char* topic, const char* payload, bool retained) override {
+      text += retained ? "PUB(r) " : "PUB ";
+      text += topic;
+      text += ' ';
+      text += payload;
+      text += '\n';
+      return true;
+    }
+
+    bool subscribe(const char* topic, int qos) override {
+      (void)topic;
+      (void)qos;
+      return true;
+    }
+
+    bool connected() override { return true; }
+
+    std::string text;
+};
+
+static bool even_parity(unsigned long frame) {
+  return __builtin_popcountl(frame & 0xFFFFFFFFUL) % 2 == 0;
+}
+
+std::vector<unsigned long> golden_requests() {
+  std::vector<unsigned long> requests;
+  for (int id = 0; id < 256; id++) {
+    for (int type : golden_types) {
+      for (unsigned int value : golden_values) {
+        requests.push_back(frame_with_parity(((unsigned long)type << 28) | ((unsigned long)id << 16) | value));
+      }
+    }
+  }
+  return requests;
+}
+
+int golden_tags(unsigned long request) {
+  int type = (request >> 28) & 7;
+  int id   = (request >> 16) & 0xFF;
+  char direction = golden_direction(id);
+  int tags = 0;
+
+  if (id == 14 || (id >= 26 && id <= 28)) { tags |= GOLDEN_ID_CASE; }
+  if (direction == 0) { tags |= GOLDEN_UNKNOWN_ID; }
+  //The counters accept a WRITE-DATA, 0 resets them
+  bool counter = id >= 116 && id <= 123;
+  if ((type == 0 && direction == 'W') || (type == 1 && direction == 'R' && !counter)) { tags |= GOLDEN_DIRECTION; }
+  if (type == 2) {
+    tags |= GOLDEN_INVALID_DATA;
+    if (request & 0x80000000UL) { tags |= GOLDEN_INVALID_PARITY; }
+  }
+  return tags;
+}
+
+const char* golden_tag_name(int index) {
+  return index >= 0 && index < GOLDEN_TAGS ? golden_tag_names[index] : "";
+}
+
+void golden_run(unsigned long request, GoldenCase& result) {
+  HostClock clock;
+  clock.set(1000);
+  CaptureLink link;
+  GoldenMqtt mqtt;
+  PlantSensors sensors(clock);
+  FileStorage storage(nullptr);
+  HostDebug debug;
+  HostSystem system;
+  EcvCore ecv(clock, link, mqtt, sensors, storage, debug, system);
+  ecv.begin();
+  ecv.timing = 0;
+
+  ecv.processRequest(request);
+  result.request   = request;
+  result.replied   = link.responses > 0;
+  result.reply     = link.response;
+  result.parity    = even_parity(link.response);
+  result.publishes = mqtt.text;
+  result.tags      = golden_tags(request) | (result.parity ? 0 : GOLDEN_ODD_PARITY);
+}
+
+double golden_generate(std::vector<GoldenCase>& corpus) {
+  std::vector<unsigned long> requests = golden_requests();
+  corpus.assign(requests.size(), GoldenCase());
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < requests.size(); i++) {
+    golden_run(requests[i], corpus[i]);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void write_tags(FILE* file, int tags) {
+  bool first = true;
+  for (int i = 0; i < GOLDEN_TAGS; i++) {
+    if (!(tags & (1 << i))) { continue; }
+    fprintf(file, "%s%s", first ? " " : ",", golden_tag_names[i]);
+    first = false;
+  }
+}
+
+static void write_case(FILE* file, const GoldenCase& entry) {
+  if (entry.replied) {
+    fprintf(file, "%08lx %08lx %s", entry.request, entry.reply, entry.parity ? "even" : "odd");
+  } else {
+    fprintf(file, "%08lx - -", entry.request);
+  }
+  write_tags(file, entry.tags);
+  fputc('\n', file);
+
+  //The publishes indented, one per line
+  const char* line = entry.publishes.c_str();
+  while (*line != '\0') {
+    const char* end = strchr(line, '\n');
+    size_t length = end != nullptr ? (size_t)(end - line) : strlen(line);
+    fprintf(file, "  %.*s\n", (int)length, line);
+    line += length + (end != nullptr ? 1 : 0);
+  }
+}
+
+bool golden_save(FILE* file, const std::vector<GoldenCase>& corpus) {
+  fprintf(file, "#E-CV golden corpus, %zu cases\n", corpus.size());
+  for (const GoldenCase& entry : corpus) { write_case(file, entry); }
+  return !ferror(file);
+}
+
+bool golden_load(FILE* file, std::vector<GoldenCase>& corpus) {
+  corpus.clear();
+  char line[512];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (line[0] == '#' || line[0] == '\n') { continue; }
+    if (line[0] == ' ') {
+      //A publish of the last case
+      if (corpus.empty() || line[1] != ' ') { return false; }
+      corpus.back().publishes += line + 2;
+      if (corpus.back().publishes.back() != '\n') { corpus.back().publishes += '\n'; }
+      continue;
+    }
+
+    GoldenCase entry;
+    char reply[16], parity[8];
+    if (sscanf(line, "%lx %15s %7s", &entry.request, reply, parity) != 3) { return false; }
+    entry.replied = strcmp(reply, "-") != 0;
+    entry.reply   = entry.replied ? strtoul(reply, nullptr, 16) : 0;
+    entry.parity  = strcmp(parity, "even") == 0;
+    entry.tags    = golden_tags(entry.request) | (entry.parity || !entry.replied ? 0 : GOLDEN_ODD_PARITY);
+    corpus.push_back(entry);
+  }
+  return true;
+}
+
+static bool same_case(const GoldenCase& a, const GoldenCase& b) {
+  return a.replied == b.replied && a.reply == b.reply && a.parity == b.parity && a.publishes == b.publishes;
+}
+
+GoldenCheck golden_check(const std::vector<GoldenCase>& expected, FILE* report, unsigned long max_report) {
+  GoldenCheck check;
+  std::vector<GoldenCase> corpus;
+  check.seconds = golden_generate(corpus);
+  check.cases   = corpus.size();
+
+  //Both are in the order of golden_requests(), a corpus of another version is matched by request
+  size_t j = 0;
+  unsigned long reported = 0;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    const GoldenCase& actual = corpus[i];
+    while (j < expected.size() && expected[j].request != actual.request) {
+      j++;
+      check.missing++;
+    }
+    if (j == expected.size()) {
+      check.missing += corpus.size() - i;
+      break;
+    }
+    const GoldenCase& golden = expected[j++];
+    if (same_case(golden, actual)) { continue; }
+
+    //The tags of the recorded case, a reply that turns odd is not a known divergence
+    if (golden.tags == 0) { check.regressions++; } else { check.known++; }
+    for (int t = 0; t < GOLDEN_TAGS; t++) {
+      if (golden.tags & (1 << t)) { check.tag_changed[t]++; }
+    }
+    if (report != nullptr && reported < max_report) {
+      reported++;
+      fprintf(report, "%s\nexpected: ", golden.tags == 0 ? "REGRESSION" : "known divergence changed");
+      write_case(report, golden);
+      fprintf(report, "actual:   ");
+      write_case(report, actual);
+    }
+  }
+  check.missing += expected.size() - j;
+  return check;
+}
@@ -0,0 +1,72 @@
+//Golden-response corpus of the OpenTherm protocol engine
+//
+//Every data-ID 0 to 255 as READ-DATA, WRITE-DATA and INVALID-DATA with the boundary data values of golden_values,
+//each on a fresh core at the same virtual time, so a case does not depend on the cases before it. A case records
+//the reply frame, whether its parity is even, and the MQTT publishes of processRequest() in order. The corpus of
+//a known good commit is saved as text and later commits are checked against it, a refactor of processRequest()
+//must give exactly the same corpus.
+//
+//The corpus records the behavior of the core, not the OpenTherm specification. Cases where the two are known to
+//differ are tagged, a changed tagged case is reported apart from the regressions:
+// - GOLDEN_ID_CASE        IDs 14 and 26 to 28, the override compares "0E", "1A" to "1C" with the lowercase data-ID
+//                         of the frame ("0e"), it never matches and the request value is echoed
+// - GOLDEN_UNKNOWN_ID     IDs without a description, acknowledged with the request value instead of UNKNOWN-DATAID
+// - GOLDEN_DIRECTION      READ-DATA of a write ID or WRITE-DATA of a read ID, the reply type follows the ID
+// - GOLDEN_INVALID_DATA   INVALID-DATA requests are answered as a valid request
+// - GOLDEN_INVALID_PARITY INVALID-DATA with the parity bit set, the type check looks for an uppercase 'A' in the
+//                         lowercase hex of the frame, rawdata/rx shows NO_VALID_INPUT
+// - GOLDEN_ODD_PARITY     the reply has an odd parity. processRequest() counts the parity per ID and type, request
+//                         bits that are echoed (the high byte of ID 0, ID 3 and 5, the unknown IDs) and most
+//                         DATA-INVALID replies are not counted right. Tagged from the recorded reply, a case that
+//                         turns odd is a regression
+
+#ifndef GOLDEN_CORPUS_H
+#define GOLDEN_CORPUS_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define GOLDEN_ID_CASE        1
+#define GOLDEN_UNKNOWN_ID     2
+#define GOLDEN_DIRECTION      4
+#define GOLDEN_INVALID_DATA   8
+#define GOLDEN_INVALID_PARITY 16
+#define GOLDEN_ODD_PARITY     32
+#define GOLDEN_TAGS           6
+
+struct GoldenCase {
+  unsigned long request = 0;          // Including the parity bit
+  unsigned long reply   = 0;
+  bool replied          = false;
+  bool parity           = false;      // Even parity of the reply
+  std::string publishes;              // "PUB[(r)] <topic> <payload>" lines
+  int tags              = 0;          // GOLDEN_* bits
+};
+
+struct GoldenCheck {
+  unsigned long cases       = 0;
+  unsigned long regressions = 0;      // Changed cases without a tag
+  unsigned long known       = 0;      // Changed cases with a tag
+  unsigned long missing     = 0;      // Cases of the corpus file that are not generated, or the other way around
+  unsigned long tag_changed[GOLDEN_TAGS] = {};
+  double seconds            = 0;      // Wall time of the generation
+};
+
+//Request frames of the corpus in a fixed order
+std::vector<unsigned long> golden_requests();
+//Run one request on a fresh core
+void golden_run(unsigned long request, GoldenCase& result);
+//Known divergence tags of a request, without GOLDEN_ODD_PARITY
+int golden_tags(unsigned long request);
+const char* golden_tag_name(int index);
+
+//Generate the complete corpus, returns the wall time in seconds
+double golden_generate(std::vector<GoldenCase>& corpus);
+//Text format: "<request> <reply|-> <even|odd> [tag,...]" and the publishes of the case indented by 2 spaces
+bool golden_save(FILE* file, const std::vector<GoldenCase>& corpus);
+bool golden_load(FILE* file, std::vector<GoldenCase>& corpus);
+//Generate the corpus and compare it with expected, prints up to max_report changed cases with both versions
+GoldenCheck golden_check(const std::vector<GoldenCase>& expected, FILE* report, unsigned long max_report);
+
+#endif
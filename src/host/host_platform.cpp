@@ -0,0 +1,129 @@
+//Linux implementation of the E-CV hardware abstraction, see host_platform.h
+
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "alloc_counter.h"
+#include "host_platform.h"
+
+//Pattern of the painted stack, as the cont stack of the ESP8266 core
+#define STACK_PATTERN 0xFEEFEFFEUL
+
+SystemClock::SystemClock() : start(std::chrono::steady_clock::now()) {}
+
+unsigned long SystemClock::millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SystemClock::wait(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+bool HostMqtt::publish(const char* topic, const char* payload, bool retained) {
+  published++;
+  if (out != nullptr) { fprintf(out, "PUB%s %s %s\n", retained ? "(r)" : "", topic, payload); }
+  return online;
+}
+
+bool HostMqtt::subscribe(const char* topic, int qos) {
+  if (out != nullptr) { fprintf(out, "SUB %s %d\n", topic, qos); }
+  return online;
+}
+
+bool FileStorage::begin() {
+  if (directory == nullptr) { return false; }
+  struct stat info;
+  return stat(directory, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool FileStorage::read(const char* name, void* data, size_t length) {
+  char path[256];
+  snprintf (path, sizeof(path), "%s%s", directory, name);
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) { return false; }
+  bool complete = fread(data, 1, length, file) == length;
+  fclose(file);
+  return complete;
+}
+
+bool FileStorage::write(const char* name, const void* data, size_t length) {
+  char path[256];
+  snprintf (path, sizeof(path), "%s%s", directory, name);
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) { return false; }
+  bool complete = fwrite(data, 1, length, file) == length;
+  fclose(file);
+  return complete;
+}
+
+//Free chunks of the allocator below the top of the heap, and the part of them that is not in the small chunks of
+//the fastbins. 0 without glibc 2.33
+static void heap_holes(unsigned long& holes, unsigned long& large) {
+  holes = 0;
+  large = 0;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  if (info.fordblks > info.keepcost) { holes = info.fordblks - info.keepcost; }
+  if (holes > info.fsmblks) { large = holes - info.fsmblks; }
+#endif
+}
+
+//Paint size bytes of the stack below the caller, the pattern stays after the return. Returns the lowest address
+static __attribute__((noinline)) uintptr_t paint_stack(size_t size) {
+  volatile uint32_t area[HOST_STACK_SIZE / 4];
+  size_t words = size / 4 < HOST_STACK_SIZE / 4 ? size / 4 : HOST_STACK_SIZE / 4;
+  for (size_t i = 0; i < words; i++) { area[i] = STACK_PATTERN; }
+  return (uintptr_t)area;
+}
+
+HostSystem::HostSystem(unsigned long heap_size, size_t stack_size)
+  : heap_size(heap_size), heap_base(alloc_live()), stack_size(stack_size) {
+  heap_holes(holes_base, large_base);
+  if (this->stack_size > HOST_STACK_SIZE) { this->stack_size = HOST_STACK_SIZE; }
+  stack_bottom = paint_stack(this->stack_size);
+}
+
+void HostSystem::read(SystemStats& stats) {
+  unsigned long live = alloc_live();
+  unsigned long used = live > heap_base ? live - heap_base : 0;
+  stats.free_heap = used < heap_size ? heap_size - used : 0;
+
+  //The free heap above the holes is one block, the large holes are taken as one block as mallinfo2() has no sizes
+  unsigned long holes, large;
+  heap_holes(holes, large);
+  holes = holes > holes_base ? holes - holes_base : 0;
+  large = large > large_base ? large - large_base : 0;
+  stats.max_free_block = holes < stats.free_heap ? stats.free_heap - holes : 0;
+  if (large > stats.max_free_block) { stats.max_free_block = large < stats.free_heap ? large : stats.free_heap; }
+  stats.fragmentation  = stats.free_heap > 0 ? 100 - (int)(100 * stats.max_free_block / stats.free_heap) : 0;
+
+  //The stack grows down, the words from the bottom that still hold the pattern are never used
+  const volatile uint32_t* area = (const volatile uint32_t*)stack_bottom;
+  size_t words = 0;
+  while (words < stack_size / 4 && area[words] == STACK_PATTERN) { words++; }
+  stats.stack_free = words * 4;
+}
+
+HostEcv::HostEcv(FILE* mqtt_out, FILE* debug_out)
+  : mqtt(mqtt_out), sensors(clock), storage(nullptr), debug(debug_out), ecv(clock, link, mqtt, sensors, storage, debug, system) {
+  ecv.begin();
+  ecv.timing = 0;
+}
+
+void HostEcv::receive(const char* topic, const char* payload) {
+  ecv.callback(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+unsigned long frame_with_parity(unsigned long frame) {
+  frame &= 0x7FFFFFFFUL;
+  unsigned long bits = frame;
+  int parity = 0;
+  while (bits) {
+    parity ^= 1;
+    bits &= bits - 1;
+  }
+  return parity ? frame | 0x80000000UL : frame;
+}
@@ -0,0 +1,143 @@
+//Linux implementation of the E-CV hardware abstraction (lib/ecv/src/hal.h)
+//
+//The host build runs the EcvCore without the ESP8266:
+// - HostClock     virtual time in ms, advanced by the caller, the reply delay advances it as well. It wraps at 32
+//                 bits like millis() on the ESP8266, set() close to 2^32 runs a scenario across the wrap
+// - SystemClock   wall time in ms since the construction, for the tests against a real socket
+// - CaptureLink   keeps the last OpenTherm reply frame
+// - HostMqtt      prints publishes and subscriptions as "PUB[(r)] <topic> <payload>" to a file, nullptr discards them
+// - FileStorage   one file per record in a directory
+// - HostDebug     the serial monitor to a file, nullptr discards it
+// - HostSystem    a heap of HOST_HEAP_SIZE bytes on the allocation counter of alloc_counter.h and a painted stack
+//HostEcv bundles them with the plant model as sensors and the core, as the host tools use it.
+
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <hal.h>
+#include <ecv_core.h>
+#include <plant_sensors.h>
+
+class HostClock : public Clock {
+  public:
+    unsigned long millis() override { return now; }
+    void wait(unsigned long ms) override { now += (uint32_t)ms; }
+
+    void set(unsigned long ms) { now = (uint32_t)ms; }
+    void advance(unsigned long ms) { now += (uint32_t)ms; }
+
+  private:
+    uint32_t now = 0;
+};
+
+class SystemClock : public Clock {
+  public:
+    SystemClock();
+    unsigned long millis() override;
+    void wait(unsigned long ms) override;
+
+  private:
+    std::chrono::steady_clock::time_point start;
+};
+
+class CaptureLink : public OpenThermLink {
+  public:
+    void sendResponse(unsigned long frame) override {
+      response = frame;
+      responses++;
+    }
+
+    unsigned long response  = 0;
+    unsigned long responses = 0;
+};
+
+class HostMqtt : public MqttLink {
+  public:
+    explicit HostMqtt(FILE* out = nullptr) : out(out) {}
+
+    bool publish(const char* topic, const char* payload, bool retained) override;
+    bool subscribe(const char* topic, int qos) override;
+    bool connected() override { return online; }
+
+    bool online             = true;
+    unsigned long published = 0;
+
+  private:
+    FILE* out;
+};
+
+class FileStorage : public Storage {
+  public:
+    //Records are stored as <directory><name>, the names of the core start with a /. Without a directory the
+    //storage does not mount and the counters are not persisted.
+    explicit FileStorage(const char* directory) : directory(directory) {}
+
+    bool begin() override;
+    bool read(const char* name, void* data, size_t length) override;
+    bool write(const char* name, const void* data, size_t length) override;
+
+  private:
+    const char* directory;
+};
+
+class HostDebug : public DebugOutput {
+  public:
+    explicit HostDebug(FILE* out = nullptr) : out(out) {}
+
+    void write(const char* text) override { if (out != nullptr) { fputs(text, out); } }
+
+  private:
+    FILE* out;
+};
+
+//Heap of the core on the ESP8266 after WiFi, the MQTT client and the web server have taken theirs, and the stack of
+//the loop (the cont stack)
+#define HOST_HEAP_SIZE  40960
+#define HOST_STACK_SIZE 4096
+
+//The heap is heap_size bytes above the heap in use at the construction, its use is the growth of alloc_live(). With
+//glibc the free chunks that the allocator holds between the blocks in use are the fragmented part, the largest free
+//block is the rest or the chunks beyond the fastbins, whichever is larger. The stack is painted with a pattern below the constructor and stack_free is the part of it that
+//is never overwritten, the stack of the thread that constructs it.
+class HostSystem : public SystemMonitor {
+  public:
+    explicit HostSystem(unsigned long heap_size = HOST_HEAP_SIZE, size_t stack_size = HOST_STACK_SIZE);
+
+    void read(SystemStats& stats) override;
+    const char* resetReason() override { return "Host start"; }
+
+  private:
+    unsigned long heap_size;
+    unsigned long heap_base;            // alloc_live() at the construction
+    unsigned long holes_base;           // Free chunks of the allocator at the construction
+    unsigned long large_base;           // The part of them beyond the fastbins
+    size_t stack_size;
+    uintptr_t stack_bottom;             // Lowest address of the painted stack
+};
+
+class HostEcv {
+  public:
+    //Publishes to mqtt_out and the serial monitor to debug_out, nullptr discards them. The reply delay is off, the
+    //counters are not persisted.
+    HostEcv(FILE* mqtt_out = nullptr, FILE* debug_out = nullptr);
+
+    HostClock clock;
+    CaptureLink link;
+    HostMqtt mqtt;
+    PlantSensors sensors;
+    FileStorage storage;
+    HostDebug debug;
+    HostSystem system;
+    EcvCore ecv;
+
+    //Deliver an MQTT message to the core as the broker would
+    void receive(const char* topic, const char* payload);
+};
+
+//Add the parity bit (bit 31) to make the number of set bits even, as the OpenTherm leader sends it
+unsigned long frame_with_parity(unsigned long frame);
+
+#endif
@@ -0,0 +1,166 @@
+//Manchester line model of the OpenTherm interface, see line_simulator.h
+
+#include <algorithm>
+#include <chrono>
+#include <Arduino.h>
+#include <OpenTherm.h>
+#include "line_simulator.h"
+#include "host_platform.h"
+
+//Pins of src/main.cpp
+static const int in_pin  = 4;
+static const int out_pin = 5;
+
+//The library calls back with a plain function
+static OpenTherm* line_ot = nullptr;
+static unsigned long last_frame = 0;
+static OpenThermResponseStatus last_status = NONE;
+static unsigned long callbacks = 0;
+
+static void line_interrupt() {
+  line_ot->handleInterrupt();
+}
+
+//FUNCTION: isValidRequest() of the library with the 32 bit unsigned long of the ESP8266. On the host (request << 1)
+//keeps the parity bit, so the library rejects every request that has it set.
+static bool valid_request(unsigned long request) {
+  request &= 0xFFFFFFFFUL;
+  unsigned long bits = request;
+  int parity = 0;
+  while (bits) {
+    parity ^= 1;
+    bits &= bits - 1;
+  }
+  int type = (request >> 28) & 7;
+  return parity == 0 && (type == READ_DATA || type == WRITE_DATA);
+}
+
+static void line_request(unsigned long request, OpenThermResponseStatus status) {
+  last_frame  = request;
+  last_status = status == INVALID && valid_request(request) ? SUCCESS : status;
+  callbacks++;
+  //Every status gets an answer, the E-CV replies READ-ACK with the data of the request
+  line_ot->sendResponse(frame_with_parity((request & 0x0FFFFFFFUL) | 0x40000000UL));
+}
+
+LineSimulator::LineSimulator(const LineFaults& faults, unsigned long seed) : faults(faults), state(seed == 0 ? 1 : seed) {}
+
+unsigned long LineSimulator::random() {
+  //xorshift32
+  state ^= (state << 13) & 0xFFFFFFFFUL;
+  state ^= state >> 17;
+  state ^= (state << 5) & 0xFFFFFFFFUL;
+  return state & 0xFFFFFFFFUL;
+}
+
+double LineSimulator::uniform() {
+  return random() / 4294967296.0;
+}
+
+void LineSimulator::encode(unsigned long frame, std::vector<Edge>& edges) {
+  edges.clear();
+
+  //Start bit 1, the data bits from bit 31 and the stop bit 1. A bit is its value in the first half and the
+  //inverse in the second half, the line idles low.
+  int level = LOW;
+  for (int bit = 0; bit < 34; bit++) {
+    int value = (bit == 0 || bit == 33) ? 1 : (frame >> (32 - bit)) & 1;
+    uint32_t start = bit * 1000;
+    if (value != level) { edges.push_back(Edge { start, true }); }
+    edges.push_back(Edge { start + 500, true });
+    level = !value;
+  }
+  //Back to idle after the stop bit
+  if (level != LOW) { edges.push_back(Edge { 34000, true }); }
+
+  size_t clean = edges.size();
+  for (size_t i = 0; i < clean; i++) {
+    if (faults.jitter > 0) {
+      double shift = (uniform() * 2 - 1) * faults.jitter;
+      edges[i].time = (uint32_t)std::max(0.0, edges[i].time + shift);
+    }
+    if (faults.missing > 0 && uniform() < faults.missing) { edges[i].interrupt = false; }
+    if (faults.bounce > 0 && uniform() < faults.bounce) {
+      int bounces = 1 + random() % 3;
+      uint32_t time = edges[i].time;
+      for (int b = 0; b < bounces; b++) {
+        time += 1 + random() % 3;
+        edges.push_back(Edge { time, true });
+        time += 1 + random() % 3;
+        edges.push_back(Edge { time, true });
+      }
+    }
+  }
+  if (faults.glitch > 0) {
+    for (int bit = 0; bit < 34; bit++) {
+      if (uniform() >= faults.glitch) { continue; }
+      uint32_t time = bit * 1000 + random() % 1000;
+      edges.push_back(Edge { time, true });
+      edges.push_back(Edge { time + (uint32_t)faults.glitch_width, true });
+    }
+  }
+  if (edges.size() > clean || faults.jitter > 0) {
+    std::stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.time < b.time; });
+  }
+}
+
+LineResult LineSimulator::run(unsigned long frames, unsigned long period) {
+  LineResult result;
+  OpenTherm ot(in_pin, out_pin, true);
+  line_ot = &ot;
+  host_micros = 0;
+  host_pins[in_pin] = LOW;
+  ot.begin(line_interrupt, line_request);
+
+  std::vector<Edge> edges;
+  edges.reserve(256);
+  double busy = 0;
+
+  for (unsigned long n = 0; n < frames; n++) {
+    //A random request, READ-DATA or WRITE-DATA with the parity bit
+    unsigned long request = frame_with_parity(((random() & 1) << 28) | (random() & 0x00FFFFFFUL));
+    encode(request, edges);
+
+    //The reply of the previous frame may still be on the line
+    unsigned long base = std::max(host_micros + 1000, n * period * 1000 + 2000000);
+    unsigned long received = callbacks;
+    auto start = std::chrono::steady_clock::now();
+
+    int level = LOW;
+    for (const Edge& edge : edges) {
+      host_micros = base + edge.time;
+      level = !level;
+      host_pins[in_pin] = level;
+      if (edge.interrupt) { ot.handleInterrupt(); }
+    }
+    //The main loop runs process() while the frame ends and until the next frame, the outcome of this frame is the
+    //first callback after its edges
+    bool answered = false;
+    OpenThermResponseStatus status = NONE;
+    unsigned long frame = 0;
+    host_micros = base + 35000;
+    for (int check = 0; check < 2; check++) {
+      ot.process();
+      if (!answered && callbacks != received) {
+        answered = true;
+        status = last_status;
+        frame = last_frame;
+      }
+      host_micros = base + period * 1000 - 1000;
+    }
+
+    busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames++;
+    result.edges += edges.size();
+
+    //A timeout is the end of an earlier frame the library got stuck on, this one is lost in it
+    if (status == TIMEOUT) { result.timeouts++; }
+    if (!answered || status == TIMEOUT)  { result.lost++; }
+    else if (status == INVALID)          { result.invalid++; }
+    else if ((frame & 0xFFFFFFFFUL) == request) { result.decoded++; }
+    else                                 { result.corrupted++; }
+  }
+  result.seconds = busy;
+  line_ot = nullptr;
+  return result;
+}
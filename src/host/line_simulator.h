@@ -0,0 +1,64 @@
+//Manchester line model of the OpenTherm interface for the receive path of the E-CV
+//
+//Turns request frames into the edges of the 1 kHz Manchester code of the thermostat (start bit, 32 data bits, stop
+//bit, 1ms per bit with a transition in the middle) and feeds them to the OpenTherm Library as the ESP8266 does:
+//the pin level and micros() of the Arduino layer of the host (src/host/arduino) are set for every edge and the
+//interrupt handler runs. ot.process() delivers the frame to a callback that answers every status with
+//sendResponse() like processRequest() of src/main.cpp. The validity check of the library depends on the 32 bit
+//unsigned long of the ESP8266, the callback repeats it for the host.
+//
+//Line faults, every one can be combined:
+// - jitter    every edge moves by a uniform random time of up to +- jitter us
+// - glitch    probability per bit of a spike of glitch_width us at a random place in the bit
+// - missing   probability per edge that the level changes without an interrupt
+// - bounce    probability per edge that noise on the OT+ level near the threshold bounces the input 1 to 3 times
+//             within a few us after the edge
+
+#ifndef LINE_SIMULATOR_H
+#define LINE_SIMULATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+struct LineFaults {
+  double jitter       = 0;    // us
+  double glitch       = 0;    // Probability per bit
+  double glitch_width = 20;   // us
+  double missing      = 0;    // Probability per edge
+  double bounce       = 0;    // Probability per edge
+};
+
+struct LineResult {
+  unsigned long frames    = 0;  // Frames sent
+  unsigned long decoded   = 0;  // Received as SUCCESS with the frame that was sent
+  unsigned long corrupted = 0;  // Received as SUCCESS with a different frame, the error was not detected
+  unsigned long invalid   = 0;  // Received as INVALID, parity or message type wrong
+  unsigned long lost      = 0;  // Not received before the next frame
+  unsigned long timeouts  = 0;  // TIMEOUT callbacks of the library
+  unsigned long edges     = 0;  // Edges on the line, including the faults
+  double seconds          = 0;  // CPU time of the receive path: interrupt handler and process()
+};
+
+class LineSimulator {
+  public:
+    LineSimulator(const LineFaults& faults, unsigned long seed);
+
+    //Send frames random requests with period ms between the frame starts
+    LineResult run(unsigned long frames, unsigned long period = 1000);
+
+  private:
+    //Edge times in us from the start of the frame, the level toggles on every edge
+    struct Edge {
+      uint32_t time;
+      bool interrupt;
+    };
+
+    void encode(unsigned long frame, std::vector<Edge>& edges);
+    double uniform();
+    unsigned long random();
+
+    LineFaults faults;
+    unsigned long state;
+};
+
+#endif
@@ -0,0 +1,760 @@
+//E-CV core on Linux, built with the PlatformIO environment native
+//
+//Usage:
+//  ecv frames [-v]                         OpenTherm request frames in hex from stdin, one reply frame per line
+//                                          to stdout, -v shows the MQTT publishes and the serial monitor on stderr
+//  ecv sim [hours] [outside] [setpoint] [--step] [--curve] [--slope s] [--shift c] [--swing c] [--autotune] [--no-ff] [--change h c] [--load h f]
+//                                          closed-loop run of the control on the plant model with a thermostat
+//                                          that requests CH at the setpoint, prints the control metrics. --step
+//                                          runs the proportional step controller of before the PID, --curve the
+//                                          heating curve, --swing a daily outside temperature cycle of c around
+//                                          outside, --autotune the relay auto-tune at the start, --no-ff without
+//                                          the feed-forward. --change steps the setpoint to c after h hours,
+//                                          --load multiplies the radiator output by f after h hours, the metrics
+//                                          of the flow are measured again from there
+//  ecv compare [hours] [outside] [setpoint] [options of sim]
+//                                          the same run with the step controller and the PID, with a daily
+//                                          outside temperature cycle on the setpoint and on the heating curve, and
+//                                          a setpoint step and a load change with and without the feed-forward.
+//                                          Prints the flow and room metrics, exits with 1 if the PID, the curve or
+//                                          the feed-forward does not do better
+//  ecv traffic [order] [frames] [rate]     virtual thermostat with the poll order honeywell, remeha or random at
+//                                          rate frames per second of virtual time, verifies every reply and
+//                                          prints frames/s, the latency percentiles and allocations per data-ID
+//  ecv replay <log> [max]                  replays a rawdata log or capture through the core, compares every reply
+//                                          with the recorded one and prints up to max mismatches and the throughput
+//  ecv capture <log> <capture>             converts a text log to the binary capture format
+//  ecv allocs [--strict] [frames]          heap allocations per frame, MQTT message and loop iteration with the
+//                                          random poll order, exits with 1 if a hot path allocates, --strict aborts
+//                                          at the first allocation for the debugger
+//  ecv mqtt [seconds] [rate] [restart] [down]
+//                                          end-to-end run against an in-process MQTT broker on loopback in wall
+//                                          time, OpenHAB injects rate sensor values per second and answers
+//                                          ch_requested, the broker restarts every restart seconds for down ms.
+//                                          Prints the latency and loss of the sensor values and the control path
+//  ecv fleet [instances] [threads] [seconds] [rate] [host[:port]]
+//                                          instances independent E-CVs with their own topic prefix and client ID on
+//                                          a pool of threads, each with a virtual thermostat at rate frames per
+//                                          second, against the in-process or an external broker in wall time. The
+//                                          login of an external broker is read from ECV_MQTT_USER and
+//                                          ECV_MQTT_PASSWORD. Prints the publish rate, broker RTT and reply latency
+//  ecv line [--csv] [frames] [jitter] [glitch] [missing] [bounce]
+//                                          OpenTherm frames as Manchester edges through the interrupt handler of the
+//                                          OpenTherm Library with line faults: jitter in us, the probability of a
+//                                          glitch per bit, of a missing interrupt and of a bounce per edge. A fault
+//                                          as from:to:step sweeps it, prints the decode results and ns per edge
+//  ecv golden [record|check <corpus>] [max]
+//                                          golden-response corpus of every data-ID as READ-DATA, WRITE-DATA and
+//                                          INVALID-DATA with boundary values, each on a fresh core. Without a corpus
+//                                          it prints the cases per known divergence and reply type, record saves the
+//                                          corpus and check compares the core with it, exits with 1 on a regression
+//  ecv flows <flows.json>                  converts the inject nodes of a Node-RED flows export to a scenario
+//  ecv scenario <scenario|flows.json> [repeat]
+//                                          runs a scenario repeat times against the in-process MQTT broker in wall
+//                                          time, prints the failed expects, the latency of the expects and the
+//                                          duration, exits with 1 on a failed expect
+//  ecv clock [hours] [start]               day scenario of the core on the virtual clock, prints the count and gaps
+//                                          of the ch_requested heartbeat, the sensor read, the PID sample, the
+//                                          counters and the probe. Without start it runs from 0 and again across
+//                                          the 32-bit wrap of millis() and compares both runs
+//  ecv decode                              renders the compact rawdata of stdin (ecv/command/rawdata_format 1) as
+//                                          the rawdata text with the data-ID table, other lines are copied
+//  ecv bench [--json] [filter]             microbenchmarks of the codec, processRequest() per data-ID, callback()
+//                                          per topic and the rawdata formatting, as a table or Google Benchmark JSON
+//frames, sim, compare, allocs, golden and clock run the core on a virtual clock, their results and exit codes do not
+//depend on the speed of the machine, only the time they took ("in 0.04 s", "wall:") does. flows and decode only
+//convert text. traffic, replay and line check the replies on the virtual or recorded time as well, but their us, ns
+//and frames/s columns time the host. mqtt, fleet and scenario run against a broker in wall time and bench measures
+//wall time, their latencies and rates depend on the machine.
+//The checks of sim, compare and the stage time-proportioning also run as unit tests with pio test -e native, see
+//test/test_control and test/test_dither.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <opentherm_ids.h>
+#include "host_platform.h"
+#include "virtual_thermostat.h"
+#include "alloc_counter.h"
+#include "rawdata_replay.h"
+#include "microbench.h"
+#include "mqtt_harness.h"
+#include "fleet.h"
+#include "line_simulator.h"
+#include "clock_scenario.h"
+#include "golden_corpus.h"
+#include "flows_scenario.h"
+#include "control_sim.h"
+
+//The subcommands are left out of the unit tests of test/, they have their own main()
+#ifndef PIO_UNIT_TESTING
+
+//FUNCTION: Answer every request frame on stdin
+static int run_frames(bool verbose) {
+  HostEcv host(verbose ? stderr : nullptr, verbose ? stderr : nullptr);
+  if (verbose) { host.ecv.debug.enable(ECV_LOG_MONITOR); }
+
+  char line[64];
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    char* end;
+    unsigned long request = strtoul(line, &end, 16);
+    if (end == line) { continue; }
+    host.ecv.processRequest(request);
+    printf("%08lx\n", host.link.response);
+    host.clock.advance(1000);
+  }
+  return 0;
+}
+
+//FUNCTION: Closed-loop run of the control on the plant model
+static int run_sim(const SimOptions& options) {
+  SimResult result;
+  run_control_sim(options, result);
+  printf("controller: %s frames: %lu publishes: %lu\n", sim_controller_name(options.controller), result.frames, result.publishes);
+  printf("flow: %.2f C return: %.2f C room: %.2f C\n", result.flow, result.ret, result.room);
+  printf("overshoot: %.2f C settling: %ld s switches: %lu IAE: %.0f Cs\n", result.overshoot,
+    result.settling < 0 ? -1L : result.settling / 1000, result.switches, result.iae);
+  printf("room: min %.2f C max %.2f C IAE against 20 C: %.1f Ch\n", result.room_min, result.room_max, result.room_iae);
+  if (options.change_at >= 0 || options.load_at >= 0) {
+    printf("event: overshoot: %.2f C settling: %ld s switches: %lu IAE: %.0f Cs\n", result.event_overshoot,
+      result.event_settling < 0 ? -1L : result.event_settling / 1000, result.event_switches, result.event_iae);
+  }
+  if (options.autotune) {
+    printf("autotune: %s kp: %.2f ki: %.4f\n", result.autotune, result.autotune_kp, result.autotune_ki);
+  }
+  printf("energy: %s\n", result.counters.c_str());
+  return 0;
+}
+
+//FUNCTION: Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, int percent) {
+  if (sorted.empty()) { return 0; }
+  size_t rank = (sorted.size() * percent + 99) / 100;
+  return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+//FUNCTION: Throughput and soak run with the virtual thermostat, the core loop runs between the frames
+static int run_traffic(PollOrder order, unsigned long frames, double rate) {
+  HostEcv host;
+  EcvCore& ecv = host.ecv;
+
+  //Sensor values from OpenHAB so the read IDs answer something else than the defaults
+  host.receive("ecv/sensors/outside_temperature", "5.5");
+  host.receive("ecv/sensors/return_water_temperature", "35");
+  host.receive("ecv/sensors/dhw_temperature", "48");
+  host.receive("ecv/sensors/water_flow_dhw", "6.5");
+
+  VirtualThermostat thermostat(order, 1);
+  std::vector<double> latency[256];
+  unsigned long allocations[256] = {0};
+  unsigned long checks[5] = {0};
+  unsigned long failed_frames = 0;
+  double busy = 0;
+
+  for (unsigned long n = 0; n < frames; n++) {
+    host.clock.set((unsigned long)(n * 1000.0 / rate));
+
+    //The random order also changes the follower status, for the LB of ID 0
+    if (order == POLL_RANDOM && n % 97 == 0) {
+      host.receive("ecv/status/flame", (n / 97) % 2 ? "1" : "0");
+      host.receive("ecv/status/ch_mode", (n / 194) % 2 ? "1" : "0");
+      host.receive("ecv/status/fault", (n / 97) % 7 == 0 ? "1" : "0");
+    }
+    unsigned long request = thermostat.nextRequest();
+    int id = (request >> 16) & 0xFF;
+
+    unsigned long allocated = alloc_count();
+    auto start = std::chrono::steady_clock::now();
+    ecv.processRequest(request);
+    auto end = std::chrono::steady_clock::now();
+    allocations[id] += alloc_count() - allocated;
+
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    latency[id].push_back(us);
+    busy += us;
+
+    int failed = thermostat.verify(request, host.link.response, ecv);
+    for (int i = 0; i < 5; i++) { if (failed & (1 << i)) { checks[i]++; } }
+    if (failed & ~CHECK_KNOWN) { failed_frames++; }
+
+    ecv.loop();
+  }
+
+  printf("frames: %lu virtual rate: %.0f/s processRequest: %.0f frames/s (%.1f us/frame)\n", frames, rate, frames / (busy / 1e6), busy / frames);
+  printf("failed frames: %lu parity: %lu type: %lu id: %lu value: %lu known divergences: %lu\n", failed_frames, checks[0], checks[1], checks[2], checks[3], checks[4]);
+  printf("%4s %8s %8s %8s %8s %8s %8s\n", "id", "frames", "p50_us", "p90_us", "p99_us", "max_us", "allocs");
+  for (int id = 0; id < 256; id++) {
+    if (latency[id].empty()) { continue; }
+    std::sort(latency[id].begin(), latency[id].end());
+    printf("%4d %8zu %8.2f %8.2f %8.2f %8.2f %8.2f\n", id, latency[id].size(), percentile(latency[id], 50), percentile(latency[id], 90),
+      percentile(latency[id], 99), latency[id].back(), (double)allocations[id] / latency[id].size());
+  }
+  return failed_frames == 0 ? 0 : 1;
+}
+
+//FUNCTION: Allocations on the hot paths, the random poll order with the OpenHAB messages and the loop every 100ms
+static int run_allocs(unsigned long frames, bool strict) {
+  static const char* const messages[][2] = {
+    { "ecv/status/flame", "1" }, { "ecv/status/ch_mode", "1" }, { "ecv/status/fault", "0" },
+    { "ecv/status/flame", "0" }, { "ecv/status/ch_mode", "0" },
+    { "ecv/sensors/outside_temperature", "5.50" }, { "ecv/sensors/return_water_temperature", "35.00" },
+    { "ecv/sensors/water_flow_dhw", "6.50" }, { "ecv/sensors/dhw_temperature", "48.00" },
+    { "ecv/command/max_rel_modulation", "100" }, { "ecv/command/pid_kp", "5.00" }, { "ecv/command/stage_period", "300000" }
+  };
+  const unsigned long message_count = sizeof(messages) / sizeof(messages[0]);
+
+  HostEcv host;
+  EcvCore& ecv = host.ecv;
+  VirtualThermostat thermostat(POLL_RANDOM, 1);
+  alloc_stats_reset();
+  alloc_strict(strict);
+
+  for (unsigned long n = 0; n < frames; n++) {
+    for (int i = 0; i < 10; i++) {
+      host.clock.set(n * 1000 + i * 100);
+      AllocScope scope(ALLOC_LOOP);
+      ecv.loop();
+    }
+    if (n % 10 == 0) {
+      const char* const* message = messages[(n / 10) % message_count];
+      AllocScope scope(ALLOC_MESSAGE);
+      ecv.callback(message[0], (const uint8_t*)message[1], strlen(message[1]));
+    }
+    AllocScope scope(ALLOC_FRAME);
+    ecv.processRequest(thermostat.nextRequest());
+  }
+  alloc_strict(false);
+
+  bool allocated = false;
+  printf("%-8s %10s %12s %10s %8s %10s\n", "path", "runs", "allocations", "bytes", "max_run", "peak_heap");
+  for (int path = 0; path < ALLOC_PATHS; path++) {
+    const AllocStats& stats = alloc_stats((AllocPath)path);
+    printf("%-8s %10lu %12lu %10lu %8lu %10lu\n", alloc_path_name((AllocPath)path), stats.entries, stats.allocations, stats.bytes,
+      stats.max_allocations, stats.peak);
+    if (stats.allocations > 0) { allocated = true; }
+  }
+  printf("heap: live %lu peak %lu bytes, %lu allocations since start\n", alloc_live(), alloc_peak(), alloc_count());
+
+  //The heap and stack as the core reports them on ecv/system/health
+  SystemStats health;
+  host.system.read(health);
+  printf("health: free heap %lu max block %lu fragmentation %d%% stack free %lu of %d bytes\n", health.free_heap,
+    health.max_free_block, health.fragmentation, health.stack_free, HOST_STACK_SIZE);
+  return allocated ? 1 : 0;
+}
+
+//FUNCTION: Print the count, percentiles and maximum of latency samples in us
+static void print_latency(const char* name, std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  printf("%s latency: p50 %.0f us p90 %.0f us p99 %.0f us max %.0f us\n", name, percentile(samples, 50), percentile(samples, 90),
+    percentile(samples, 99), samples.empty() ? 0 : samples.back());
+}
+
+//FUNCTION: End-to-end run against the in-process broker
+static int run_mqtt(const HarnessOptions& options) {
+  HarnessResult result;
+  if (!run_mqtt_harness(options, result)) {
+    fprintf(stderr, "can not start the broker\n");
+    return 2;
+  }
+  unsigned long sensor_lost  = result.sensor_sent - result.sensor_received;
+  unsigned long control_lost = result.control_sent - result.control_received;
+  printf("sensor values: sent %lu received %lu lost %lu (%.2f%%) not sent %lu\n", result.sensor_sent, result.sensor_received, sensor_lost,
+    result.sensor_sent > 0 ? 100.0 * sensor_lost / result.sensor_sent : 0, result.sensor_failed);
+  print_latency("sensor", result.sensor_latency);
+  printf("control path: ch_requested %lu ch_mode back %lu lost %lu not sent %lu\n", result.control_sent, result.control_received, control_lost,
+    result.control_failed);
+  print_latency("control", result.control_latency);
+  printf("ping probe: %lu round trips p50 %lu ms max %lu ms\n", result.probe_count, result.probe_p50, result.probe_max);
+  printf("frames: %lu broker restarts: %lu E-CV connects: %lu (session resumed %lu) OpenHAB connects: %lu\n", result.frames,
+    result.restarts, result.core_connects, result.resumed, result.openhab_connects);
+  printf("broker: published %lu delivered %lu last wills %lu\n", result.broker_published, result.broker_delivered, result.broker_wills);
+  return 0;
+}
+
+//FUNCTION: Fleet load test
+static int run_fleet_test(const FleetOptions& options) {
+  FleetResult result;
+  if (!run_fleet(options, result)) {
+    fprintf(stderr, "can not start the broker\n");
+    return 2;
+  }
+
+  unsigned long frames = 0, failed = 0, published = 0, received = 0;
+  std::vector<double> reply, rtt;
+  printf("%-8s %7s %7s %9s %9s %11s %11s %11s %10s %10s\n", "instance", "frames", "failed", "published", "received", "reply_p50us",
+    "reply_p99us", "reply_maxus", "rtt_p50us", "rtt_p99us");
+  for (FleetInstanceResult& instance : result.instances) {
+    printf("%-8s %7lu %7lu %9lu %9lu %11.0f %11.0f %11.0f %10.0f %10.0f\n", instance.prefix.c_str(), instance.frames, instance.failed,
+      instance.published, instance.received, percentile(instance.reply_latency, 50), percentile(instance.reply_latency, 99),
+      instance.reply_latency.empty() ? 0 : instance.reply_latency.back(), percentile(instance.rtt, 50), percentile(instance.rtt, 99));
+    frames += instance.frames;
+    failed += instance.failed;
+    published += instance.published;
+    received += instance.received;
+    reply.insert(reply.end(), instance.reply_latency.begin(), instance.reply_latency.end());
+    rtt.insert(rtt.end(), instance.rtt.begin(), instance.rtt.end());
+  }
+  printf("instances: %zu threads: %d seconds: %.0f frames: %lu failed: %lu\n", result.instances.size(), options.threads, result.seconds,
+    frames, failed);
+  printf("publish rate: %.0f/s receive rate: %.0f/s\n", published / result.seconds, received / result.seconds);
+  print_latency("reply", reply);
+  print_latency("broker RTT", rtt);
+  if (options.host == nullptr) {
+    printf("broker: published %lu delivered %lu\n", result.broker_published, result.broker_delivered);
+  }
+  return failed == 0 ? 0 : 1;
+}
+
+//FUNCTION: Values of a fault, a single value or from:to:step
+static bool parse_sweep(const char* text, std::vector<double>& values) {
+  double from, to, step;
+  values.clear();
+  if (sscanf(text, "%lf:%lf:%lf", &from, &to, &step) == 3) {
+    if (step <= 0 || to < from) { return false; }
+    for (int i = 0; from + i * step <= to + step * 1e-9; i++) { values.push_back(from + i * step); }
+    return true;
+  }
+  char* end;
+  values.push_back(strtod(text, &end));
+  return end != text && *end == '\0';
+}
+
+//FUNCTION: Decode results of the line model for every combination of the faults
+static int run_line(unsigned long frames, std::vector<double> sweep[4], bool csv) {
+  if (csv) {
+    printf("jitter_us,glitch,missing,bounce,frames,decoded,corrupted,invalid,lost,timeouts,success,edges,ns_per_edge,edges_per_s\n");
+  } else {
+    printf("%9s %8s %8s %8s %8s %8s %9s %8s %8s %8s %8s %10s %8s\n", "jitter_us", "glitch", "missing", "bounce", "frames", "decoded",
+      "corrupted", "invalid", "lost", "timeouts", "success", "edges", "ns/edge");
+  }
+  for (double jitter : sweep[0]) {
+    for (double glitch : sweep[1]) {
+      for (double missing : sweep[2]) {
+        for (double bounce : sweep[3]) {
+          LineFaults faults;
+          faults.jitter  = jitter;
+          faults.glitch  = glitch;
+          faults.missing = missing;
+          faults.bounce  = bounce;
+          LineSimulator line(faults, 1);
+          LineResult r = line.run(frames);
+          double success = r.frames > 0 ? 100.0 * r.decoded / r.frames : 0;
+          double ns = r.edges > 0 ? r.seconds * 1e9 / r.edges : 0;
+          if (csv) {
+            printf("%g,%g,%g,%g,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%lu,%.2f,%.0f\n", jitter, glitch, missing, bounce, r.frames, r.decoded, r.corrupted,
+              r.invalid, r.lost, r.timeouts, success, r.edges, ns, r.seconds > 0 ? r.edges / r.seconds : 0);
+          } else {
+            printf("%9g %8g %8g %8g %8lu %8lu %9lu %8lu %8lu %8lu %7.2f%% %10lu %8.2f\n", jitter, glitch, missing, bounce, r.frames, r.decoded,
+              r.corrupted, r.invalid, r.lost, r.timeouts, success, r.edges, ns);
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+//FUNCTION: Read a log or capture, reports the error
+static bool load_log(const char* name, ReplayLog& log) {
+  FILE* file = fopen(name, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "can not open %s\n", name);
+    return false;
+  }
+  bool loaded = loadReplayLog(file, log);
+  fclose(file);
+  if (!loaded) { fprintf(stderr, "can not read %s\n", name); }
+  return loaded;
+}
+
+//FUNCTION: Replay a log at maximum speed and compare the replies
+static int run_replay(const char* name, unsigned long max_report) {
+  ReplayLog log;
+  auto start = std::chrono::steady_clock::now();
+  if (!load_log(name, log)) { return 2; }
+  double load = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  ReplayResult result = replay(log, stdout, max_report);
+  printf("events: %zu skipped lines: %lu load: %.3f s\n", log.events.size(), log.skipped, load);
+  printf("frames: %lu compared: %lu mismatches: %lu messages: %lu\n", result.frames, result.compared, result.mismatches, result.messages);
+  printf("log time: %.0f s replay: %.3f s %.0f frames/s speedup: %.0fx\n", result.duration / 1000.0, result.seconds,
+    result.seconds > 0 ? result.frames / result.seconds : 0, result.seconds > 0 ? result.duration / 1000.0 / result.seconds : 0);
+  if (result.mismatches > 0) {
+    printf("%4s %8s %10s\n", "id", "frames", "mismatches");
+    for (int id = 0; id < 256; id++) {
+      if (result.id_mismatches[id] > 0) { printf("%4d %8lu %10lu\n", id, result.id_frames[id], result.id_mismatches[id]); }
+    }
+  }
+  return result.mismatches == 0 ? 0 : 1;
+}
+
+//FUNCTION: Convert a text log to a binary capture
+static int run_capture(const char* name, const char* capture) {
+  ReplayLog log;
+  if (!load_log(name, log)) { return 2; }
+  FILE* file = fopen(capture, "wb");
+  bool saved = file != nullptr && saveCapture(file, log);
+  if (file != nullptr && fclose(file) != 0) { saved = false; }
+  if (!saved) {
+    fprintf(stderr, "can not write %s\n", capture);
+    return 2;
+  }
+  printf("events: %zu messages: %zu skipped lines: %lu\n", log.events.size(), log.topics.size(), log.skipped);
+  return 0;
+}
+
+//FUNCTION: Summary of the golden corpus, the known divergences and the reply types
+static int run_golden_summary() {
+  std::vector<GoldenCase> corpus;
+  double seconds = golden_generate(corpus);
+
+  unsigned long tagged[GOLDEN_TAGS] = {};
+  unsigned long types[8] = {};
+  unsigned long untagged = 0, odd = 0, silent = 0;
+  for (const GoldenCase& entry : corpus) {
+    for (int t = 0; t < GOLDEN_TAGS; t++) {
+      if (entry.tags & (1 << t)) { tagged[t]++; }
+    }
+    if (entry.tags == 0) { untagged++; }
+    if (!entry.replied) { silent++; continue; }
+    if (!entry.parity) { odd++; }
+    types[(entry.reply >> 28) & 7]++;
+  }
+
+  printf("cases: %zu in %.3f s (%.0f cases/s)\n", corpus.size(), seconds, corpus.size() / seconds);
+  printf("without a known divergence: %lu\n", untagged);
+  for (int t = 0; t < GOLDEN_TAGS; t++) { printf("  %-16s %lu\n", golden_tag_name(t), tagged[t]); }
+  const char* names[8] = { "READ-DATA", "WRITE-DATA", "INVALID-DATA", "RESERVED", "READ-ACK", "WRITE-ACK", "DATA-INVALID", "UNKNOWN-DATAID" };
+  printf("reply types:\n");
+  for (int i = 0; i < 8; i++) {
+    if (types[i] > 0) { printf("  %-16s %lu\n", names[i], types[i]); }
+  }
+  printf("no reply: %lu odd parity: %lu\n", silent, odd);
+  return silent == 0 ? 0 : 1;
+}
+
+//FUNCTION: Save the golden corpus or check the core against a saved one
+static int run_golden(const char* mode, const char* name, unsigned long max_report) {
+  if (strcmp(mode, "record") == 0) {
+    std::vector<GoldenCase> corpus;
+    golden_generate(corpus);
+    FILE* file = fopen(name, "w");
+    bool saved = file != nullptr && golden_save(file, corpus);
+    if (file != nullptr && fclose(file) != 0) { saved = false; }
+    if (!saved) {
+      fprintf(stderr, "can not write %s\n", name);
+      return 2;
+    }
+    printf("cases: %zu\n", corpus.size());
+    return 0;
+  }
+
+  FILE* file = fopen(name, "r");
+  std::vector<GoldenCase> expected;
+  bool loaded = file != nullptr && golden_load(file, expected);
+  if (file != nullptr) { fclose(file); }
+  if (!loaded) {
+    fprintf(stderr, "can not read %s\n", name);
+    return 2;
+  }
+
+  GoldenCheck check = golden_check(expected, stdout, max_report);
+  printf("cases: %lu in %.3f s regressions: %lu known divergences changed: %lu missing: %lu\n", check.cases,
+    check.seconds, check.regressions, check.known, check.missing);
+  for (int t = 0; t < GOLDEN_TAGS; t++) {
+    if (check.tag_changed[t] > 0) { printf("  %-16s %lu\n", golden_tag_name(t), check.tag_changed[t]); }
+  }
+  return check.regressions == 0 && check.missing == 0 ? 0 : 1;
+}
+
+//FUNCTION: Read a complete file
+static bool read_file(const char* name, std::string& text) {
+  FILE* file = fopen(name, "rb");
+  if (file == nullptr) { return false; }
+  char buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) { text.append(buffer, length); }
+  bool complete = !ferror(file);
+  fclose(file);
+  return complete;
+}
+
+//FUNCTION: Scenario of a file, a .json file is converted from a Node-RED export
+static bool load_scenario(const char* name, std::vector<ScenarioStep>& steps) {
+  std::string text, error;
+  if (!read_file(name, text)) {
+    fprintf(stderr, "can not read %s\n", name);
+    return false;
+  }
+  size_t length = strlen(name);
+  if (length > 5 && strcmp(name + length - 5, ".json") == 0) {
+    std::string json;
+    json.swap(text);
+    if (!flows_convert(json, text, error)) {
+      fprintf(stderr, "%s: %s\n", name, error.c_str());
+      return false;
+    }
+  }
+  if (!scenario_parse(text, steps, error)) {
+    fprintf(stderr, "%s: %s\n", name, error.c_str());
+    return false;
+  }
+  return true;
+}
+
+//FUNCTION: Convert a Node-RED export to a scenario on stdout
+static int run_flows(const char* name) {
+  std::string json, scenario, error;
+  if (!read_file(name, json)) {
+    fprintf(stderr, "can not read %s\n", name);
+    return 2;
+  }
+  if (!flows_convert(json, scenario, error)) {
+    fprintf(stderr, "%s: %s\n", name, error.c_str());
+    return 2;
+  }
+  fputs(scenario.c_str(), stdout);
+  return 0;
+}
+
+//FUNCTION: Run a scenario against the in-process broker
+static int run_scenario_file(const char* name, int repeat) {
+  std::vector<ScenarioStep> steps;
+  if (!load_scenario(name, steps)) { return 2; }
+  ScenarioRun run;
+  if (!run_scenario(steps, repeat, stdout, run)) {
+    fprintf(stderr, "can not start the broker or connect\n");
+    return 2;
+  }
+  printf("injects: %lu in %.3f s (%.0f/s) expects passed: %lu failed: %lu known divergences: %lu (%lu pass)\n",
+    run.injects, run.seconds, run.injects / run.seconds, run.passed, run.failed, run.known_failed + run.known_passed,
+    run.known_passed);
+  if (!run.latency.empty()) {
+    printf("expect latency: p50 %.0f us p99 %.0f us max %.0f us\n", percentile(run.latency, 50),
+      percentile(run.latency, 99), run.latency.back());
+  }
+  return run.failed == 0 ? 0 : 1;
+}
+
+//FUNCTION: Print the schedules of a clock scenario
+static void print_scenario(const ScenarioOptions& options, const ScenarioResult& result) {
+  printf("start: %lu ms hours: %.1f wraps: %lu frames: %lu publishes: %lu wall: %.3f s\n", options.start, options.hours,
+    result.wraps, result.frames, result.publishes, result.seconds);
+  printf("%-14s %10s %8s %10s %10s\n", "schedule", "interval", "count", "min gap", "max gap");
+  for (const ScheduleStats& schedule : result.schedules) {
+    bool late = schedule.count < 2 || schedule.max_gap > schedule.interval + 1000;
+    printf("%-14s %10lu %8lu %10lu %10lu%s\n", schedule.name, schedule.interval, schedule.count, schedule.min_gap,
+      schedule.max_gap, late ? "  LATE" : "");
+  }
+  printf("flow: %.2f C counters: %s\n", result.flow_temperature, result.counters.c_str());
+}
+
+//FUNCTION: Day scenario from start, or from 0 and across the wrap of millis() without a start
+static int run_clock(double hours, const char* start) {
+  ScenarioOptions options;
+  options.hours = hours;
+  if (start != nullptr) { options.start = strtoul(start, nullptr, 0); }
+  ScenarioResult result;
+  run_clock_scenario(options, result);
+  print_scenario(options, result);
+  if (start != nullptr) { return result.failedSchedules() == 0 ? 0 : 1; }
+
+  //Wrap halfway the scenario
+  ScenarioOptions wrapped = options;
+  wrapped.start = (unsigned long)(0x100000000ULL - (unsigned long long)(hours * 1800000.0));
+  ScenarioResult wrapped_result;
+  run_clock_scenario(wrapped, wrapped_result);
+  printf("\n");
+  print_scenario(wrapped, wrapped_result);
+
+  bool same = result.sameAs(wrapped_result);
+  printf("\nwrap: %s\n", same ? "same result" : "DIFFERENT result");
+  return same && result.failedSchedules() == 0 && wrapped_result.failedSchedules() == 0 ? 0 : 1;
+}
+
+//FUNCTION: Render the compact rawdata of stdin as the rawdata text, other lines are copied
+static int run_decode() {
+  char line[512];
+  char text[192];
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    //A compact message is "T-<frame>" or "B-<frame> <ms>" at the end of the line, after a topic or a timestamp
+    char* frame = nullptr;
+    for (char* p = line; (p = strpbrk(p, "TB")) != nullptr; p++) {
+      if ((p == line || p[-1] == ' ') && p[1] == '-' && strspn(p + 2, "0123456789abcdefABCDEF") == 8) { frame = p; }
+    }
+    char* rest = frame != nullptr ? frame + 10 : nullptr;
+    char* end = nullptr;
+    unsigned long ms = 0;
+    bool compact = rest != nullptr && (*rest == '\0' || (frame[0] == 'B' && *rest == ' '));
+    if (compact && *rest == ' ') {
+      ms = strtoul(rest + 1, &end, 10);
+      compact = end != rest + 1 && *end == '\0';
+    }
+    if (!compact) {
+      puts(line);
+      continue;
+    }
+
+    *rest = '\0';
+    opentherm_render(strtoul(frame + 2, nullptr, 16), text, sizeof(text));
+    if (frame[0] == 'B') {
+      printf("%s %s Replied after: %lums.\n", line, text, ms);
+    } else {
+      printf("%s %s\n", line, text);
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "frames") == 0) {
+    return run_frames(argc >= 3 && strcmp(argv[2], "-v") == 0);
+  }
+  if (argc >= 2 && (strcmp(argv[1], "sim") == 0 || strcmp(argv[1], "compare") == 0)) {
+    SimOptions options;
+    int arg = 2;
+    if (argc > arg && strncmp(argv[arg], "--", 2) != 0) { options.hours    = atof(argv[arg++]); }
+    if (argc > arg && strncmp(argv[arg], "--", 2) != 0) { options.outside  = atof(argv[arg++]); }
+    if (argc > arg && strncmp(argv[arg], "--", 2) != 0) { options.setpoint = atof(argv[arg++]); }
+    for (; arg < argc; arg++) {
+      bool value = arg + 1 < argc;
+      if (strcmp(argv[arg], "--step") == 0) {
+        options.controller = CONTROL_STEP;
+      } else if (strcmp(argv[arg], "--curve") == 0) {
+        options.curve = true;
+      } else if (strcmp(argv[arg], "--slope") == 0 && value) {
+        options.slope = atof(argv[++arg]);
+      } else if (strcmp(argv[arg], "--shift") == 0 && value) {
+        options.shift = atof(argv[++arg]);
+      } else if (strcmp(argv[arg], "--swing") == 0 && value) {
+        options.outside_swing = atof(argv[++arg]);
+      } else if (strcmp(argv[arg], "--autotune") == 0) {
+        options.autotune = true;
+      } else if (strcmp(argv[arg], "--no-ff") == 0) {
+        options.feed_forward = false;
+      } else if (strcmp(argv[arg], "--change") == 0 && arg + 2 < argc) {
+        options.change_at = atof(argv[++arg]);
+        options.change_to = atof(argv[++arg]);
+      } else if (strcmp(argv[arg], "--load") == 0 && arg + 2 < argc) {
+        options.load_at = atof(argv[++arg]);
+        options.load    = atof(argv[++arg]);
+      } else {
+        fprintf(stderr, "unknown option: %s\n", argv[arg]);
+        return 2;
+      }
+    }
+    if (strcmp(argv[1], "compare") == 0) {
+      bool controllers = compare_controllers(options, stdout);
+      printf("\n");
+      bool curve = compare_heating_curve(options, stdout);
+      printf("\n");
+      bool feed_forward = compare_feed_forward(options, stdout);
+      return controllers && curve && feed_forward ? 0 : 1;
+    }
+    return run_sim(options);
+  }
+  if (argc >= 2 && strcmp(argv[1], "traffic") == 0) {
+    PollOrder order = POLL_HONEYWELL;
+    if (argc >= 3 && !VirtualThermostat::parseOrder(argv[2], order)) {
+      fprintf(stderr, "unknown poll order: %s\n", argv[2]);
+      return 2;
+    }
+    unsigned long frames = argc >= 4 ? strtoul(argv[3], nullptr, 10) : 100000;
+    double rate          = argc >= 5 ? atof(argv[4]) : 1000;
+    return run_traffic(order, frames, rate > 0 ? rate : 1);
+  }
+  if (argc >= 3 && strcmp(argv[1], "replay") == 0) {
+    return run_replay(argv[2], argc >= 4 ? strtoul(argv[3], nullptr, 10) : 20);
+  }
+  if (argc >= 4 && strcmp(argv[1], "capture") == 0) {
+    return run_capture(argv[2], argv[3]);
+  }
+  if (argc >= 2 && strcmp(argv[1], "allocs") == 0) {
+    bool strict = argc >= 3 && strcmp(argv[2], "--strict") == 0;
+    unsigned long frames = argc >= (strict ? 4 : 3) ? strtoul(argv[strict ? 3 : 2], nullptr, 10) : 100000;
+    return run_allocs(frames, strict);
+  }
+  if (argc >= 2 && strcmp(argv[1], "mqtt") == 0) {
+    HarnessOptions options;
+    if (argc >= 3) { options.seconds       = atof(argv[2]); }
+    if (argc >= 4) { options.rate          = atof(argv[3]); }
+    if (argc >= 5) { options.restart_every = atof(argv[4]); }
+    if (argc >= 6) { options.restart_down  = strtoul(argv[5], nullptr, 10); }
+    return run_mqtt(options);
+  }
+  if (argc >= 2 && strcmp(argv[1], "fleet") == 0) {
+    FleetOptions options;
+    if (argc >= 3) { options.instances = atoi(argv[2]); }
+    if (argc >= 4) { options.threads   = atoi(argv[3]); }
+    if (argc >= 5) { options.seconds   = atof(argv[4]); }
+    if (argc >= 6) { options.rate      = atof(argv[5]); }
+    static std::string host;
+    if (argc >= 7) {
+      host = argv[6];
+      size_t colon = host.find(':');
+      if (colon != std::string::npos) {
+        options.port = (uint16_t)atoi(host.c_str() + colon + 1);
+        host.erase(colon);
+      }
+      options.host = host.c_str();
+      options.username = getenv("ECV_MQTT_USER");
+      options.password = getenv("ECV_MQTT_PASSWORD");
+    }
+    if (options.instances < 1 || options.threads < 1 || options.rate <= 0) {
+      fprintf(stderr, "instances, threads and rate must be positive\n");
+      return 2;
+    }
+    return run_fleet_test(options);
+  }
+  if (argc >= 2 && strcmp(argv[1], "line") == 0) {
+    int arg = 2;
+    bool csv = argc > arg && strcmp(argv[arg], "--csv") == 0;
+    if (csv) { arg++; }
+    unsigned long frames = argc > arg ? strtoul(argv[arg++], nullptr, 10) : 100000;
+    std::vector<double> sweep[4];
+    for (int i = 0; i < 4; i++) {
+      if (!parse_sweep(argc > arg + i ? argv[arg + i] : "0", sweep[i])) {
+        fprintf(stderr, "invalid fault: %s\n", argv[arg + i]);
+        return 2;
+      }
+    }
+    return run_line(frames, sweep, csv);
+  }
+  if (argc >= 2 && strcmp(argv[1], "golden") == 0) {
+    if (argc == 2) { return run_golden_summary(); }
+    if (argc >= 4 && (strcmp(argv[2], "record") == 0 || strcmp(argv[2], "check") == 0)) {
+      return run_golden(argv[2], argv[3], argc >= 5 ? strtoul(argv[4], nullptr, 10) : 20);
+    }
+  }
+  if (argc >= 3 && strcmp(argv[1], "flows") == 0) {
+    return run_flows(argv[2]);
+  }
+  if (argc >= 3 && strcmp(argv[1], "scenario") == 0) {
+    int repeat = argc >= 4 ? atoi(argv[3]) : 1;
+    return run_scenario_file(argv[2], repeat > 0 ? repeat : 1);
+  }
+  if (argc >= 2 && strcmp(argv[1], "clock") == 0) {
+    return run_clock(argc >= 3 ? atof(argv[2]) : 24, argc >= 4 ? argv[3] : nullptr);
+  }
+  if (argc >= 2 && strcmp(argv[1], "decode") == 0) {
+    return run_decode();
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    bool json = argc >= 3 && strcmp(argv[2], "--json") == 0;
+    const char* filter = argc >= (json ? 4 : 3) ? argv[json ? 3 : 2] : nullptr;
+    MicroBench bench(filter);
+    core_benchmarks(bench);
+    if (json) { bench.printJson(stdout, argv[0]); } else { bench.printTable(stdout); }
+    return 0;
+  }
+  fprintf(stderr, "usage: %s frames [-v] | sim [hours] [outside] [setpoint] [--step] [--curve] [--slope s] [--shift c] [--swing c] [--autotune] [--no-ff] [--change h c] [--load h f] | compare [hours] [outside] [setpoint] [options of sim] | traffic [honeywell|remeha|random] [frames] [rate] | replay <log> [max] | capture <log> <capture> | allocs [--strict] [frames] | mqtt [seconds] [rate] [restart] [down] | fleet [instances] [threads] [seconds] [rate] [host[:port]] | line [--csv] [frames] [jitter] [glitch] [missing] [bounce] | golden [record|check <corpus>] [max] | flows <flows.json> | scenario <scenario|flows.json> [repeat] | clock [hours] [start] | decode | bench [--json] [filter]\n", argv[0]);
+  return 2;
+}
+#endif
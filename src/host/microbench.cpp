@@ -0,0 +1,161 @@
+//Microbenchmarks of the E-CV core on the host, see microbench.h
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include "microbench.h"
+#include "host_platform.h"
+
+bool MicroBench::selected(const char* name) const {
+  return filter == nullptr || strstr(name, filter) != nullptr;
+}
+
+double MicroBench::wallNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+double MicroBench::cpuNs() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void MicroBench::add(const char* name, unsigned long iterations, std::vector<double>& real, std::vector<double>& cpu, double allocs) {
+  std::sort(real.begin(), real.end());
+  std::sort(cpu.begin(), cpu.end());
+  BenchResult result;
+  result.name       = name;
+  result.iterations = iterations;
+  result.real_ns    = real[real.size() / 2];
+  result.cpu_ns     = cpu[cpu.size() / 2];
+  result.min_ns     = real.front();
+  result.max_ns     = real.back();
+  result.allocs     = allocs;
+  list.push_back(result);
+}
+
+void MicroBench::printTable(FILE* out) const {
+  fprintf(out, "%-44s %12s %10s %10s %10s %8s\n", "benchmark", "iterations", "ns", "min_ns", "max_ns", "allocs");
+  for (const BenchResult& r : list) {
+    fprintf(out, "%-44s %12lu %10.1f %10.1f %10.1f %8.2f\n", r.name.c_str(), r.iterations, r.real_ns, r.min_ns, r.max_ns, r.allocs);
+  }
+}
+
+void MicroBench::printJson(FILE* out, const char* executable) const {
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+  fprintf(out, "{\n  \"context\": {\n");
+  fprintf(out, "    \"date\": \"%s\",\n    \"executable\": \"%s\",\n", date, executable);
+#ifdef __VERSION__
+  fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+  fprintf(out, "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < list.size(); i++) {
+    const BenchResult& r = list[i];
+    fprintf(out, "    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n", r.name.c_str(), r.name.c_str());
+    fprintf(out, "      \"iterations\": %lu,\n      \"real_time\": %.2f,\n      \"cpu_time\": %.2f,\n      \"time_unit\": \"ns\",\n", r.iterations, r.real_ns, r.cpu_ns);
+    fprintf(out, "      \"min_time\": %.2f,\n      \"max_time\": %.2f,\n      \"allocs_per_iter\": %.3f\n    }%s\n", r.min_ns, r.max_ns, r.allocs, i + 1 < list.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+
+
+//-------------------------------------------------BENCHMARK CASES--------------------------------------------------------
+//Requests of the supported data-IDs in their natural direction, with a value for the writes
+struct BenchRequest {
+  int id;
+  int type;             // 0 = READ-DATA, 1 = WRITE-DATA
+  unsigned int value;
+};
+
+static const BenchRequest bench_requests[] = {
+  {   0, 0, 0x0300 }, {   1, 1, 0x2d00 }, {   3, 0, 0x0000 }, {   5, 0, 0x0000 }, {  14, 1, 0x6400 },
+  {  16, 1, 0x1480 }, {  17, 0, 0x0000 }, {  18, 0, 0x0000 }, {  19, 0, 0x0000 }, {  24, 1, 0x1380 },
+  {  25, 0, 0x0000 }, {  26, 0, 0x0000 }, {  27, 0, 0x0000 }, {  28, 0, 0x0000 }, {  56, 0, 0x0000 },
+  {  57, 0, 0x0000 }, { 116, 0, 0x0000 }, { 117, 0, 0x0000 }, { 118, 0, 0x0000 }, { 119, 0, 0x0000 },
+  { 120, 0, 0x0000 }, { 121, 0, 0x0000 }, { 122, 0, 0x0000 }, { 123, 0, 0x0000 },
+  //Not supported, answered with UNKNOWN-DATAID
+  { 200, 0, 0x0000 }
+};
+
+//Messages from OpenHAB, the values are the defaults so the runs do not change the state of the core
+static const char* const bench_messages[][2] = {
+  { "ecv/status/fault",                     "0"     },
+  { "ecv/status/ch_mode",                   "0"     },
+  { "ecv/status/flame",                     "0"     },
+  { "ecv/command/max_rel_modulation",       "100"   },
+  { "ecv/command/max_ch_water_setpoint",    "85"    },
+  { "ecv/command/dhw_setpoint",             "0"     },
+  { "ecv/command/pid_kp",                   "5.00"  },
+  { "ecv/command/stage_period",             "300000"},
+  { "ecv/sensors/water_pressure_ch",        "1.50"  },
+  { "ecv/sensors/outside_temperature",      "5.50"  },
+  { "ecv/sensors/heater_flow_temperature",  "45.00" },
+  { "ecv/sensors/return_water_temperature", "35.00" },
+  { "ecv/sensors/water_flow_dhw",           "6.50"  },
+  { "ecv/sensors/dhw_temperature",          "48.00" },
+  //Not subscribed, falls through all topics
+  { "ecv/unknown",                          "0"     }
+};
+
+void core_benchmarks(MicroBench& bench) {
+  HostEcv host;
+  EcvCore& ecv = host.ecv;
+  char result[32];
+  char name[96];
+
+  //Codec, the inputs are the text of the frame value as processRequest() passes it
+  bench.run("codec/decode_flag_flag8", [&] { ecv.decodeFlagFlag8("3A", result); bench_keep(result); });
+  bench.run("codec/decode_flag_f8", [&] { ecv.decodeFlagF8("2d80", result); bench_keep(result); });
+  bench.run("codec/encode_flag_f8", [&] { ecv.encodeFlagF8("45.50", result); bench_keep(result); });
+  bench.run("codec/encode_flag_u16", [&] { ecv.encodeFlagU16(12345, result); bench_keep(result); });
+
+  //A complete request with the reply, the rawdata publishes and the debug checks
+  for (const BenchRequest& r : bench_requests) {
+    unsigned long request = frame_with_parity(((unsigned long)r.type << 28) | ((unsigned long)r.id << 16) | r.value);
+    snprintf(name, sizeof(name), "process_request/%d", r.id);
+    bench.run(name, [&] { ecv.processRequest(request); bench_keep(host.link.response); });
+  }
+
+  //The same requests with the compact rawdata, only the frames are published
+  ecv.rawdata_format = 1;
+  for (const BenchRequest& r : bench_requests) {
+    unsigned long request = frame_with_parity(((unsigned long)r.type << 28) | ((unsigned long)r.id << 16) | r.value);
+    snprintf(name, sizeof(name), "process_compact/%d", r.id);
+    bench.run(name, [&] { ecv.processRequest(request); bench_keep(host.link.response); });
+  }
+  ecv.rawdata_format = 0;
+
+  //MQTT dispatch, the payload is not null terminated like the buffer of PubSubClient
+  for (const auto& m : bench_messages) {
+    const char* topic = m[0];
+    const uint8_t* payload = (const uint8_t*)m[1];
+    unsigned int length = strlen(m[1]);
+    snprintf(name, sizeof(name), "callback/%s", topic + 4);
+    bench.run(name, [&] { ecv.callback(topic, payload, length); });
+  }
+
+  //The rawdata lines as processRequest() builds them for ecv/thermostat/rawdata/rx and tx
+  char msg_full[192];
+  char msg_thermostat[11];
+  bench.run("format/rawdata_rx", [&] {
+    snprintf(msg_full, sizeof(msg_full), "T-%s %s %s %s", "00190000", "READ-DATA     ", "Boiler flow water temperature (C): ", "0.00");
+    bench_keep(msg_full);
+  });
+  bench.run("format/rawdata_tx", [&] {
+    snprintf(msg_thermostat, sizeof(msg_thermostat), "B-%s", "40192d80");
+    snprintf(msg_full, sizeof(msg_full), "%s %s %s %s", msg_thermostat, "READ-ACK      ", "Boiler flow water temperature (C): ", "45.50");
+    size_t length = strlen(msg_full);
+    snprintf(msg_full + length, sizeof(msg_full) - length, " Replied after: %lums.", 250UL);
+    bench_keep(msg_full);
+  });
+  bench.run("format/format_float", [&] { format_float(result, 45.5, 2); bench_keep(result); });
+
+  //One pass of the loop without a due schedule
+  bench.run("loop/idle", [&] { ecv.loop(); });
+}
@@ -0,0 +1,80 @@
+//Microbenchmarks of the E-CV core on the host
+//
+//Minimal in-tree harness: a case runs its body in batches, the batch size doubles until a batch takes at least
+//10ms, then 5 batches are timed. The median of the batches is reported in ns per iteration with the heap
+//allocations per iteration (alloc_counter.h). The output is a table or the JSON of Google Benchmark, so the
+//compare tools of Google Benchmark can compare two runs, e.g. of two commits.
+
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+
+struct BenchResult {
+  std::string name;
+  unsigned long iterations;   // Per batch
+  double real_ns;             // Median wall time per iteration
+  double cpu_ns;              // Median process CPU time per iteration
+  double min_ns, max_ns;      // Fastest and slowest batch per iteration
+  double allocs;              // Heap allocations per iteration
+};
+
+//Keep a result the compiler could otherwise remove as unused
+template <typename T> inline void bench_keep(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class MicroBench {
+  public:
+    //Only the cases with filter in the name run, nullptr runs all cases
+    explicit MicroBench(const char* filter = nullptr) : filter(filter) {}
+
+    template <typename F> void run(const char* name, F body);
+
+    void printTable(FILE* out) const;
+    void printJson(FILE* out, const char* executable) const;
+
+    const std::vector<BenchResult>& results() const { return list; }
+
+  private:
+    bool selected(const char* name) const;
+    static double wallNs();
+    static double cpuNs();
+    void add(const char* name, unsigned long iterations, std::vector<double>& real, std::vector<double>& cpu, double allocs);
+
+    const char* filter;
+    std::vector<BenchResult> list;
+};
+
+//The cases of the codec, processRequest() per data-ID, callback() per topic and the rawdata formatting
+void core_benchmarks(MicroBench& bench);
+
+template <typename F> void MicroBench::run(const char* name, F body) {
+  if (!selected(name)) { return; }
+  const int batches = 5;
+  const double min_batch_ns = 10e6;
+
+  //Calibrate the batch size, the first batches also warm up the caches
+  unsigned long iterations = 1;
+  for (;;) {
+    double start = wallNs();
+    for (unsigned long i = 0; i < iterations; i++) { body(); }
+    if (wallNs() - start >= min_batch_ns || iterations >= (1UL << 30)) { break; }
+    iterations *= 2;
+  }
+
+  std::vector<double> real, cpu;
+  unsigned long allocated = alloc_count();
+  for (int b = 0; b < batches; b++) {
+    double wall = wallNs(), process = cpuNs();
+    for (unsigned long i = 0; i < iterations; i++) { body(); }
+    real.push_back((wallNs() - wall) / iterations);
+    cpu.push_back((cpuNs() - process) / iterations);
+  }
+  add(name, iterations, real, cpu, (double)(alloc_count() - allocated) / ((double)iterations * batches));
+}
+
+#endif
@@ -0,0 +1,394 @@
+//In-process MQTT 3.1.1 broker for the host tests, see mqtt_broker.h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "mqtt_broker.h"
+
+//MQTT control packet types in the high nibble of the fixed header
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x80
+#define MQTT_SUBACK      0x90
+#define MQTT_UNSUBSCRIBE 0xA0
+#define MQTT_UNSUBACK    0xB0
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+bool mqtt_topic_matches(const char* filter, const char* topic) {
+  while (*filter != '\0') {
+    if (filter[0] == '#') { return true; }
+    if (filter[0] == '+') {
+      while (*topic != '\0' && *topic != '/') { topic++; }
+      filter++;
+    } else {
+      if (*filter != *topic) {
+        //"a/#" also matches the parent "a"
+        return *topic == '\0' && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+      }
+      filter++;
+      topic++;
+    }
+  }
+  return *topic == '\0';
+}
+
+void mqtt_put_length(std::string& packet, size_t length) {
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    if (length > 0) { digit |= 0x80; }
+    packet += (char)digit;
+  } while (length > 0);
+}
+
+void mqtt_put_string(std::string& packet, const std::string& text) {
+  packet += (char)(text.size() >> 8);
+  packet += (char)(text.size() & 0xFF);
+  packet += text;
+}
+
+std::string mqtt_packet(uint8_t header, const std::string& body) {
+  std::string packet(1, (char)header);
+  mqtt_put_length(packet, body.size());
+  return packet + body;
+}
+
+bool mqtt_take_packet(std::string& buffer, uint8_t& header, std::string& body) {
+  size_t length = 0;
+  size_t position = 1;
+  for (int shift = 0; ; shift += 7) {
+    if (position >= buffer.size()) { return false; }
+    uint8_t digit = buffer[position++];
+    length |= (size_t)(digit & 0x7F) << shift;
+    if ((digit & 0x80) == 0 || shift >= 21) { break; }
+  }
+  if (buffer.size() < position + length) { return false; }
+  header = buffer[0];
+  body.assign(buffer, position, length);
+  buffer.erase(0, position + length);
+  return true;
+}
+
+//FUNCTION: Length prefixed string at position of the body, advances the position
+static bool get_string(const std::string& body, size_t& position, std::string& text) {
+  if (position + 2 > body.size()) { return false; }
+  size_t length = ((uint8_t)body[position] << 8) | (uint8_t)body[position + 1];
+  if (position + 2 + length > body.size()) { return false; }
+  text.assign(body, position + 2, length);
+  position += 2 + length;
+  return true;
+}
+
+bool MqttBroker::start(uint16_t port) {
+  if (active) { return true; }
+  if (port == 0) { port = listen_port; }
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd < 0) { return false; }
+  int on = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port        = htons(port);
+  socklen_t size = sizeof(address);
+  if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, 16) != 0 ||
+      getsockname(listen_fd, (sockaddr*)&address, &size) != 0) {
+    close(listen_fd);
+    listen_fd = -1;
+    return false;
+  }
+  listen_port = ntohs(address.sin_port);
+  fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+  active = true;
+  thread = std::thread(&MqttBroker::run, this);
+  return true;
+}
+
+void MqttBroker::stop() {
+  if (!active) { return; }
+  active = false;
+  thread.join();
+  for (Connection& connection : connections) { close(connection.fd); }
+  connections.clear();
+  for (auto& session : sessions) { session.second.online = false; }
+  close(listen_fd);
+  listen_fd = -1;
+}
+
+void MqttBroker::run() {
+  std::vector<pollfd> fds;
+  char buffer[4096];
+
+  while (active) {
+    fds.assign(1, pollfd { listen_fd, POLLIN, 0 });
+    for (Connection& connection : connections) {
+      fds.push_back(pollfd { connection.fd, (short)(POLLIN | (connection.output.empty() ? 0 : POLLOUT)), 0 });
+    }
+    if (poll(fds.data(), fds.size(), 5) <= 0) { continue; }
+
+    //New connections, the TCP_NODELAY of the ESP8266 core keeps small packets from waiting
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        Connection connection;
+        connection.fd = fd;
+        connections.push_back(connection);
+      }
+    }
+
+    //The connections accepted above are not in fds yet
+    size_t polled = fds.size() - 1;
+    for (size_t i = 0; i < polled && i < connections.size(); i++) {
+      Connection& connection = connections[i];
+      short events = fds[i + 1].revents;
+      if (events & (POLLIN | POLLHUP | POLLERR)) {
+        ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0 && !(received < 0 && (errno == EAGAIN || errno == EINTR))) {
+          drop(connection, true);
+          continue;
+        }
+        if (received > 0) { connection.input.append(buffer, received); }
+
+        uint8_t header;
+        std::string body;
+        while (!connection.closing && mqtt_take_packet(connection.input, header, body)) {
+          if (!handle(connection, header, body)) {
+            drop(connection, true);
+            break;
+          }
+        }
+      }
+    }
+
+    //Send what is waiting, handle() also queues output for the other connections
+    for (Connection& connection : connections) {
+      if (connection.fd < 0 || connection.output.empty()) { continue; }
+      ssize_t sent = ::send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+      if (sent > 0) { connection.output.erase(0, sent); }
+      else if (!(sent < 0 && (errno == EAGAIN || errno == EINTR))) { drop(connection, true); }
+    }
+    for (size_t i = 0; i < connections.size(); ) {
+      if (connections[i].closing && connections[i].output.empty() && connections[i].fd >= 0) { drop(connections[i], false); }
+      if (connections[i].fd < 0) { connections.erase(connections.begin() + i); } else { i++; }
+    }
+  }
+}
+
+bool MqttBroker::handle(Connection& connection, uint8_t header, const std::string& body) {
+  uint8_t type = header & 0xF0;
+  if (!connection.connected && type != MQTT_CONNECT) { return false; }
+  size_t position = 0;
+
+  switch (type) {
+    case MQTT_CONNECT: {
+      std::string protocol;
+      if (connection.connected || !get_string(body, position, protocol) || position + 4 > body.size()) { return false; }
+      uint8_t level = body[position];
+      uint8_t flags = body[position + 1];
+      position += 4;
+      if (protocol != "MQTT" || level != 4) {
+        connection.output += mqtt_packet(MQTT_CONNACK, std::string("\x00\x01", 2));
+        connection.closing = true;
+        return true;
+      }
+      if (!get_string(body, position, connection.client_id)) { return false; }
+      if (flags & 0x04) {
+        connection.will = true;
+        connection.will_retain = (flags & 0x20) != 0;
+        connection.will_message.qos = (flags >> 3) & 0x03;
+        if (!get_string(body, position, connection.will_message.topic) || !get_string(body, position, connection.will_message.payload)) { return false; }
+      }
+      //The user name and password are accepted without a check
+      std::string login;
+      if ((flags & 0x80) && !get_string(body, position, login)) { return false; }
+      if ((flags & 0x40) && !get_string(body, position, login)) { return false; }
+
+      //A second connection with the same client ID takes over the session
+      for (Connection& other : connections) {
+        if (&other != &connection && other.connected && other.client_id == connection.client_id && other.fd >= 0) { drop(other, false); }
+      }
+
+      bool clean = (flags & 0x02) != 0;
+      if (connection.client_id.empty()) { connection.client_id = "auto-" + std::to_string(connection.fd); }
+      bool present = !clean && sessions.count(connection.client_id) > 0 && !sessions[connection.client_id].clean;
+      if (clean) { sessions.erase(connection.client_id); }
+      Session& session = sessions[connection.client_id];
+      session.clean  = clean;
+      session.online = true;
+      connection.connected = true;
+      connects++;
+
+      std::string ack;
+      ack += (char)(present ? 1 : 0);
+      ack += (char)0;
+      connection.output += mqtt_packet(MQTT_CONNACK, ack);
+      while (!session.pending.empty()) {
+        send(connection, session.pending.front(), 1);
+        session.pending.pop_front();
+      }
+      return true;
+    }
+
+    case MQTT_PUBLISH: {
+      Message message;
+      message.qos = (header >> 1) & 0x03;
+      if (!get_string(body, position, message.topic)) { return false; }
+      if (message.qos > 0) {
+        if (position + 2 > body.size()) { return false; }
+        std::string ack = body.substr(position, 2);
+        position += 2;
+        connection.output += mqtt_packet(MQTT_PUBACK, ack);
+      }
+      message.payload.assign(body, position, std::string::npos);
+      published++;
+      publish(message, (header & 0x01) != 0);
+      return true;
+    }
+
+    case MQTT_SUBSCRIBE: {
+      if (body.size() < 2) { return false; }
+      std::string ack = body.substr(0, 2);
+      position = 2;
+      Session& session = sessions[connection.client_id];
+      std::vector<std::string> filters;
+      while (position < body.size()) {
+        std::string filter;
+        if (!get_string(body, position, filter) || position >= body.size()) { return false; }
+        int qos = body[position++] & 0x03;
+        if (qos > 1) { qos = 1; }
+        bool replaced = false;
+        for (auto& subscription : session.subscriptions) {
+          if (subscription.first == filter) { subscription.second = qos; replaced = true; }
+        }
+        if (!replaced) { session.subscriptions.push_back(std::make_pair(filter, qos)); }
+        filters.push_back(filter);
+        ack += (char)qos;
+      }
+      connection.output += mqtt_packet(MQTT_SUBACK, ack);
+
+      //The retained messages of the new subscriptions
+      for (const auto& value : retained) {
+        for (size_t i = 0; i < filters.size(); i++) {
+          if (!mqtt_topic_matches(filters[i].c_str(), value.first.c_str())) { continue; }
+          Message message = { value.first, value.second, 1 };
+          send(connection, message, (uint8_t)ack[2 + i]);
+          break;
+        }
+      }
+      return true;
+    }
+
+    case MQTT_UNSUBSCRIBE: {
+      if (body.size() < 2) { return false; }
+      std::string ack = body.substr(0, 2);
+      position = 2;
+      Session& session = sessions[connection.client_id];
+      std::string filter;
+      while (position < body.size() && get_string(body, position, filter)) {
+        for (size_t i = 0; i < session.subscriptions.size(); i++) {
+          if (session.subscriptions[i].first == filter) { session.subscriptions.erase(session.subscriptions.begin() + i); break; }
+        }
+      }
+      connection.output += mqtt_packet(MQTT_UNSUBACK, ack);
+      return true;
+    }
+
+    case MQTT_PINGREQ:
+      connection.output += mqtt_packet(MQTT_PINGRESP, std::string());
+      return true;
+
+    case MQTT_DISCONNECT:
+      //A clean disconnect discards the last will
+      connection.will = false;
+      connection.closing = true;
+      return true;
+
+    case MQTT_PUBACK:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+void MqttBroker::publish(const Message& message, bool retain) {
+  if (retain) {
+    if (message.payload.empty()) { retained.erase(message.topic); } else { retained[message.topic] = message.payload; }
+  }
+
+  //Every connection and offline session once, at the highest QoS of its matching subscriptions
+  for (auto& entry : sessions) {
+    Session& session = entry.second;
+    int qos = -1;
+    for (const auto& subscription : session.subscriptions) {
+      if (mqtt_topic_matches(subscription.first.c_str(), message.topic.c_str()) && subscription.second > qos) { qos = subscription.second; }
+    }
+    if (qos < 0) { continue; }
+    if (qos > message.qos) { qos = message.qos; }
+
+    if (!session.online) {
+      if (qos == 1 && !session.clean) {
+        session.pending.push_back(message);
+        queued++;
+      }
+      continue;
+    }
+    for (Connection& connection : connections) {
+      if (connection.connected && connection.fd >= 0 && !connection.closing && connection.client_id == entry.first) {
+        send(connection, message, qos);
+      }
+    }
+  }
+}
+
+void MqttBroker::send(Connection& connection, const Message& message, int qos) {
+  std::string body;
+  mqtt_put_string(body, message.topic);
+  if (qos > 0) {
+    Session& session = sessions[connection.client_id];
+    if (session.next_id == 0) { session.next_id = 1; }
+    body += (char)(session.next_id >> 8);
+    body += (char)(session.next_id & 0xFF);
+    session.next_id++;
+  }
+  body += message.payload;
+  connection.output += mqtt_packet(MQTT_PUBLISH | (qos > 0 ? 0x02 : 0x00), body);
+  delivered++;
+}
+
+void MqttBroker::drop(Connection& connection, bool send_will) {
+  if (connection.fd < 0) { return; }
+  close(connection.fd);
+  connection.fd = -1;
+  if (!connection.connected) { return; }
+
+  //The session goes offline unless a newer connection took it over
+  bool taken = false;
+  for (const Connection& other : connections) {
+    if (&other != &connection && other.fd >= 0 && other.connected && other.client_id == connection.client_id) { taken = true; }
+  }
+  if (!taken) {
+    Session& session = sessions[connection.client_id];
+    session.online = false;
+    if (session.clean) { sessions.erase(connection.client_id); }
+  }
+  if (send_will && connection.will) {
+    wills++;
+    publish(connection.will_message, connection.will_retain);
+  }
+}
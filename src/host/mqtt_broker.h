@@ -0,0 +1,99 @@
+//In-process MQTT 3.1.1 broker for the host tests
+//
+//Listens on the loopback interface and speaks the part of MQTT 3.1.1 that the PubSubClient of the E-CV and the
+//test clients use: CONNECT with last will and clean session, PUBLISH at QoS 0 and 1 with retain, SUBSCRIBE and
+//UNSUBSCRIBE with the + and # wildcards, PINGREQ and DISCONNECT. A message is delivered at the lower QoS of the
+//publish and the subscription. QoS 1 messages for an offline persistent session are queued and delivered on the
+//reconnect. Acknowledgements are accepted but not tracked, a message is sent once.
+//
+//The broker runs on its own thread. stop() closes all connections like a broker restart, the sessions and the
+//retained messages are kept like mosquitto with persistence, start() listens on the same port again.
+
+#ifndef MQTT_BROKER_H
+#define MQTT_BROKER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MqttBroker {
+  public:
+    MqttBroker() {}
+    ~MqttBroker() { stop(); }
+
+    //Listen on 127.0.0.1:port, 0 picks a free port the first time and keeps it for a restart. Returns false if the
+    //port can not be opened.
+    bool start(uint16_t port = 0);
+    //Close all connections and stop listening
+    void stop();
+
+    bool running() const { return active; }
+    uint16_t port() const { return listen_port; }
+
+    //Statistics since the construction
+    std::atomic<unsigned long> connects   {0};    // Accepted CONNECT packets
+    std::atomic<unsigned long> published  {0};    // PUBLISH packets received
+    std::atomic<unsigned long> delivered  {0};    // PUBLISH packets sent to the subscribers
+    std::atomic<unsigned long> queued     {0};    // QoS 1 messages queued for an offline session
+    std::atomic<unsigned long> wills      {0};    // Last will messages published
+
+  private:
+    struct Message {
+      std::string topic;
+      std::string payload;
+      int qos;
+    };
+
+    struct Session {
+      std::vector<std::pair<std::string, int>> subscriptions;
+      std::deque<Message> pending;
+      bool online = false;
+      bool clean  = true;
+      uint16_t next_id = 1;
+    };
+
+    struct Connection {
+      int fd;
+      std::string input;
+      std::string output;
+      bool connected = false;
+      bool closing   = false;    // Close after the output is sent
+      std::string client_id;
+      bool will = false;
+      Message will_message;
+      bool will_retain = false;
+    };
+
+    void run();
+    bool handle(Connection& connection, uint8_t header, const std::string& body);
+    void publish(const Message& message, bool retain);
+    void send(Connection& connection, const Message& message, int qos);
+    void drop(Connection& connection, bool send_will);
+
+    int listen_fd = -1;
+    uint16_t listen_port = 0;
+    std::atomic<bool> active {false};
+    std::thread thread;
+
+    //Owned by the broker thread while it runs
+    std::vector<Connection> connections;
+    std::map<std::string, Session> sessions;
+    std::map<std::string, std::string> retained;
+};
+
+//True if an MQTT topic filter with + and # matches the topic
+bool mqtt_topic_matches(const char* filter, const char* topic);
+
+//Append an MQTT remaining length or a length prefixed string
+void mqtt_put_length(std::string& packet, size_t length);
+void mqtt_put_string(std::string& packet, const std::string& text);
+//Complete packet from the fixed header and the body
+std::string mqtt_packet(uint8_t header, const std::string& body);
+//Split the first complete packet from the buffer, returns false if the buffer holds no complete packet yet
+bool mqtt_take_packet(std::string& buffer, uint8_t& header, std::string& body);
+
+#endif
@@ -0,0 +1,169 @@
+//MQTT 3.1.1 client on a TCP socket for the host tests, see mqtt_client.h
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <chrono>
+#include "mqtt_client.h"
+#include "mqtt_broker.h"
+
+static unsigned long now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MqttClient::connect(uint16_t port, const char* client_id, const char* will_topic, const char* will_message, bool will_retain,
+  bool clean_session, unsigned long timeout) {
+  close();
+  addrinfo hints = {};
+  addrinfo* addresses = nullptr;
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) { return false; }
+  fd = ::socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+  bool opened = fd >= 0 && ::connect(fd, addresses->ai_addr, addresses->ai_addrlen) == 0;
+  freeaddrinfo(addresses);
+  if (!opened) {
+    close();
+    return false;
+  }
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  std::string body;
+  mqtt_put_string(body, "MQTT");
+  uint8_t flags = clean_session ? 0x02 : 0x00;
+  if (will_topic != nullptr) { flags |= 0x04 | 0x08 | (will_retain ? 0x20 : 0x00); }
+  if (username != nullptr)   { flags |= 0x80 | (password != nullptr ? 0x40 : 0x00); }
+  body += (char)4;
+  body += (char)flags;
+  body += (char)(keep_alive >> 8);
+  body += (char)(keep_alive & 0xFF);
+  mqtt_put_string(body, client_id);
+  if (will_topic != nullptr) {
+    mqtt_put_string(body, will_topic);
+    mqtt_put_string(body, will_message != nullptr ? will_message : "");
+  }
+  if (username != nullptr) {
+    mqtt_put_string(body, username);
+    if (password != nullptr) { mqtt_put_string(body, password); }
+  }
+  if (!write(mqtt_packet(0x10, body))) { return false; }
+
+  //Wait for the CONNACK
+  unsigned long start = now_ms();
+  char buffer[256];
+  input.clear();
+  while (now_ms() - start < timeout) {
+    pollfd wait = { fd, POLLIN, 0 };
+    if (poll(&wait, 1, 10) <= 0) { continue; }
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+    if (length <= 0) { break; }
+    input.append(buffer, length);
+    uint8_t header;
+    std::string ack;
+    if (mqtt_take_packet(input, header, ack)) {
+      if ((header & 0xF0) != 0x20 || ack.size() < 2 || ack[1] != 0) { break; }
+      session_present = (ack[0] & 0x01) != 0;
+      fcntl(fd, F_SETFL, O_NONBLOCK);
+      return true;
+    }
+  }
+  close();
+  return false;
+}
+
+void MqttClient::disconnect() {
+  if (fd < 0) { return; }
+  write(mqtt_packet(0xE0, std::string()));
+  close();
+}
+
+void MqttClient::close() {
+  if (fd >= 0) { ::close(fd); }
+  fd = -1;
+  input.clear();
+}
+
+bool MqttClient::write(const std::string& packet) {
+  if (fd < 0) { return false; }
+  size_t done = 0;
+  while (done < packet.size()) {
+    ssize_t sent = send(fd, packet.data() + done, packet.size() - done, MSG_NOSIGNAL);
+    if (sent > 0) {
+      done += sent;
+    } else if (sent < 0 && (errno == EAGAIN || errno == EINTR)) {
+      pollfd wait = { fd, POLLOUT, 0 };
+      poll(&wait, 1, 100);
+    } else {
+      close();
+      return false;
+    }
+  }
+  last_sent = now_ms();
+  return true;
+}
+
+bool MqttClient::publish(const char* topic, const char* payload, bool retained) {
+  std::string body;
+  mqtt_put_string(body, topic);
+  body += payload;
+  if (!write(mqtt_packet(0x30 | (retained ? 0x01 : 0x00), body))) { return false; }
+  sent++;
+  return true;
+}
+
+bool MqttClient::subscribe(const char* topic, int qos) {
+  std::string body;
+  if (next_id == 0) { next_id = 1; }
+  body += (char)(next_id >> 8);
+  body += (char)(next_id & 0xFF);
+  next_id++;
+  mqtt_put_string(body, topic);
+  body += (char)(qos > 0 ? 1 : 0);
+  return write(mqtt_packet(0x82, body));
+}
+
+bool MqttClient::loop() {
+  if (fd < 0) { return false; }
+  char buffer[4096];
+  for (;;) {
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+    if (length > 0) {
+      input.append(buffer, length);
+      continue;
+    }
+    if (length < 0 && (errno == EAGAIN || errno == EINTR)) { break; }
+    close();
+    return false;
+  }
+
+  uint8_t header;
+  std::string body;
+  while (fd >= 0 && mqtt_take_packet(input, header, body)) {
+    if ((header & 0xF0) != 0x30 || body.size() < 2) { continue; }
+    size_t length = ((uint8_t)body[0] << 8) | (uint8_t)body[1];
+    if (2 + length > body.size()) { continue; }
+    std::string topic = body.substr(2, length);
+    size_t position = 2 + length;
+    if (header & 0x06) {
+      if (position + 2 > body.size()) { continue; }
+      write(mqtt_packet(0x40, body.substr(position, 2)));
+      position += 2;
+    }
+    received++;
+    if (callback) { callback(topic.c_str(), (const uint8_t*)body.data() + position, body.size() - position); }
+  }
+
+  if (fd >= 0 && now_ms() - last_sent > keep_alive * 1000) { write(mqtt_packet(0xC0, std::string())); }
+  return fd >= 0;
+}
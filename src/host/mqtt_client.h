@@ -0,0 +1,59 @@
+//MQTT 3.1.1 client on a TCP socket for the host tests
+//
+//Behaves like the PubSubClient of the E-CV: publishes at QoS 0, subscribes at QoS 0 or 1, answers QoS 1 messages
+//with a PUBACK and sends a PINGREQ when nothing was sent for the keep alive interval. Nothing blocks except
+//connect(), loop() handles what has arrived and returns.
+
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <hal.h>
+
+class MqttClient : public MqttLink {
+  public:
+    typedef std::function<void(const char* topic, const uint8_t* payload, unsigned int length)> Callback;
+
+    MqttClient() {}
+    ~MqttClient() { close(); }
+
+    void setCallback(Callback callback) { this->callback = callback; }
+
+    //Connect to host:port and wait up to timeout ms for the CONNACK. The last will is sent at QoS 1 when a will
+    //topic is set. Returns false if the broker did not accept the connection.
+    bool connect(uint16_t port, const char* client_id, const char* will_topic = nullptr, const char* will_message = nullptr,
+      bool will_retain = false, bool clean_session = true, unsigned long timeout = 1000);
+    //Send DISCONNECT and close, the broker discards the last will
+    void disconnect();
+
+    //Handle the received packets and the keep alive, returns false when the connection is lost
+    bool loop();
+    //Socket to wait on with poll(), -1 when not connected
+    int socket() const { return fd; }
+
+    bool publish(const char* topic, const char* payload, bool retained = false) override;
+    bool subscribe(const char* topic, int qos = 0) override;
+    bool connected() override { return fd >= 0; }
+
+    bool session_present   = false;   // The broker resumed the session of the last connect
+    unsigned long received = 0;       // PUBLISH packets received
+    unsigned long sent     = 0;       // PUBLISH packets sent
+    unsigned long keep_alive = 15;    // Keep alive in seconds, 15 like PubSubClient
+    const char* host     = "127.0.0.1";  // Broker host name or address
+    const char* username = nullptr;      // Login on the broker, nullptr to connect without
+    const char* password = nullptr;
+
+  private:
+    bool write(const std::string& packet);
+    void close();
+
+    int fd = -1;
+    uint16_t next_id = 1;
+    std::string input;
+    Callback callback;
+    unsigned long last_sent = 0;
+};
+
+#endif
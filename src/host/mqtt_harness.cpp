@@ -0,0 +1,169 @@
+//End-to-end MQTT test of the E-CV core against the in-process broker, see mqtt_harness.h
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <ecv_core.h>
+#include <plant_sensors.h>
+#include "mqtt_harness.h"
+#include "mqtt_broker.h"
+#include "mqtt_client.h"
+#include "host_platform.h"
+
+static double now_us() {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//The MQTT client of the core, notes when the core publishes ch_requested
+class CoreMqtt : public MqttClient {
+  public:
+    explicit CoreMqtt(HarnessResult& result) : result(result) {}
+
+    bool publish(const char* topic, const char* payload, bool retained) override {
+      bool sent = MqttClient::publish(topic, payload, retained);
+      if (strcmp(topic, "ecv/thermostat/ch_requested") != 0) { return sent; }
+      if (!sent) {
+        //The core only repeats it after 60s
+        result.control_failed++;
+      } else {
+        result.control_sent++;
+        //The latest request of a value is timed, an unanswered earlier one counts as lost
+        control_pending[payload] = now_us();
+      }
+      return sent;
+    }
+
+    HarnessResult& result;
+    std::map<std::string, double> control_pending;
+};
+
+bool run_mqtt_harness(const HarnessOptions& options, HarnessResult& result) {
+  MqttBroker broker;
+  if (!broker.start()) { return false; }
+
+  SystemClock clock;
+  CaptureLink link;
+  CoreMqtt core_mqtt(result);
+  PlantSensors sensors(clock);
+  FileStorage storage(nullptr);
+  HostDebug debug;
+  HostSystem system;
+  EcvCore ecv(clock, link, core_mqtt, sensors, storage, debug, system);
+  ecv.begin();
+  ecv.timing = 0;
+  ecv.probe_interval = 1000;
+
+  std::map<std::string, double> sensor_pending;
+  core_mqtt.setCallback([&](const char* topic, const uint8_t* payload, unsigned int length) {
+    std::string value((const char*)payload, length);
+    if (strcmp(topic, "ecv/sensors/outside_temperature") == 0) {
+      auto sent = sensor_pending.find(value);
+      if (sent != sensor_pending.end()) {
+        result.sensor_latency.push_back(now_us() - sent->second);
+        result.sensor_received++;
+        sensor_pending.erase(sent);
+      }
+    }
+    if (strcmp(topic, "ecv/status/ch_mode") == 0) {
+      auto sent = core_mqtt.control_pending.find(value);
+      if (sent != core_mqtt.control_pending.end()) {
+        result.control_latency.push_back(now_us() - sent->second);
+        result.control_received++;
+        core_mqtt.control_pending.erase(sent);
+      }
+    }
+    ecv.callback(topic, payload, length);
+  });
+
+  //OpenHAB reports the CH mode and the flame back like the rule of the installation
+  MqttClient openhab;
+  openhab.setCallback([&](const char* topic, const uint8_t* payload, unsigned int length) {
+    if (strcmp(topic, "ecv/thermostat/ch_requested") != 0 || length == 0) { return; }
+    const char* value = payload[0] == '1' ? "1" : "0";
+    openhab.publish("ecv/status/ch_mode", value, true);
+    openhab.publish("ecv/status/flame", value, true);
+  });
+
+  unsigned long duration  = (unsigned long)(options.seconds * 1000);
+  double sensor_interval  = options.rate > 0 ? 1000.0 / options.rate : 0;
+  double next_sensor      = 0;
+  unsigned long sequence  = 0;
+  unsigned long next_frame = 0;
+  unsigned long next_restart = options.restart_every > 0 ? (unsigned long)(options.restart_every * 1000) : 0;
+  unsigned long broker_up = 0;
+  unsigned long core_attempt = 0, openhab_attempt = 0;
+  bool first = true;
+
+  //The last 500ms only drain what is still on the way
+  for (unsigned long now = clock.millis(); now < duration + 500; now = clock.millis()) {
+    bool sending = now < duration;
+
+    //Broker restart
+    if (next_restart > 0 && sending && broker.running() && now >= next_restart) {
+      broker.stop();
+      result.restarts++;
+      broker_up = now + options.restart_down;
+      next_restart += (unsigned long)(options.restart_every * 1000);
+    }
+    if (!broker.running() && now >= broker_up) { broker.start(broker.port()); }
+
+    //(Re)connect like reconnect() of the ESP8266 and the OpenHAB binding
+    if (!core_mqtt.loop() && (first || now - core_attempt >= options.reconnect)) {
+      core_attempt = now;
+      if (core_mqtt.connect(broker.port(), "ECV", "ecv/system", "E-CV is OFFLINE", true, false)) {
+        result.core_connects++;
+        if (core_mqtt.session_present) { result.resumed++; }
+        ecv.mqttConnected();
+      }
+    }
+    if (!openhab.loop() && (first || now - openhab_attempt >= options.reconnect)) {
+      openhab_attempt = now;
+      if (openhab.connect(broker.port(), "openhab", nullptr, nullptr, false, true)) {
+        result.openhab_connects++;
+        openhab.subscribe("ecv/thermostat/ch_requested", 1);
+      }
+    }
+    first = false;
+
+    ecv.loop();
+
+    //The thermostat, status with CH enable every second
+    if (sending && now >= next_frame) {
+      bool ch = options.ch_toggle > 0 && ((unsigned long)(now / (options.ch_toggle * 1000))) % 2 == 1;
+      ecv.processRequest(frame_with_parity(ch ? 0x00000100UL : 0x00000000UL));
+      result.frames++;
+      next_frame += 1000;
+    }
+
+    //Sensor values from OpenHAB, unique so the arrival matches the publish
+    while (sending && sensor_interval > 0 && now >= next_sensor) {
+      char value[16];
+      snprintf(value, sizeof(value), "%.3f", (sequence++ % 100000) / 1000.0);
+      if (openhab.publish("ecv/sensors/outside_temperature", value)) {
+        sensor_pending[value] = now_us();
+        result.sensor_sent++;
+      } else {
+        result.sensor_failed++;
+      }
+      next_sensor += sensor_interval;
+    }
+
+    //Wait for the next packet or at most 1ms
+    pollfd fds[2] = { { core_mqtt.socket(), POLLIN, 0 }, { openhab.socket(), POLLIN, 0 } };
+    poll(fds, 2, 1);
+  }
+
+  result.probe_count = ecv.probe_rtt.count();
+  result.probe_p50   = ecv.probe_rtt.percentile(50);
+  result.probe_max   = ecv.probe_rtt.maximum();
+  core_mqtt.disconnect();
+  openhab.disconnect();
+  broker.stop();
+  result.broker_published = broker.published;
+  result.broker_delivered = broker.delivered;
+  result.broker_wills     = broker.wills;
+  return true;
+}
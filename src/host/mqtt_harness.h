@@ -0,0 +1,56 @@
+//End-to-end MQTT test of the E-CV core against the in-process broker
+//
+//The core connects over loopback like the ESP8266 does, with the fixed client ID, the persistent session and the
+//retained last will, and reconnects when the connection is lost. A second client plays OpenHAB:
+// - answers every ecv/thermostat/ch_requested with ecv/status/ch_mode and ecv/status/flame, retained
+// - injects ecv/sensors/outside_temperature at a fixed rate, every value unique to match it on arrival
+//A thermostat sends the status frame every second and switches CH on and off. Everything runs in wall time.
+//
+//Measured: the latency and loss of the injected sensor values up to the callback of the core, the control path from
+//the ch_requested publish of the core until its ch_mode arrives back, and the broker round trip of the ping probe.
+//The broker can restart at an interval to test the reconnect and the session resume.
+
+#ifndef MQTT_HARNESS_H
+#define MQTT_HARNESS_H
+
+#include <vector>
+
+struct HarnessOptions {
+  double seconds              = 10;     // Duration of the run
+  double rate                 = 20;     // Sensor values per second
+  double restart_every        = 0;      // Seconds between broker restarts, 0 = no restarts
+  unsigned long restart_down  = 1000;   // ms the broker is down on a restart
+  unsigned long reconnect     = 500;    // ms between connect attempts of the clients
+  double ch_toggle            = 2;      // Seconds between the CH on and off of the thermostat
+};
+
+struct HarnessResult {
+  unsigned long sensor_sent     = 0;  // Published by OpenHAB
+  unsigned long sensor_failed   = 0;  // Not published, OpenHAB was disconnected
+  unsigned long sensor_received = 0;  // Arrived at the core
+  std::vector<double> sensor_latency;    // us
+
+  unsigned long control_sent     = 0;    // ch_requested published by the core
+  unsigned long control_received = 0;    // ch_mode answers that arrived back
+  unsigned long control_failed   = 0;    // ch_requested not published, the core was disconnected
+  std::vector<double> control_latency;   // us
+
+  unsigned long frames          = 0;
+  unsigned long restarts        = 0;
+  unsigned long core_connects   = 0;
+  unsigned long resumed         = 0;    // Connects of the core with the session present
+  unsigned long openhab_connects = 0;
+
+  unsigned long probe_count = 0;         // Ping round trips in the buffer of the core
+  unsigned long probe_p50   = 0;         // ms
+  unsigned long probe_max   = 0;         // ms
+
+  unsigned long broker_published = 0;
+  unsigned long broker_delivered = 0;
+  unsigned long broker_wills     = 0;
+};
+
+//Run the test, returns false if the broker could not start
+bool run_mqtt_harness(const HarnessOptions& options, HarnessResult& result);
+
+#endif
@@ -0,0 +1,212 @@
+//Deterministic replay of captured E-CV traffic, see rawdata_replay.h
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <ecv_core.h>
+#include "rawdata_replay.h"
+#include "host_platform.h"
+
+//Header of the binary capture, followed by the counts and the records
+static const char capture_magic[8] = { 'E', 'C', 'V', 'C', 'A', 'P', '1', '\0' };
+
+//Sensor readings from the log
+class ReplaySensors : public TemperatureSensors {
+  public:
+    void read(float& flow, float& ret) override {
+      flow = flow_temperature;
+      ret  = return_temperature;
+    }
+
+    float flow_temperature   = 0;
+    float return_temperature = 0;
+};
+
+//FUNCTION: Frame from the payload of rawdata/rx "T-xxxxxxxx ..." or rawdata/tx "B-xxxxxxxx ...", mixed case
+static bool parse_frame(const char* payload, unsigned long& frame) {
+  if (strlen(payload) < 10 || payload[1] != '-') { return false; }
+  char hex[9];
+  memcpy(hex, payload + 2, 8);
+  hex[8] = '\0';
+  char* end;
+  frame = strtoul(hex, &end, 16);
+  return *end == '\0';
+}
+
+static bool load_text(FILE* file, ReplayLog& log) {
+  char line[512];
+  bool first = true;
+  double start = 0;
+
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    //<time> <topic> <payload>, the payload may contain spaces
+    char* end;
+    double seconds = strtod(line, &end);
+    if (end == line || *end != ' ') { log.skipped++; continue; }
+    char* topic = end + 1;
+    char* payload = strchr(topic, ' ');
+    if (payload != nullptr) { *payload++ = '\0'; } else { payload = topic + strlen(topic); }
+    if (strncmp(topic, "ecv/", 4) != 0) { log.skipped++; continue; }
+
+    if (first) {
+      start = seconds;
+      first = false;
+    }
+    ReplayEvent event = {};
+    event.time = (unsigned long)((seconds - start) * 1000.0 + 0.5);
+
+    if (strcmp(topic, "ecv/thermostat/rawdata/rx") == 0 || strcmp(topic, "ecv/thermostat/rawdata/tx") == 0) {
+      if (!parse_frame(payload, event.frame)) { log.skipped++; continue; }
+      event.kind = topic[23] == 'r' ? REPLAY_RX : REPLAY_TX;
+    } else if (strcmp(topic, "ecv/thermostat/boilertemp") == 0) {
+      event.kind = REPLAY_FLOW;
+      event.value = atof(payload);
+    } else if (strcmp(topic, "ecv/thermostat/returntemp") == 0) {
+      event.kind = REPLAY_RETURN;
+      event.value = atof(payload);
+    } else if (strncmp(topic, "ecv/status/", 11) == 0 || strncmp(topic, "ecv/sensors/", 12) == 0 || strncmp(topic, "ecv/command/", 12) == 0) {
+      event.kind = REPLAY_MESSAGE;
+      event.message = log.topics.size();
+      log.topics.push_back(topic);
+      log.payloads.push_back(payload);
+    } else {
+      //Other output of the E-CV is not needed for the replay
+      log.skipped++;
+      continue;
+    }
+    log.events.push_back(event);
+  }
+  return true;
+}
+
+//FUNCTION: Length prefixed string of the capture
+static bool read_string(FILE* file, std::string& text) {
+  uint16_t length;
+  if (fread(&length, sizeof(length), 1, file) != 1) { return false; }
+  text.resize(length);
+  return length == 0 || fread(&text[0], 1, length, file) == length;
+}
+
+static bool write_string(FILE* file, const std::string& text) {
+  uint16_t length = text.size() > 0xFFFF ? 0xFFFF : text.size();
+  return fwrite(&length, sizeof(length), 1, file) == 1 && fwrite(text.data(), 1, length, file) == length;
+}
+
+bool loadReplayLog(FILE* file, ReplayLog& log) {
+  char magic[sizeof(capture_magic)];
+  size_t header = fread(magic, 1, sizeof(magic), file);
+  if (header != sizeof(magic) || memcmp(magic, capture_magic, sizeof(magic)) != 0) {
+    rewind(file);
+    return load_text(file, log);
+  }
+
+  uint32_t counts[2];
+  if (fread(counts, sizeof(counts), 1, file) != 1) { return false; }
+  log.events.resize(counts[0]);
+  if (counts[0] > 0 && fread(log.events.data(), sizeof(ReplayEvent), counts[0], file) != counts[0]) { return false; }
+  log.topics.resize(counts[1]);
+  log.payloads.resize(counts[1]);
+  for (uint32_t i = 0; i < counts[1]; i++) {
+    if (!read_string(file, log.topics[i]) || !read_string(file, log.payloads[i])) { return false; }
+  }
+  return true;
+}
+
+bool saveCapture(FILE* file, const ReplayLog& log) {
+  uint32_t counts[2] = { (uint32_t)log.events.size(), (uint32_t)log.topics.size() };
+  if (fwrite(capture_magic, sizeof(capture_magic), 1, file) != 1 || fwrite(counts, sizeof(counts), 1, file) != 1) { return false; }
+  if (counts[0] > 0 && fwrite(log.events.data(), sizeof(ReplayEvent), counts[0], file) != counts[0]) { return false; }
+  for (uint32_t i = 0; i < counts[1]; i++) {
+    if (!write_string(file, log.topics[i]) || !write_string(file, log.payloads[i])) { return false; }
+  }
+  return true;
+}
+
+ReplayResult replay(const ReplayLog& log, FILE* report, unsigned long max_report) {
+  ReplayResult result;
+  HostClock clock;
+  CaptureLink link;
+  HostMqtt mqtt;
+  ReplaySensors sensors;
+  FileStorage storage(nullptr);
+  HostDebug debug;
+  HostSystem system;
+  EcvCore ecv(clock, link, mqtt, sensors, storage, debug, system);
+  ecv.begin();
+  ecv.timing = 0;
+
+  //Log time starts at 1s, the core treats 0 as never
+  const unsigned long offset = 1000;
+  unsigned long next_loop = offset;
+  unsigned long pending_request = 0;
+  unsigned long pending_reply = 0;
+  bool pending = false;
+  size_t applied = 0;   // Sensor readings before this index are applied
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < log.events.size(); i++) {
+    const ReplayEvent& event = log.events[i];
+    unsigned long now = event.time + offset;
+
+    //Run the loop every second of log time, a gap of more than an hour is skipped
+    if (now - next_loop > 3600000UL && now > next_loop) { next_loop = now - now % 1000; }
+    while (next_loop <= now) {
+      clock.set(next_loop);
+      ecv.loop();
+      next_loop += 1000;
+    }
+    clock.set(now);
+
+    switch (event.kind) {
+      case REPLAY_RX: {
+        //Apply the readings published while answering this frame, up to the recorded reply
+        for (size_t j = i + 1; j < log.events.size() && log.events[j].kind != REPLAY_TX && log.events[j].kind != REPLAY_RX; j++) {
+          if (j < applied) { continue; }
+          if (log.events[j].kind == REPLAY_FLOW)   { sensors.flow_temperature = ecv.heater_temp = log.events[j].value; }
+          if (log.events[j].kind == REPLAY_RETURN) { sensors.return_temperature = ecv.return_temp = log.events[j].value; }
+          applied = j + 1;
+        }
+        ecv.processRequest(event.frame);
+        pending_request = event.frame;
+        pending_reply = link.response;
+        pending = true;
+        result.frames++;
+        result.id_frames[(event.frame >> 16) & 0xFF]++;
+        break;
+      }
+      case REPLAY_TX: {
+        //Compare with the reply to the last request of the same data-ID
+        if (!pending || ((event.frame >> 16) & 0xFF) != ((pending_request >> 16) & 0xFF)) { break; }
+        pending = false;
+        result.compared++;
+        if (event.frame != pending_reply) {
+          int id = (pending_request >> 16) & 0xFF;
+          result.mismatches++;
+          result.id_mismatches[id]++;
+          if (report != nullptr && result.mismatches <= max_report) {
+            fprintf(report, "%10.3f s ID %3d request %08lx recorded %08lx replayed %08lx\n", event.time / 1000.0, id, pending_request, event.frame, pending_reply);
+          }
+        }
+        break;
+      }
+      case REPLAY_MESSAGE: {
+        const std::string& payload = log.payloads[event.message];
+        ecv.callback(log.topics[event.message].c_str(), (const uint8_t*)payload.data(), payload.size());
+        result.messages++;
+        break;
+      }
+      case REPLAY_FLOW:
+        if (i >= applied) { sensors.flow_temperature = event.value; }
+        break;
+      case REPLAY_RETURN:
+        if (i >= applied) { sensors.return_temperature = event.value; }
+        break;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  result.duration = log.events.empty() ? 0 : log.events.back().time;
+  return result;
+}
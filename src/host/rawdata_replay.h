@@ -0,0 +1,58 @@
+//Deterministic replay of captured E-CV traffic through the core
+//
+//A log holds the OpenTherm frames of ecv/thermostat/rawdata/rx and /tx and the interleaved MQTT messages, as the
+//broker archive records them. The text format has one message per line:
+//  <time in seconds, decimals allowed> <topic> <payload>
+//for example the output of mosquitto_sub -v -t 'ecv/#' with a timestamp in front. The binary capture format holds
+//the same events as fixed records and loads without parsing, see saveCapture().
+//
+//replay() drives the events through a core on a virtual clock, the loop runs every second of log time:
+// - rx frames go to processRequest(), the reply is compared with the next recorded tx frame of the same data-ID
+// - ecv/status/*, ecv/sensors/* and ecv/command/* go to callback()
+// - ecv/thermostat/boilertemp and /returntemp are the sensor readings, they are applied before the frame that
+//   published them so ID 25 and 28 answer with the same reading as the E-CV did
+
+#ifndef RAWDATA_REPLAY_H
+#define RAWDATA_REPLAY_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum ReplayKind { REPLAY_RX, REPLAY_TX, REPLAY_MESSAGE, REPLAY_FLOW, REPLAY_RETURN };
+
+struct ReplayEvent {
+  unsigned long time;       // ms since the first event
+  int kind;                 // ReplayKind
+  unsigned long frame;      // Request or reply frame for REPLAY_RX and REPLAY_TX
+  float value;              // Temperature for REPLAY_FLOW and REPLAY_RETURN
+  int message;              // Index in ReplayLog::topics and payloads for REPLAY_MESSAGE
+};
+
+struct ReplayLog {
+  std::vector<ReplayEvent> events;
+  std::vector<std::string> topics;
+  std::vector<std::string> payloads;
+  unsigned long skipped = 0;  // Lines that are not an E-CV message
+};
+
+struct ReplayResult {
+  unsigned long frames      = 0;  // Requests replayed
+  unsigned long compared    = 0;  // Replies compared with a recorded reply
+  unsigned long mismatches  = 0;
+  unsigned long messages    = 0;  // MQTT messages delivered to the core
+  unsigned long id_frames[256]     = {0};
+  unsigned long id_mismatches[256] = {0};
+  double seconds            = 0;  // Wall time of the replay
+  unsigned long duration    = 0;  // Log time in ms
+};
+
+//Read a text log or a binary capture, detected by the header. Returns false if the file can not be read.
+bool loadReplayLog(FILE* file, ReplayLog& log);
+//Write the log as a binary capture
+bool saveCapture(FILE* file, const ReplayLog& log);
+
+//Replay the log at maximum speed, the first max_report mismatches are printed to report
+ReplayResult replay(const ReplayLog& log, FILE* report, unsigned long max_report);
+
+#endif
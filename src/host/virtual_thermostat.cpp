@@ -0,0 +1,167 @@
+//Virtual OpenTherm leader, see virtual_thermostat.h
+
+#include <stdlib.h>
+#include <string.h>
+#include "virtual_thermostat.h"
+#include "host_platform.h"
+
+#define READ_DATA  0
+#define WRITE_DATA 1
+
+struct PollEntry {
+  int type;
+  int id;
+};
+
+//Status between every other request, the way a Honeywell leader keeps the CH enable fresh
+static const PollEntry honeywell_order[] = {
+  {READ_DATA, 0}, {WRITE_DATA, 1},  {READ_DATA, 0}, {READ_DATA, 25}, {READ_DATA, 0}, {READ_DATA, 17},
+  {READ_DATA, 0}, {WRITE_DATA, 14}, {READ_DATA, 0}, {WRITE_DATA, 16}, {READ_DATA, 0}, {WRITE_DATA, 24},
+  {READ_DATA, 0}, {READ_DATA, 56},  {READ_DATA, 0}, {READ_DATA, 57}, {READ_DATA, 0}, {READ_DATA, 18},
+  {READ_DATA, 0}, {READ_DATA, 28},  {READ_DATA, 0}, {READ_DATA, 3}
+};
+
+//Blocks of reads after status and setpoint, the way a Remeha leader collects its service data
+static const PollEntry remeha_order[] = {
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 17},  {READ_DATA, 25},  {READ_DATA, 28},  {READ_DATA, 18},
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 3},   {READ_DATA, 5},   {READ_DATA, 19},  {READ_DATA, 26},
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 27},  {READ_DATA, 56},  {READ_DATA, 57},  {WRITE_DATA, 14},
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 116}, {READ_DATA, 117}, {READ_DATA, 118}, {READ_DATA, 119},
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 120}, {READ_DATA, 121}, {READ_DATA, 122}, {READ_DATA, 123}
+};
+
+//All IDs the core supports in their natural direction
+static const PollEntry supported_ids[] = {
+  {READ_DATA, 0},   {WRITE_DATA, 1},  {READ_DATA, 3},   {READ_DATA, 5},   {WRITE_DATA, 14}, {WRITE_DATA, 16},
+  {READ_DATA, 17},  {READ_DATA, 18},  {READ_DATA, 19},  {WRITE_DATA, 24}, {READ_DATA, 25},  {READ_DATA, 26},
+  {READ_DATA, 27},  {READ_DATA, 28},  {READ_DATA, 56},  {READ_DATA, 57},  {READ_DATA, 116}, {READ_DATA, 117},
+  {READ_DATA, 118}, {READ_DATA, 119}, {READ_DATA, 120}, {READ_DATA, 121}, {READ_DATA, 122}, {READ_DATA, 123}
+};
+
+#define ENTRIES(a) (sizeof(a) / sizeof(a[0]))
+
+VirtualThermostat::VirtualThermostat(PollOrder order, unsigned long seed) : order(order), state(seed ? seed : 1) {
+}
+
+bool VirtualThermostat::parseOrder(const char* name, PollOrder& order) {
+  if (strcmp(name, "honeywell") == 0) { order = POLL_HONEYWELL; return true; }
+  if (strcmp(name, "remeha") == 0)    { order = POLL_REMEHA;    return true; }
+  if (strcmp(name, "random") == 0)    { order = POLL_RANDOM;    return true; }
+  return false;
+}
+
+//xorshift, the same seed gives the same traffic on every machine
+unsigned long VirtualThermostat::random() {
+  state ^= state << 13;
+  state &= 0xFFFFFFFFUL;
+  state ^= state >> 17;
+  state ^= state << 5;
+  state &= 0xFFFFFFFFUL;
+  return state;
+}
+
+unsigned long VirtualThermostat::request(int type, int id, unsigned int value) {
+  return frame_with_parity(((unsigned long)type << 28) | ((unsigned long)id << 16) | (value & 0xFFFF));
+}
+
+unsigned long VirtualThermostat::nextRequest() {
+  PollEntry entry;
+  if (order == POLL_HONEYWELL) {
+    entry = honeywell_order[step % ENTRIES(honeywell_order)];
+  } else if (order == POLL_REMEHA) {
+    entry = remeha_order[step % ENTRIES(remeha_order)];
+  } else {
+    entry = supported_ids[random() % ENTRIES(supported_ids)];
+  }
+  step++;
+
+  //Values in 1/2 C steps so the f8.8 round trip through 2 decimals is exact
+  unsigned int value = 0;
+  bool randomized = order == POLL_RANDOM;
+  switch (entry.id) {
+    case 0:  value = 0x0100; break;                                                                        // CH enable
+    case 1:  value = (randomized ? 20 + random() % 101 : 30 + (step / 100) % 81) * 128; break;           // 10..60 C
+    case 14: value = (randomized ? random() % 101 : 100) << 8; break;                                    // 0..100 %
+    case 16: value = (randomized ? 30 + random() % 21 : 41) * 128; break;                                 // 15..25 C
+    case 24: value = (randomized ? 30 + random() % 21 : 38 + (step / 500) % 5) * 128; break;             // 15..25 C
+  }
+  return request(entry.type, entry.id, value);
+}
+
+//FUNCTION: Value as the core sends it, through 2 decimals and the truncating f8.8 conversion
+static unsigned int f88(double value) {
+  char text[32];
+  float scaled = (float)atof(format_float(text, value, 2)) * 256;
+  if (!(scaled > 0)) { return 0; }
+  if (!(scaled < 65536.0f)) { return 0xFFFF; }
+  return (unsigned int)scaled;
+}
+
+int VirtualThermostat::verify(unsigned long request, unsigned long reply, const EcvCore& ecv) const {
+  int failed = 0;
+  int id = (request >> 16) & 0xFF;
+  int type = (request >> 28) & 0x7;
+  unsigned int request_value = request & 0xFFFF;
+
+  //Even parity over all 32 bits
+  unsigned long bits = reply;
+  int parity = 0;
+  while (bits) {
+    parity ^= 1;
+    bits &= bits - 1;
+  }
+  if (parity != 0) { failed |= CHECK_PARITY; }
+  if ((int)((reply >> 16) & 0xFF) != id) { failed |= CHECK_ID; }
+
+  //Expected type and value, ack of the request type unless the value is out of range
+  int expected_type = type == WRITE_DATA ? 5 : 4;
+  unsigned int expected = request_value;
+  bool known = false;
+  double value = 0, low = 0, high = 0;
+  bool f88_value = false;
+
+  switch (id) {
+    case 0: {
+      //Leader status echoed in the HB, the follower status in the LB
+      unsigned int flags = ecv.follower_status[7] == 1 ? 0x01 : (ecv.follower_status[6] == 1 ? 0x02 : 0) | (ecv.follower_status[4] == 1 ? 0x08 : 0);
+      expected = (request_value & 0xFFF0) | flags;
+      break;
+    }
+    case 3:  expected = (strcmp(ecv.DHW_mode, "1") == 0 ? 0x0300 : 0x0200) | (request_value & 0xFF); break;
+    case 5:  expected_type = 6; break;
+    case 1: case 14: case 16: case 24: {
+      //Writes are acknowledged with the written value
+      value = (request_value >> 8) + (request_value & 0xFF) / 256.0;
+      f88_value = true;
+      low = id == 1 || id == 14 ? 0 : -40;
+      high = id == 1 || id == 14 ? 100 : 127;
+      break;
+    }
+    case 17: value = ecv.delivered_modulation; low = 0; high = 100; f88_value = true; break;
+    case 18: value = ecv.water_pressure_ch; low = 0; high = 5; f88_value = true; break;
+    case 19: value = ecv.water_flow_dhw; low = 0; high = 16; f88_value = true; break;
+    case 25: value = ecv.heater_temp == 0 ? ecv.heater_flow_temperature : ecv.heater_temp; low = -40; high = 127; f88_value = true; break;
+    case 26: value = ecv.dhw_temperature; low = -40; high = 127; f88_value = true; known = true; break;
+    case 27: value = ecv.outside_temperature; low = -40; high = 127; f88_value = true; known = true; break;
+    case 28: value = ecv.return_temp == 0 ? ecv.return_water_temperature : ecv.return_temp; low = -40; high = 127; f88_value = true; known = true; break;
+    case 56: value = ecv.dhw_setpoint; low = 0; high = 127; f88_value = true; break;
+    case 57: value = ecv.max_ch_water_setpoint; low = 0; high = 127; f88_value = true; break;
+    default:
+      if (id >= 116 && id <= 123) { expected = ecv.counters.openTherm(id); }
+      break;
+  }
+  if (f88_value) {
+    char text[32];
+    double sent = atof(format_float(text, value, 2));
+    if (sent >= low && sent <= high) {
+      expected = f88(value);
+    } else {
+      expected_type = 6;
+      expected = 0;
+    }
+  }
+
+  if ((int)((reply >> 28) & 0x7) != expected_type) { failed |= CHECK_TYPE; }
+  if ((reply & 0xFFFF) != expected) { failed |= known ? CHECK_KNOWN : CHECK_VALUE; }
+  return failed;
+}
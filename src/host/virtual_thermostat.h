@@ -0,0 +1,47 @@
+//Virtual OpenTherm leader for throughput and soak runs of the E-CV core
+//
+//Generates the request frames of a thermostat in one of three poll orders:
+// - POLL_HONEYWELL  status (ID 0) between every other request, setpoints written and the heater values read
+// - POLL_REMEHA     blocks of reads after the status and control setpoint, including the counters ID 116 to 123
+// - POLL_RANDOM     random supported IDs in their natural direction with random values in range
+//and verifies every reply against the OpenTherm specification and the state of the core: parity, message type,
+//data-ID echo and value. IDs 26 to 28 are known divergences, the core echoes the request value as the override
+//compares with an uppercase ID, their value mismatches are counted apart from the failures.
+
+#ifndef VIRTUAL_THERMOSTAT_H
+#define VIRTUAL_THERMOSTAT_H
+
+#include <ecv_core.h>
+
+enum PollOrder { POLL_HONEYWELL, POLL_REMEHA, POLL_RANDOM };
+
+//Result bits of verify()
+#define CHECK_PARITY 1
+#define CHECK_TYPE   2
+#define CHECK_ID     4
+#define CHECK_VALUE  8
+#define CHECK_KNOWN  16
+
+class VirtualThermostat {
+  public:
+    VirtualThermostat(PollOrder order, unsigned long seed);
+
+    //Next request frame of the poll order, including the parity bit
+    unsigned long nextRequest();
+    //Verify the reply to request against the state of the core after the reply, returns the CHECK_* bits of the
+    //failed checks, CHECK_KNOWN for a value mismatch of a known divergence
+    int verify(unsigned long request, unsigned long reply, const EcvCore& ecv) const;
+
+    //Poll order by name, returns false for an unknown name
+    static bool parseOrder(const char* name, PollOrder& order);
+
+  private:
+    unsigned long request(int type, int id, unsigned int value);
+    unsigned long random();
+
+    PollOrder order;
+    unsigned long state;
+    unsigned long step = 0;
+};
+
+#endif
@@ -0,0 +1,92 @@
+//Tests of the MQTT state topics and one-shot commands, run with: pio test -e native
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <host_platform.h>
+
+void setUp() {}
+void tearDown() {}
+
+//Everything the core publishes and subscribes while running the function on a fresh core
+template <typename F> static std::string mqtt_trace(F run) {
+  char* text = nullptr;
+  size_t size = 0;
+  FILE* out = open_memstream(&text, &size);
+  {
+    HostEcv host(out);
+    run(host);
+  }
+  fclose(out);
+  std::string trace(text, size);
+  free(text);
+  return trace;
+}
+
+//The state topics are subscribed with QoS 1 for the persistent session, the one-shot commands with QoS 0
+static void test_oneshot_subscribed_without_queue() {
+  std::string trace = mqtt_trace([](HostEcv& host) { host.ecv.mqttConnected(); });
+  TEST_ASSERT_TRUE(trace.find("SUB ecv/command/pid_kp 1\n") != std::string::npos);
+  TEST_ASSERT_TRUE(trace.find("SUB ecv/command/autotune 0\n") != std::string::npos);
+  TEST_ASSERT_TRUE(trace.find("SUB ecv/command/autotune 1\n") == std::string::npos);
+}
+
+//A retained auto-tune start after a reconnect runs once and is removed from the broker with an empty retained message
+static void test_oneshot_cleared_after_acting() {
+  int request = 0;
+  std::string trace = mqtt_trace([&request](HostEcv& host) {
+    host.ecv.mqttConnected();
+    host.receive("ecv/command/autotune", "1");
+    request = host.ecv.autotune_request;
+  });
+  TEST_ASSERT_EQUAL_INT(1, request);
+  TEST_ASSERT_TRUE(trace.find("PUB(r) ecv/command/autotune \n") != std::string::npos);
+}
+
+//The empty message of the clear comes back on the subscription and is ignored, atoi() would read it as 0 = abort
+static void test_oneshot_clear_ignored() {
+  int request = 0;
+  std::string trace = mqtt_trace([&request](HostEcv& host) {
+    host.receive("ecv/command/autotune", "1");
+    host.receive("ecv/command/autotune", "");
+    request = host.ecv.autotune_request;
+  });
+  TEST_ASSERT_EQUAL_INT(1, request);
+  TEST_ASSERT_EQUAL_size_t(trace.find("PUB(r) ecv/command/autotune \n"), trace.rfind("PUB(r) ecv/command/autotune \n"));
+}
+
+//A retained counter reset wipes the counters once: it is removed from the broker, so a reconnect does not reset again
+static void test_counters_reset_cleared() {
+  uint32_t reset = 1, kept = 0;
+  std::string trace = mqtt_trace([&reset, &kept](HostEcv& host) {
+    host.ecv.mqttConnected();
+    host.ecv.counters.update(0, true, true, false, 9000);
+    host.ecv.counters.update(60000, true, true, false, 9000);
+    host.receive("ecv/command/counters_reset", "1");
+    reset = host.ecv.counters.energyWh();
+    host.ecv.counters.update(120000, true, true, false, 9000);
+    host.receive("ecv/command/counters_reset", "");
+    kept = host.ecv.counters.energyWh();
+  });
+  TEST_ASSERT_TRUE(trace.find("SUB ecv/command/counters_reset 0\n") != std::string::npos);
+  TEST_ASSERT_TRUE(trace.find("PUB(r) ecv/command/counters_reset \n") != std::string::npos);
+  TEST_ASSERT_EQUAL_UINT32(0, reset);
+  TEST_ASSERT_TRUE(kept > 0);
+}
+
+//A state topic is kept on the broker
+static void test_state_not_cleared() {
+  std::string trace = mqtt_trace([](HostEcv& host) { host.receive("ecv/command/pid_kp", "4.5"); });
+  TEST_ASSERT_TRUE(trace.find("ecv/command/pid_kp") == std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_oneshot_subscribed_without_queue);
+  RUN_TEST(test_oneshot_cleared_after_acting);
+  RUN_TEST(test_oneshot_clear_ignored);
+  RUN_TEST(test_counters_reset_cleared);
+  RUN_TEST(test_state_not_cleared);
+  return UNITY_END();
+}
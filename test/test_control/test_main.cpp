@@ -0,0 +1,137 @@
+//Closed-loop tests of the E-CV control on the plant model, run with: pio test -e native
+//
+//Every test runs a day of the core on the virtual clock with control_sim.h, the result does not depend on the
+//machine.
+
+#include <unity.h>
+#include <control_sim.h>
+#include <heating_curve.h>
+
+void setUp() {}
+void tearDown() {}
+
+//The PID settles within 1 C of the setpoint with little overshoot and integrates far less error than the step
+//controller, which has no integral action and stays below the setpoint
+static void test_pid_against_step() {
+  SimOptions options;
+  options.hours = 24;
+  options.outside = 0;
+  options.setpoint = 45;
+
+  options.controller = CONTROL_STEP;
+  SimResult step;
+  run_control_sim(options, step);
+  options.controller = CONTROL_PID;
+  SimResult pid;
+  run_control_sim(options, pid);
+
+  TEST_ASSERT_TRUE(pid.settling >= 0);
+  TEST_ASSERT_TRUE(pid.overshoot <= SIM_PID_MAX_OVERSHOOT);
+  TEST_ASSERT_TRUE(step.settling < 0);
+  TEST_ASSERT_TRUE(pid.iae < step.iae / 2);
+}
+
+//With a daily outside cycle of +-5 C around 0 C the fixed setpoint lets the house cool down in the night, the
+//heating curve raises the flow in time and keeps the room within 1 C of 20 C
+static void test_curve_against_setpoint() {
+  SimOptions options;
+  options.hours = 24;
+  options.outside = 0;
+  options.setpoint = 45;
+  options.outside_swing = 5;
+
+  SimResult setpoint;
+  run_control_sim(options, setpoint);
+  options.curve = true;
+  SimResult curve;
+  run_control_sim(options, curve);
+
+  TEST_ASSERT_TRUE(curve.room_min > 19.0);
+  TEST_ASSERT_TRUE(curve.room_iae < setpoint.room_iae / 2);
+}
+
+//A slope past the f8.8 range of the table gives the maximum flow at the cold end instead of a wrapped value
+static void test_curve_steep_slope() {
+  HeatingCurve curve;
+  curve.setLimits(20, 90);
+  curve.setSlope(4.0);
+  TEST_ASSERT_EQUAL_INT32(90 * 256, curve.flowTarget(-30 * 256, 20 * 256));
+  TEST_ASSERT_EQUAL_INT32(90 * 256, curve.flowTarget(-10 * 256, 20 * 256));
+  curve.setSlope(2.2);
+  TEST_ASSERT_EQUAL_INT32(90 * 256, curve.flowTarget(-30 * 256, 20 * 256));
+}
+
+//A step of the thermostat from 55 C down to 45 C: the feed-forward drops with the target at once and settles faster
+//with less overshoot and fewer stage changes than the PID alone
+static void test_feed_forward_setpoint_step() {
+  SimOptions options;
+  options.hours = 24;
+  options.outside = 0;
+  options.setpoint = 55;
+  options.change_at = 12;
+  options.change_to = 45;
+
+  SimResult on;
+  run_control_sim(options, on);
+  options.feed_forward = false;
+  SimResult off;
+  run_control_sim(options, off);
+
+  TEST_ASSERT_TRUE(on.event_settling >= 0);
+  TEST_ASSERT_TRUE(off.event_settling < 0 || on.event_settling < off.event_settling);
+  TEST_ASSERT_TRUE(on.event_overshoot < off.event_overshoot);
+  TEST_ASSERT_TRUE(on.event_switches <= off.event_switches);
+}
+
+//The radiators take 1.5 times more heat, the valves open: the feed-forward follows the colder return and settles
+//faster with fewer stage changes, without overshooting more than a sensor step above the PID alone
+static void test_feed_forward_load_change() {
+  SimOptions options;
+  options.hours = 24;
+  options.outside = 0;
+  options.setpoint = 45;
+  options.load_at = 12;
+  options.load = 1.5;
+
+  SimResult on;
+  run_control_sim(options, on);
+  options.feed_forward = false;
+  SimResult off;
+  run_control_sim(options, off);
+
+  TEST_ASSERT_TRUE(on.event_settling >= 0);
+  TEST_ASSERT_TRUE(off.event_settling < 0 || on.event_settling <= off.event_settling);
+  TEST_ASSERT_TRUE(on.event_overshoot <= off.event_overshoot + FF_OVERSHOOT_MARGIN);
+  TEST_ASSERT_TRUE(on.event_switches <= off.event_switches);
+}
+
+//The relay auto-tune at the first CH request, its gains confirmed when it is done: the loop settles with no more stage
+//changes than with the default gains, the relay with its changes included
+static void test_autotune_gains() {
+  SimOptions options;
+  options.hours = 24;
+  options.outside = 0;
+  options.setpoint = 45;
+
+  SimResult defaults;
+  run_control_sim(options, defaults);
+  options.autotune = true;
+  SimResult tuned;
+  run_control_sim(options, tuned);
+
+  TEST_ASSERT_EQUAL_STRING("done", tuned.autotune);
+  TEST_ASSERT_TRUE(tuned.autotune_kp > 0);
+  TEST_ASSERT_TRUE(tuned.settling >= 0);
+  TEST_ASSERT_TRUE(tuned.switches <= defaults.switches);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pid_against_step);
+  RUN_TEST(test_curve_against_setpoint);
+  RUN_TEST(test_curve_steep_slope);
+  RUN_TEST(test_feed_forward_setpoint_step);
+  RUN_TEST(test_feed_forward_load_change);
+  RUN_TEST(test_autotune_gains);
+  return UNITY_END();
+}
@@ -0,0 +1,105 @@
+//Tests of the time-proportioning between heater stages, run with: pio test -e native
+//
+//The heater follows the planned stage at once, every update is one second of virtual time.
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include <stage_dither.h>
+
+#define DITHER_PERIOD  300000
+#define DITHER_SLOT     60000
+#define DITHER_STEP      1000
+
+void setUp() {}
+void tearDown() {}
+
+//Gap in f8.8 percent between the two stages around a modulation, 0 at full power
+static int32_t stage_gap(int32_t modulation) {
+  int low = 0;
+  while (low < HEATER_STAGES && heater_stage_modulation(low + 1) <= modulation) { low++; }
+  if (low == HEATER_STAGES) { return 0; }
+  return heater_stage_modulation(low + 1) - heater_stage_modulation(low);
+}
+
+//Run the dither from now for periods at the requested modulation, returns the average delivered modulation in
+//f8.8 percent
+static double run_periods(StageDither& dither, unsigned long& now, int32_t requested, int periods) {
+  int32_t delivered = dither.output();
+  double sum = 0;
+  unsigned long end = now + (unsigned long)periods * DITHER_PERIOD;
+  for (; now < end; now += DITHER_STEP) {
+    dither.update(now, requested, delivered);
+    delivered = dither.output();
+    sum += delivered;
+  }
+  return sum / ((double)periods * DITHER_PERIOD / DITHER_STEP);
+}
+
+//Over n periods the average follows every modulation from off to full power within the gap / n of stage_dither.h
+static void test_average_follows_demand() {
+  const int periods = 10;
+  for (int32_t requested = 0; requested <= 100 * 256; requested += 64) {
+    StageDither dither;
+    dither.setPeriod(DITHER_PERIOD);
+    dither.setMinSlot(DITHER_SLOT);
+    unsigned long now = 0;
+    double average = run_periods(dither, now, requested, periods);
+
+    char message[48];
+    snprintf (message, sizeof(message), "requested %.2f%% average %.2f%%", requested / 256.0, average / 256.0);
+    TEST_ASSERT_TRUE_MESSAGE(fabs(average - requested) <= (double)stage_gap(requested) / periods + 1, message);
+  }
+}
+
+//At most one stage change per period while the modulation stays between the same two stages
+static void test_one_change_per_period() {
+  StageDither dither;
+  dither.setPeriod(DITHER_PERIOD);
+  dither.setMinSlot(DITHER_SLOT);
+  int32_t requested = (heater_stage_modulation(4) + heater_stage_modulation(5)) / 2;
+  int changes = 0;
+  int last = -1;
+  int32_t delivered = 0;
+  for (unsigned long now = 0; now < 20UL * DITHER_PERIOD; now += DITHER_STEP) {
+    dither.update(now, requested, delivered);
+    delivered = dither.output();
+    if (last >= 0 && dither.stage() != last) { changes++; }
+    last = dither.stage();
+  }
+  TEST_ASSERT_TRUE(changes <= 20);
+}
+
+//A new period in the middle of a schedule keeps its share of the upper stage and the average stays exact
+static void test_period_change_mid_cycle() {
+  StageDither dither;
+  dither.setPeriod(DITHER_PERIOD);
+  dither.setMinSlot(DITHER_SLOT);
+  int32_t requested = heater_stage_modulation(4) + (heater_stage_modulation(5) - heater_stage_modulation(4)) / 3;
+  unsigned long now = 0;
+  run_periods(dither, now, requested, 3);
+
+  //Halfway through the next period to half its length, the planned times still add up to the period
+  dither.update(now, requested, dither.output());
+  dither.update(now + DITHER_PERIOD / 2, requested, dither.output());
+  unsigned long first = dither.firstTime();
+  TEST_ASSERT_TRUE(first > 0 && first < DITHER_PERIOD);
+  dither.setPeriod(DITHER_PERIOD / 2);
+  TEST_ASSERT_EQUAL_UINT32(first / 2, dither.firstTime());
+  TEST_ASSERT_EQUAL_UINT32(DITHER_PERIOD / 2, dither.firstTime() + dither.secondTime());
+
+  //A longer period is scaled the same way, the average over the next periods stays within the tolerance
+  dither.setPeriod(DITHER_PERIOD);
+  TEST_ASSERT_EQUAL_UINT32(DITHER_PERIOD, dither.firstTime() + dither.secondTime());
+  now += DITHER_PERIOD / 2;
+  double average = run_periods(dither, now, requested, 10);
+  TEST_ASSERT_TRUE(fabs(average - requested) <= (double)stage_gap(requested) / 10 + 1);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_average_follows_demand);
+  RUN_TEST(test_one_change_per_period);
+  RUN_TEST(test_period_change_mid_cycle);
+  return UNITY_END();
+}
@@ -0,0 +1,43 @@
+//Golden-response check of processRequest() against the committed corpus, run with: pio test -e native
+//
+//golden_corpus.txt next to this file is the corpus of golden_corpus.h, recorded with
+//  .pio/build/native/program golden record test/test_golden/golden_corpus.txt
+//A change of the replies or the MQTT publishes fails the test. Record it again only for an intended change, the
+//diff of the corpus shows every changed case.
+
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+#include <golden_corpus.h>
+
+void setUp() {}
+void tearDown() {}
+
+//Path of the corpus in the directory of this file
+static std::string corpus_path() {
+  std::string path = __FILE__;
+  size_t slash = path.find_last_of('/');
+  return (slash == std::string::npos ? std::string() : path.substr(0, slash + 1)) + "golden_corpus.txt";
+}
+
+static void test_golden_corpus() {
+  std::vector<GoldenCase> expected;
+  FILE* file = fopen(corpus_path().c_str(), "r");
+  TEST_ASSERT_NOT_NULL_MESSAGE(file, "golden_corpus.txt not found");
+  bool loaded = golden_load(file, expected);
+  fclose(file);
+  TEST_ASSERT_TRUE_MESSAGE(loaded, "golden_corpus.txt is not a corpus");
+
+  //Prints the first changed cases with both versions
+  GoldenCheck check = golden_check(expected, stdout, 20);
+  TEST_ASSERT_EQUAL_UINT32(expected.size(), check.cases);
+  TEST_ASSERT_EQUAL_UINT32(0, check.missing);
+  TEST_ASSERT_EQUAL_UINT32(0, check.regressions);
+  TEST_ASSERT_EQUAL_UINT32(0, check.known);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_golden_corpus);
+  return UNITY_END();
+}
@@ -0,0 +1,64 @@
+//Tests of the frames injected on MQTT [ecv/rawdata/command], run with: pio test -e native
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <host_platform.h>
+
+void setUp() {}
+void tearDown() {}
+
+//Reply of the bus to a request on a fresh core
+static unsigned long bus_reply(unsigned long request) {
+  HostEcv host;
+  host.ecv.processRequest(request);
+  return host.link.response;
+}
+
+//An injected batch is answered on [ecv/rawdata/reply] with the replies of the bus, but nothing is sent to the
+//OpenTherm link and the response time is not waited for
+static void test_injected_frames_stay_on_mqtt() {
+  unsigned long status = frame_with_parity(0x00000300UL);
+  unsigned long boiler = frame_with_parity(0x00190000UL);
+  char batch[32];
+  snprintf (batch, sizeof(batch), "%08lx %08lx", status, boiler);
+
+  char* text = nullptr;
+  size_t size = 0;
+  FILE* out = open_memstream(&text, &size);
+  {
+    HostEcv host(out);
+    host.ecv.timing = 250;
+    unsigned long start = host.clock.millis();
+    host.receive("ecv/rawdata/command", batch);
+
+    TEST_ASSERT_EQUAL_UINT32(0, host.link.responses);
+    TEST_ASSERT_EQUAL_UINT32(start, host.clock.millis());
+  }
+  fclose(out);
+
+  char expected[64];
+  snprintf (expected, sizeof(expected), "PUB ecv/rawdata/reply %08lx %08lx\n", bus_reply(status), bus_reply(boiler));
+  std::string published(text, size);
+  free(text);
+  TEST_ASSERT_TRUE_MESSAGE(published.find(expected) != std::string::npos, expected);
+}
+
+//A frame of the bus still goes out through the link after the response time
+static void test_bus_frame_is_sent() {
+  HostEcv host;
+  host.ecv.timing = 250;
+  unsigned long start = host.clock.millis();
+  host.ecv.processRequest(0x00000000UL);
+
+  TEST_ASSERT_EQUAL_UINT32(1, host.link.responses);
+  TEST_ASSERT_EQUAL_UINT32(start + 250, host.clock.millis());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_injected_frames_stay_on_mqtt);
+  RUN_TEST(test_bus_frame_is_sent);
+  return UNITY_END();
+}
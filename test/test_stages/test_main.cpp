@@ -0,0 +1,111 @@
+//Tests of the heater stages and the SSR switch counts, run with: pio test -e native
+
+#include <math.h>
+#include <unity.h>
+#include <heater_stages.h>
+#include <stage_selector.h>
+
+void setUp() {}
+void tearDown() {}
+
+//Nodes of the wiring in heater_stages.h: L, N and the coil ends 1a, 1b, 2a, 2b, 3a, 3b
+enum { NODE_L, NODE_N, NODE_1A, NODE_1B, NODE_2A, NODE_2B, NODE_3A, NODE_3B, NODES };
+static const int ssr_nodes[HEATER_SSRS][2] = {
+  { NODE_L, NODE_1A }, { NODE_2B, NODE_N }, { NODE_L, NODE_3B }, { NODE_1A, NODE_2A },
+  { NODE_1B, NODE_2B }, { NODE_1B, NODE_3B }, { NODE_2A, NODE_3A }
+};
+
+static int find(int* parent, int node) {
+  while (parent[node] != node) { node = parent[node]; }
+  return node;
+}
+
+//Power in W of the coils with the closed SSRs of a mask, each coil is 3000W on the full voltage. Returns -1 for a
+//short between L and N.
+static double wiring_power(uint8_t closed) {
+  int parent[NODES];
+  for (int i = 0; i < NODES; i++) { parent[i] = i; }
+  for (int i = 0; i < HEATER_SSRS; i++) {
+    if (closed & (1 << i)) { parent[find(parent, ssr_nodes[i][0])] = find(parent, ssr_nodes[i][1]); }
+  }
+  int l = find(parent, NODE_L);
+  int n = find(parent, NODE_N);
+  if (l == n) { return -1; }
+
+  //Node voltages with L at 1 and N at 0 by Gauss-Seidel on the conductance of the coils
+  double voltage[NODES] = {0};
+  voltage[l] = 1;
+  for (int iteration = 0; iteration < 2000; iteration++) {
+    for (int node = 0; node < NODES; node++) {
+      if (node == l || node == n || find(parent, node) != node) { continue; }
+      double sum = 0;
+      int count = 0;
+      for (int coil = 0; coil < HEATER_COILS; coil++) {
+        int a = find(parent, NODE_1A + 2 * coil);
+        int b = find(parent, NODE_1B + 2 * coil);
+        if (a == b) { continue; }
+        if (a == node) { sum += voltage[b]; count++; }
+        if (b == node) { sum += voltage[a]; count++; }
+      }
+      if (count > 0) { voltage[node] = sum / count; }
+    }
+  }
+
+  double power = 0;
+  for (int coil = 0; coil < HEATER_COILS; coil++) {
+    double v = voltage[find(parent, NODE_1A + 2 * coil)] - voltage[find(parent, NODE_1B + 2 * coil)];
+    power += 3000 * v * v;
+  }
+  return power;
+}
+
+//The SSRs of every stage make the power of the stage without a short, stage 0 opens all of them
+static void test_ssrs_make_stage_power() {
+  TEST_ASSERT_EQUAL_UINT8(0, heater_stage_ssrs[0]);
+  for (int stage = 1; stage <= HEATER_STAGES; stage++) {
+    double power = wiring_power(heater_stage_ssrs[stage]);
+    TEST_ASSERT_TRUE_MESSAGE(fabs(power - heater_stage_power[stage]) < 1, "stage power");
+  }
+}
+
+//Every stage change toggles at least one SSR, also between stages with the same coils carrying current
+static void test_every_change_toggles() {
+  for (int from = 0; from <= HEATER_STAGES; from++) {
+    for (int to = 0; to <= HEATER_STAGES; to++) {
+      if (from != to) { TEST_ASSERT_TRUE(heater_stage_ssrs[from] != heater_stage_ssrs[to]); }
+    }
+  }
+}
+
+static int toggles(uint8_t mask) {
+  int count = 0;
+  for (; mask; mask &= mask - 1) { count++; }
+  return count;
+}
+
+//The selector counts the toggles of 1 -> 7 -> 1, all coils carry current in both stages
+static void test_selector_counts_ssr_toggles() {
+  StageSelector selector;
+  selector.setHysteresis(0);
+  selector.setMinDwell(0);
+  selector.setMinOn(0);
+  selector.setMinOff(0);
+  selector.update(0, heater_stage_modulation(1), true);
+  selector.update(1, heater_stage_modulation(7), true);
+  selector.update(2, heater_stage_modulation(1), true);
+  TEST_ASSERT_EQUAL_INT(1, selector.stage());
+
+  unsigned long total = 0;
+  for (int i = 0; i < HEATER_SSRS; i++) { total += selector.ssrSwitches(i); }
+  int expected = toggles(heater_stage_ssrs[1]) + 2 * toggles(heater_stage_ssrs[1] ^ heater_stage_ssrs[7]);
+  TEST_ASSERT_EQUAL_UINT32(expected, total);
+  TEST_ASSERT_EQUAL_UINT32(3, selector.stageSwitches());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ssrs_make_stage_power);
+  RUN_TEST(test_every_change_toggles);
+  RUN_TEST(test_selector_counts_ssr_toggles);
+  return UNITY_END();
+}